@@ -0,0 +1,43 @@
+/*
+ * czt.h - chirp-z (zoom) transform
+ *
+ * I hereby grant permission for anyone to use this software for any
+ * purpose that they choose, I do not warrant the software to be
+ * functional or even correct. It was written as part of an educational
+ * exercise and is not "product grade" as far as the author is concerned.
+ *
+ * NO WARRANTY, EXPRESS OR IMPLIED ACCOMPANIES THIS SOFTWARE. USE IT AT
+ * YOUR OWN RISK.
+ */
+#pragma once
+#include <dsp/signal.h>
+#include <dsp/windows.h>
+#include <dsp/fft.h>
+
+/*
+ * Everything about a zoom that doesn't depend on the samples. 'n'
+ * samples in, 'm' bins out, evenly spaced from 'start' up to (but not
+ * including) 'end', via 'l' point FFTs.
+ */
+typedef struct {
+	int				n;			/* samples per transform */
+	int				m;			/* bins */
+	int				l;			/* FFT size, a power of 2 >= n + m - 1 */
+	window_function	window;
+	int				r;			/* sample rate */
+	double			center;		/* center of the span */
+	double			start;		/* first bin's frequency */
+	double			end;		/* one bin past the last one */
+	complex double	*pre;		/* window * A^-t * W^(t^2 / 2), t < n */
+	complex double	*post;		/* W^(k^2 / 2), k < m */
+	complex double	*h_fft;		/* FFT of W^(-j^2 / 2), scaled by 1 / l */
+	complex double	*work;		/* l values */
+	fft_plan_t		*fft;
+} czt_plan_t;
+
+czt_plan_t *czt_plan(int n, int bins, window_function w, int sample_rate,
+		double center_freq, double start_freq, double end_freq);
+void free_czt_plan(czt_plan_t *plan);
+sample_buf_t *czt_execute(czt_plan_t *plan, sample_buf_t *s);
+sample_buf_t *compute_czt(sample_buf_t *s, int bins, window_function w,
+		double center_freq, double start_freq, double end_freq);
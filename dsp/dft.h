@@ -6,9 +6,13 @@
 #pragma once
 #include <dsp/signal.h>
 #include <dsp/windows.h>
+#include <dsp/threads.h>
 
 sample_buf_t *compute_dft(sample_buf_t *, int bins, window_function w,
 					double center_freq, double start_freq, double end_freq);
+sample_buf_t *compute_dft_threads(sample_buf_t *, int bins, window_function w,
+					double center_freq, double start_freq, double end_freq,
+					struct thread_pool_t *pool);
 /* deprecated */
 int plot_dft(FILE *file, sample_buf_t *dft, char *tag, 
 					double start_freq, double end_freq);
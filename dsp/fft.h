@@ -6,8 +6,114 @@
 #include <string.h> /* for memset */
 #include <dsp/signal.h>
 #include <dsp/windows.h>
+#include <dsp/threads.h>
 
-sample_buf_t *compute_fft(sample_buf_t *s, int bins, window_function, 
+/*
+ * Power of 2 transforms this big or bigger use the four step FFT,
+ * which works on blocks of FFT_FOUR_STEP_BLOCK rows or columns at a
+ * time.
+ */
+#define FFT_FOUR_STEP_MIN	(1 << 18)
+#define FFT_FOUR_STEP_BLOCK	8
+
+/*
+ * Which algorithm a plan uses, this depends on the number of bins.
+ */
+typedef enum {
+	FFT_RADIX_2,		/* power of 2, the classic butterflies */
+	FFT_MIXED_RADIX,	/* a product of 2, 3, 5, and 7 */
+	FFT_BLUESTEIN,		/* anything else, via a chirp convolution */
+	FFT_FOUR_STEP		/* large powers of 2, as smaller FFTs */
+} fft_algorithm;
+
+/*
+ * An FFT "plan" holds everything about a transform that depends only
+ * on its size and window, so that it can be computed once and then used
+ * for as many transforms of that size as you like. Plans that need
+ * scratch space (mixed radix and Bluestein) keep it here, so any one
+ * plan should only be running one transform at a time.
+ */
+typedef struct __fft_plan {
+	int				n;			/* number of bins */
+	int				bits;		/* log2(n) (radix 2 only) */
+	window_function	window;		/* window applied to the input */
+	fft_algorithm	algorithm;	/* how the transform is computed */
+	int				*rev;		/* reflected (bit reversed) index table */
+	const double	*win;		/* window coefficients, by sample index */
+	complex double	*twiddle;	/* unit roots e^(-2 pi i k / n) */
+	complex double	*stage_tw;	/* the same roots, by stage (radix 2) */
+	complex double	*stage_itw;	/* their conjugates, for the inverse */
+	const float		*winf;		/* single precision window (fft_plan_f) */
+	complex float	*stage_twf;	/* single precision roots, by stage */
+	double			*stage_re;	/* split roots, by stage (fft_plan_split) */
+	double			*stage_im;
+	int				n_factors;	/* number of radices (mixed radix) */
+	int				factors[32];	/* the radices, 2, 3, 5, or 7 */
+	complex double	*work;		/* scratch space */
+	struct __fft_plan *sub;		/* power of 2 plan (Bluestein), N1 (four step) */
+	struct __fft_plan *sub2;	/* N2 point plan (four step) */
+	int				n1, n2;		/* matrix shape, N1 x N2 (four step) */
+	complex double	*tw_lo;		/* W(N)^b, b < N2 (four step) */
+	complex double	*tw_hi;		/* W(N)^(a * N2), a < N1 (four step) */
+	struct thread_pool_t *pool;	/* threads to use (four step, batches) */
+	complex double	**scratch;	/* per thread scratch (four step) */
+	int				n_scratch;	/* number of scratch buffers */
+	complex double	*chirp;		/* e^(-i pi k^2 / n) (Bluestein) */
+	complex double	*chirp_fft;	/* FFT of the conjugate chirp */
+} fft_plan_t;
+
+fft_plan_t *fft_plan(int bins, window_function w);
+sample_buf_t *fft_execute(fft_plan_t *plan, sample_buf_t *s, double center);
+sample_buf_t *fft_execute_into(fft_plan_t *plan, sample_buf_t *s,
+		sample_buf_t *result, double center);
+sample_buf_t *fft_execute_inplace(fft_plan_t *plan, sample_buf_t *s,
+		double center);
+void free_fft_plan(fft_plan_t *plan);
+int fft_plan_threads(fft_plan_t *plan, struct thread_pool_t *pool);
+void fft_transform(fft_plan_t *plan, complex double *data);
+
+/* the inverse transform, bins back to samples */
+sample_buf_t *fft_execute_inverse(fft_plan_t *plan, sample_buf_t *s);
+sample_buf_t *fft_execute_inverse_into(fft_plan_t *plan, sample_buf_t *s,
+		sample_buf_t *result);
+sample_buf_t *fft_execute_inverse_inplace(fft_plan_t *plan, sample_buf_t *s);
+
+/* many frames at once, frame f starts at sample f * stride */
+sample_buf_t *fft_execute_batch(fft_plan_t *plan, sample_buf_t *s,
+		int frames, int stride, double center);
+sample_buf_t *fft_execute_batch_into(fft_plan_t *plan, sample_buf_t *s,
+		int frames, int stride, sample_buf_t *result, double center);
+
+sample_buf_t *compute_fft(sample_buf_t *s, int bins, window_function,
+		double center_frequency);
+sample_buf_t *compute_fft_into(sample_buf_t *s, sample_buf_t *result,
+		int bins, window_function, double center_frequency);
+sample_buf_t *compute_fft_inplace(sample_buf_t *s, window_function,
 		double center_frequency);
 sample_buf_t *compute_ifft(sample_buf_t *s);
+sample_buf_t *compute_ifft_inplace(sample_buf_t *s);
 
+/* single precision, power of 2 sizes only */
+fft_plan_t *fft_plan_f(int bins, window_function w);
+sample_buf_f_t *fft_execute_f(fft_plan_t *plan, sample_buf_f_t *s,
+		double center);
+sample_buf_f_t *fft_execute_f_into(fft_plan_t *plan, sample_buf_f_t *s,
+		sample_buf_f_t *result, double center);
+sample_buf_f_t *compute_fft_f(sample_buf_f_t *s, int bins, window_function,
+		double center_frequency);
+
+/* split complex (planar) buffers, power of 2 sizes only */
+fft_plan_t *fft_plan_split(int bins, window_function w);
+sample_buf_split_t *fft_execute_split(fft_plan_t *plan, sample_buf_split_t *s,
+		double center);
+sample_buf_split_t *fft_execute_split_into(fft_plan_t *plan,
+		sample_buf_split_t *s, sample_buf_split_t *result, double center);
+sample_buf_split_t *compute_fft_split(sample_buf_split_t *s, int bins,
+		window_function, double center_frequency);
+
+/* integer sample buffers, converted as they are loaded */
+sample_buf_t *fft_execute_i(fft_plan_t *plan, sample_buf_i_t *s, double center);
+sample_buf_t *fft_execute_i_into(fft_plan_t *plan, sample_buf_i_t *s,
+		sample_buf_t *result, double center);
+sample_buf_t *compute_fft_i(sample_buf_i_t *s, int bins, window_function,
+		double center_frequency);
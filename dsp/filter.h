@@ -31,9 +31,13 @@ struct fir_filter_t {
 
 /* Apply a filter to a signal */
 sample_buf_t * fir_filter(sample_buf_t *signal, struct fir_filter_t *fir);
+sample_buf_f_t * fir_filter_f(sample_buf_f_t *signal, struct fir_filter_t *fir);
+sample_buf_split_t * fir_filter_split(sample_buf_split_t *signal,
+		struct fir_filter_t *fir);
+sample_buf_t * fir_filter_i(sample_buf_i_t *signal, struct fir_filter_t *fir);
 
 /* Apply a filter to an array of real values */
-double * filter_real(double signal[], int n, struct fir_filter_t *fir);
+double * filter_real(double signal[], int64_t n, struct fir_filter_t *fir);
 
 /* Parse a FIR filter descriptor file. */
 struct fir_filter_t *load_filter(FILE *f);
@@ -0,0 +1,80 @@
+/*
+ * fxfft.h - fixed point (Q15 and Q31) FFT
+ *
+ * I hereby grant permission for anyone to use this software for any
+ * purpose that they choose, I do not warrant the software to be
+ * functional or even correct. It was written as part of an educational
+ * exercise and is not "product grade" as far as the author is concerned.
+ *
+ * NO WARRANTY, EXPRESS OR IMPLIED ACCOMPANIES THIS SOFTWARE. USE IT AT
+ * YOUR OWN RISK.
+ */
+#pragma once
+#include <stdint.h>
+#include <dsp/signal.h>
+#include <dsp/windows.h>
+
+/* complex fixed point values, the fraction has 15 (31) bits */
+typedef struct {
+	int16_t	re;
+	int16_t	im;
+} cq15_t;
+
+typedef struct {
+	int32_t	re;
+	int32_t	im;
+} cq31_t;
+
+/*
+ * How the values are kept from overflowing as they grow through the
+ * stages. Each stage can double them (and a bit more).
+ */
+typedef enum {
+	FX_SCALE_BLOCK,		/* block floating point, shift only when needed */
+	FX_SCALE_STAGE,		/* shift right one bit before every stage */
+	FX_SCALE_NONE		/* never shift, saturate instead */
+} fx_scaling;
+
+/*
+ * A fixed point plan, power of 2 sizes only. It also remembers the
+ * shifts used before each stage of the last transform, which is what
+ * a hardware block floating point FFT would report.
+ */
+typedef struct {
+	int				n;			/* number of bins */
+	int				bits;		/* log2(n) */
+	window_function	window;		/* window applied to the input */
+	fx_scaling		scaling;	/* how growth is handled */
+	int				*rev;		/* reflected (bit reversed) index table */
+	int16_t			*win15;		/* Q15 window (NULL for W_RECT) */
+	int32_t			*win31;		/* Q31 window (NULL for W_RECT) */
+	int16_t			*tw15re;	/* Q15 roots by stage, (re, re) pairs */
+	int16_t			*tw15im;	/* and (-im, im) pairs */
+	int32_t			*tw31re;	/* Q31 roots, the same way */
+	int32_t			*tw31im;
+	int				shifts[32];	/* right shifts before each stage */
+} fx_fft_plan_t;
+
+fx_fft_plan_t *fx_fft_plan(int bins, window_function w, fx_scaling scaling);
+void free_fx_fft_plan(fx_fft_plan_t *plan);
+
+/*
+ * Transform 'plan->n' values in place, natural order in and out. The
+ * result times 2^(returned exponent) is the FFT of the input, and the
+ * number of values that had to saturate goes in '*overflows' (which
+ * may be NULL).
+ */
+int fx_fft_q15(fx_fft_plan_t *plan, cq15_t *data, int *overflows);
+int fx_fft_q31(fx_fft_plan_t *plan, cq31_t *data, int *overflows);
+
+/*
+ * Quantize a sample buffer to 'width' (16 or 32) bits, transform it,
+ * and put the bins back in a sample buffer scaled to match what
+ * compute_fft() gives for the same samples.
+ */
+sample_buf_t *fx_fft_execute(fx_fft_plan_t *plan, sample_buf_t *s, int width,
+		double center, int *overflows);
+sample_buf_t *compute_fft_q15(sample_buf_t *s, int bins, window_function,
+		double center_frequency);
+sample_buf_t *compute_fft_q31(sample_buf_t *s, int bins, window_function,
+		double center_frequency);
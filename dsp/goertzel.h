@@ -0,0 +1,32 @@
+/*
+ * goertzel.h - a bank of Goertzel filters for measuring a few tones
+ *
+ * I hereby grant permission for anyone to use this software for any
+ * purpose that they choose, I do not warrant the software to be
+ * functional or even correct. It was written as part of an educational
+ * exercise and is not "product grade" as far as the author is concerned.
+ *
+ * NO WARRANTY, EXPRESS OR IMPLIED ACCOMPANIES THIS SOFTWARE. USE IT AT
+ * YOUR OWN RISK.
+ */
+#pragma once
+#include <stdint.h>
+#include <dsp/signal.h>
+
+typedef struct {
+	int				k;			/* number of filters */
+	int				r;			/* sample rate */
+	double			*freq;		/* frequency of each one */
+	double			*coef;		/* 2 cos(w), w = 2 pi freq / r */
+	double			*s1r;		/* s[n - 1], real and imaginary */
+	double			*s1i;
+	double			*s2r;		/* s[n - 2] */
+	double			*s2i;
+	int64_t			count;		/* samples since the reset */
+} goertzel_t;
+
+goertzel_t *goertzel_bank(int k, const double *freqs, int sample_rate);
+void free_goertzel_bank(goertzel_t *g);
+void goertzel_reset(goertzel_t *g);
+void goertzel_feed(goertzel_t *g, sample_buf_t *s);
+void goertzel_bins(goertzel_t *g, complex double *bins);
@@ -0,0 +1,21 @@
+/*
+ * psd.h - power spectral density estimates
+ *
+ * I hereby grant permission for anyone to use this software for any
+ * purpose that they choose, I do not warrant the software to be
+ * functional or even correct. It was written as part of an educational
+ * exercise and is not "product grade" as far as the author is concerned.
+ *
+ * NO WARRANTY, EXPRESS OR IMPLIED ACCOMPANIES THIS SOFTWARE. USE IT AT
+ * YOUR OWN RISK.
+ */
+#pragma once
+#include <dsp/signal.h>
+#include <dsp/windows.h>
+#include <dsp/threads.h>
+#include <dsp/fft.h>
+
+sample_buf_t *welch_psd(sample_buf_t *s, int bins, int overlap,
+		window_function w, double center, struct thread_pool_t *pool);
+sample_buf_t *welch_psd_into(fft_plan_t *plan, sample_buf_t *s,
+		sample_buf_t *result, int overlap, double center);
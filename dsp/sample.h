@@ -42,6 +42,8 @@ typedef complex double sample_t;
  * This is a bucket of samples, is is 'n' samples long.
  * And it represents collecting them at a rate 'r' per
  * second. So a total of n / r seconds worth of signal.
+ * 'n' is 64 bits, a long wideband recording can be well
+ * over 2^31 samples.
  */
 typedef struct __sample_buffer {
 	double			sample_min,		/* min value in buffer */
@@ -49,19 +51,190 @@ typedef struct __sample_buffer {
 	double			max_freq;		/* Maximum frequency */
 	double			center_freq;	/* Center frequency (for FFTs) */
 	double			min_freq;		/* Minimum frequency */
-	int				n;				/* number of samples */
+	int64_t			n;				/* number of samples */
 	int				r;				/* sample rate in Hz */
 	sample_buf_t_type	type;		/* type of samples */
 	struct __sample_buffer *nxt;	/* Chained buffer */
 	sample_t	*data;				/* sample data */
+	struct __buf_pool *pool;		/* pool it came from (or NULL) */
+	int				flags;			/* BUF_ALIGNED, BUF_PADDED, BUF_VIEW */
+	int				stride;			/* data[] index of sample i is i * stride */
 } sample_buf_t;
 
+/*
+ * Single precision version of the sample type. 8 bytes a sample
+ * instead of 16, which is plenty for data that came from an 8 or
+ * 12 bit ADC, and twice as many fit in a vector register.
+ */
+typedef complex float samplef_t;
+
+/*
+ * A bucket of single precision samples, the same as sample_buf_t
+ * except for the type of the data.
+ */
+typedef struct __sample_buffer_f {
+	double			sample_min,		/* min value in buffer */
+					sample_max;		/* max value in buffer */
+	double			max_freq;		/* Maximum frequency */
+	double			center_freq;	/* Center frequency (for FFTs) */
+	double			min_freq;		/* Minimum frequency */
+	int64_t			n;				/* number of samples */
+	int				r;				/* sample rate in Hz */
+	sample_buf_t_type	type;		/* type of samples */
+	struct __sample_buffer_f *nxt;	/* Chained buffer */
+	samplef_t	*data;				/* sample data */
+	int				flags;			/* BUF_ALIGNED, BUF_PADDED */
+} sample_buf_f_t;
+
+/*
+ * A bucket of samples in split complex (planar) form, the real parts
+ * in re[] and the imaginary parts in im[], rather than interleaved.
+ * Vector code can then load four real parts (or four imaginary ones)
+ * into a register as they are, without shuffling the halves of each
+ * complex value apart. Otherwise the same as sample_buf_t.
+ */
+typedef struct __sample_buffer_split {
+	double			sample_min,		/* min value in buffer */
+					sample_max;		/* max value in buffer */
+	double			max_freq;		/* Maximum frequency */
+	double			center_freq;	/* Center frequency (for FFTs) */
+	double			min_freq;		/* Minimum frequency */
+	int64_t			n;				/* number of samples */
+	int				r;				/* sample rate in Hz */
+	sample_buf_t_type	type;		/* type of samples */
+	struct __sample_buffer_split *nxt;	/* Chained buffer */
+	double			*re;			/* real parts */
+	double			*im;			/* imaginary parts */
+	int				flags;			/* BUF_ALIGNED, BUF_PADDED */
+} sample_buf_split_t;
+
+/*
+ * A bucket of integer samples, kept the way they came out of the ADC
+ * (an RTL-SDR gives 8 bit IQ, others 12 or 16 bits in 16). Each value
+ * is 'bits' (8, 16, or 32) bits, a SAMPLE_REAL_SIGNAL buffer has one
+ * value per sample and anything else an I, Q pair, so an 8 bit IQ
+ * capture is 2 bytes a sample rather than 16 as complex doubles. The
+ * values are not scaled, converted to double they are the same
+ * numbers load_signal() gives. Otherwise the same as sample_buf_t.
+ */
+typedef struct __sample_buffer_i {
+	double			sample_min,		/* min value in buffer */
+					sample_max;		/* max value in buffer */
+	double			max_freq;		/* Maximum frequency */
+	double			center_freq;	/* Center frequency (for FFTs) */
+	double			min_freq;		/* Minimum frequency */
+	int64_t			n;				/* number of samples */
+	int				r;				/* sample rate in Hz */
+	sample_buf_t_type	type;		/* type of samples */
+	struct __sample_buffer_i *nxt;	/* Chained buffer */
+	union {							/* sample data, by width */
+		void		*data;
+		int8_t		*cs8;
+		int16_t		*cs16;
+		int32_t		*cs32;
+	};
+	int				bits;			/* 8, 16, or 32 */
+	int				flags;			/* BUF_ALIGNED, BUF_PADDED */
+} sample_buf_i_t;
+
+/* number of integer values in a buffer (two per sample unless real) */
+#define buf_i_values(s)	((s)->n * (((s)->type == SAMPLE_REAL_SIGNAL) ? 1 : 2))
+
+/*
+ * Sample storage from alloc_buf() starts on a SAMPLE_ALIGN byte
+ * boundary (a cache line, and the widest vector register) and is
+ * padded out to a multiple of SAMPLE_ALIGN bytes with zeros, so
+ * vector code can load whole registers all the way to the end. The
+ * flags say which of these a buffer can promise, a buffer that
+ * points into the middle of another one promises neither.
+ */
+#define SAMPLE_ALIGN	64
+#define BUF_ALIGNED		0x1		/* data is SAMPLE_ALIGN aligned */
+#define BUF_PADDED		0x2		/* data is zero padded to SAMPLE_ALIGN */
+#define BUF_VIEW		0x4		/* data belongs to another buffer */
+
+/*
+ * Sample 'i' of a buffer. Only views (see buf_view()) have a stride
+ * other than 1.
+ */
+#define buf_sample(s, i)	((s)->data[(int64_t) (i) * (s)->stride])
+
+/* number of samples of storage, n rounded up to fill the padding */
+#define buf_padded_n(s)	((int64_t) ((((s)->n * sizeof((s)->data[0])) + \
+			SAMPLE_ALIGN - 1) / SAMPLE_ALIGN * SAMPLE_ALIGN / sizeof((s)->data[0])))
+
 /*
  * Some syntactic sugar to make this oft used code
  */
 
-#define clear_samples(s)	memset(s->data, 0, sizeof(sample_t) * s->n)
+#define clear_samples(s)	memset(s->data, 0, sizeof(s->data[0]) * s->n)
 
 /* sample buffer management */
-sample_buf_t *alloc_buf(int size, int sample_rate);
+sample_buf_t *alloc_buf(int64_t size, int sample_rate);
+sample_buf_t *alloc_buf_noclear(int64_t size, int sample_rate);
 sample_buf_t *free_buf(sample_buf_t *buf);
+
+/*
+ * A view is a buffer header over some of another buffer's samples,
+ * 'len' of them starting at 'offset', 'stride' apart. Nothing is
+ * copied, so it is only good while the parent is. free_buf() on a
+ * view frees just the header. compute_fft() (and the fft_execute
+ * functions), fir_filter(), and plot_data() follow the stride, other
+ * functions should be given views with a stride of 1.
+ */
+sample_buf_t *buf_view(sample_buf_t *parent, int64_t offset, int64_t len,
+		int stride);
+
+/*
+ * Buffer pools. Once a pool is selected, alloc_buf() on that thread
+ * takes buffers from it rather than from malloc(), and free_buf()
+ * gives them back. Buffers are kept by size class (powers of 2), so
+ * a pipeline that allocates the same sizes over and over stops
+ * calling the system allocator once it has run for a frame or two.
+ *
+ * In BUF_ARENA mode free_buf() does nothing, instead every buffer
+ * handed out goes back at once when buf_pool_reset() is called at the
+ * end of the frame.
+ */
+typedef enum {
+	BUF_POOL,			/* buffers go back when they are freed */
+	BUF_ARENA			/* buffers go back when the pool is reset */
+} buf_pool_mode;
+
+typedef struct __buf_pool buf_pool_t;
+
+buf_pool_t *buf_pool(buf_pool_mode mode);
+void free_buf_pool(buf_pool_t *pool);
+buf_pool_t *buf_pool_select(buf_pool_t *pool);
+void buf_pool_reset(buf_pool_t *pool);
+
+/* single precision sample buffers, and conversion to and from them */
+sample_buf_f_t *alloc_buf_f(int64_t size, int sample_rate);
+sample_buf_f_t *free_buf_f(sample_buf_f_t *buf);
+sample_buf_f_t *buf_to_float(sample_buf_t *buf);
+sample_buf_t *buf_from_float(sample_buf_f_t *buf);
+
+/* split complex sample buffers, and conversion to and from them */
+sample_buf_split_t *alloc_buf_split(int64_t size, int sample_rate);
+sample_buf_split_t *free_buf_split(sample_buf_split_t *buf);
+sample_buf_split_t *buf_to_split(sample_buf_t *buf);
+sample_buf_t *buf_from_split(sample_buf_split_t *buf);
+void buf_magnitude_split(sample_buf_split_t *buf, double *mag);
+
+/*
+ * Integer sample buffers, and conversion to and from them. Going to
+ * integers the values are rounded and clamped to what 'bits' bits
+ * can hold. buf_int_samples() converts 'len' samples from 'offset'
+ * on into complex doubles (buf_int_samples_f() into complex floats)
+ * without making a whole buffer of them.
+ */
+sample_buf_i_t *alloc_buf_i(int64_t size, int bits, int has_q, int sample_rate);
+sample_buf_i_t *free_buf_i(sample_buf_i_t *buf);
+sample_buf_i_t *buf_to_int(sample_buf_t *buf, int bits);
+sample_buf_t *buf_from_int(sample_buf_i_t *buf);
+sample_buf_i_t *buf_to_int_f(sample_buf_f_t *buf, int bits);
+sample_buf_f_t *buf_from_int_f(sample_buf_i_t *buf);
+void buf_int_samples(sample_buf_i_t *buf, int64_t offset, int64_t len,
+		complex double *dst);
+void buf_int_samples_f(sample_buf_i_t *buf, int64_t offset, int64_t len,
+		complex float *dst);
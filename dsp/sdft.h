@@ -0,0 +1,41 @@
+/*
+ * sdft.h - sliding DFT, a few bins updated every sample
+ *
+ * I hereby grant permission for anyone to use this software for any
+ * purpose that they choose, I do not warrant the software to be
+ * functional or even correct. It was written as part of an educational
+ * exercise and is not "product grade" as far as the author is concerned.
+ *
+ * NO WARRANTY, EXPRESS OR IMPLIED ACCOMPANIES THIS SOFTWARE. USE IT AT
+ * YOUR OWN RISK.
+ */
+#pragma once
+#include <stdint.h>
+#include <dsp/signal.h>
+#include <dsp/windows.h>
+
+typedef struct {
+	int				n;			/* DFT length (samples in the window) */
+	int				n_bins;		/* bins asked for */
+	int				*bins;		/* their indices, 0 to n - 1 */
+	window_function	window;
+	int				n_terms;	/* cosine terms in the window */
+	double			coef[4];	/* and their weights */
+	double			damping;	/* r, a bit less than 1 */
+	double			damping_n;	/* r^n */
+	int				n_track;	/* bins updated every sample */
+	int				*track;		/* which ones (the windows need neighbors) */
+	complex double	*rot;		/* e^(2 pi i k / n) for each of them */
+	complex double	*state;		/* and their current values */
+	int				*map;		/* bin i, term j -> index in track */
+	complex double	*hist;		/* the last n samples */
+	int				pos;		/* oldest sample in hist */
+	int64_t			count;		/* samples seen */
+} sdft_t;
+
+sdft_t *sdft_create(int n, const int *bins, int n_bins, window_function w,
+		double damping);
+void free_sdft(sdft_t *sd);
+void sdft_update(sdft_t *sd, sample_t x);
+void sdft_feed(sdft_t *sd, sample_buf_t *s);
+void sdft_bins(sdft_t *sd, complex double *out);
@@ -81,3 +81,7 @@ void mix_square_real(sample_buf_t *, double f, double a, double p);
 int store_signal(sample_buf_t *signal, signal_format fmt, char *filename);
 sample_buf_t *load_signal(char *filename);
 
+/* integer formats only, kept as integer samples */
+int store_signal_i(sample_buf_i_t *signal, char *filename);
+sample_buf_i_t *load_signal_i(char *filename);
+
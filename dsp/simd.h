@@ -0,0 +1,117 @@
+/*
+ * simd.h - vector (SIMD) kernels and the code that picks between them
+ *
+ * I hereby grant permission for anyone to use this software for any
+ * purpose that they choose, I do not warrant the software to be
+ * functional or even correct. It was written as part of an educational
+ * exercise and is not "product grade" as far as the author is concerned.
+ *
+ * NO WARRANTY, EXPRESS OR IMPLIED ACCOMPANIES THIS SOFTWARE. USE IT AT
+ * YOUR OWN RISK.
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <complex.h>
+
+/*
+ * Instruction set levels, in order of preference. SIMD_NONE is the
+ * plain C code and is always available.
+ */
+typedef enum {
+	SIMD_NONE,		/* scalar C */
+	SIMD_SSE2,		/* 128 bit, one complex double (two float) per register */
+	SIMD_AVX2,		/* 256 bit, two complex doubles (four float) */
+	SIMD_AVX512		/* 512 bit, four complex doubles (eight float) */
+} simd_level;
+
+/* the level in use, detected from the CPU the first time it is asked */
+simd_level simd_get_level(void);
+
+/* force a level (clamped to what the CPU has), returns the one in use */
+simd_level simd_set_level(simd_level level);
+
+/* printable name of a level */
+const char *simd_level_name(simd_level level);
+
+/*
+ * Everything the kernels work on is best aligned to this many bytes
+ * (one AVX-512 register, and a cache line). simd_aligned() says if
+ * a pointer is aligned to 'a' bytes.
+ */
+#define SIMD_ALIGN	64
+#define simd_aligned(p, a)	((((uintptr_t) (p)) & ((a) - 1)) == 0)
+
+/* SIMD_ALIGN aligned memory, free() it when done */
+void *simd_alloc(size_t bytes);
+
+/*
+ * Radix 2 butterflies over 'n' values in reflected order. 'stage_tw'
+ * holds the unit roots of each stage, the 'half' roots of the stage
+ * with 'half' butterflies per group start at [half], so W(2)^0 is at
+ * [1], W(4)^0..1 at [2], W(8)^0..3 at [4], and so on ([0] is unused).
+ * That way each stage's roots are as aligned as the table is.
+ */
+void simd_fft_butterflies(complex double *data, int n,
+		const complex double *stage_tw);
+
+/* the stages from the one with 'first' butterflies per group on */
+void simd_fft_stages(complex double *data, int n, int first,
+		const complex double *stage_tw);
+
+/* the same, on split complex data, the roots split the same way */
+void simd_fft_stages_split(double *re, double *im, int n, int first,
+		const double *stage_re, const double *stage_im);
+
+/* the same, in single precision */
+void simd_fft_butterflies_f(complex float *data, int n,
+		const complex float *stage_tw);
+
+/*
+ * Batches of frames, interleaved so that value i of frame l is at
+ * [i * lanes + l]. simd_batch_lanes() says how many frames to weave.
+ * Like simd_fft_stages() it starts at the stage with 'first'
+ * butterflies per group.
+ */
+int simd_batch_lanes(void);
+void simd_fft_butterflies_x(complex double *data, int n, int lanes, int first,
+		const complex double *stage_tw);
+
+/*
+ * One stage of fixed point butterflies, on 'n' interleaved (re, im)
+ * pairs. Each value is shifted right 'shift' bits as it is loaded,
+ * 'wre' holds this stage's roots as (re, re) pairs and 'wim' as
+ * (-im, im) pairs. Sums saturate, the number of saturated values is
+ * returned, and the largest magnitude written goes in '*peak'.
+ */
+int simd_fx_stage_q15(int16_t *data, int n, int half, const int16_t *wre,
+		const int16_t *wim, int shift, int *peak);
+int simd_fx_stage_q31(int32_t *data, int n, int half, const int32_t *wre,
+		const int32_t *wim, int shift, int64_t *peak);
+
+/*
+ * 'k' Goertzel filters over 'n' samples, see goertzel.c. The states
+ * are split into real and imaginary arrays and updated in place.
+ */
+void simd_goertzel(const double *coef, double *s1r, double *s1i, double *s2r,
+		double *s2i, int k, const complex double *x, int64_t n);
+
+/*
+ * Kernels for split complex buffers. Real FIR taps filter the real
+ * and imaginary parts separately, as do real windows.
+ */
+void simd_fir_real(const double *x, int64_t n, const double *taps, int n_taps,
+		double *y);
+void simd_mul_real(double *x, const double *w, int64_t n);
+void simd_magnitude_split(const double *re, const double *im, int64_t n,
+		double *mag);
+
+/*
+ * Conversions for integer sample buffers, 'n' values of 'bits' (8,
+ * 16, or 32) bits each. To integers the values are clamped to the
+ * integer's range and rounded to the nearest one.
+ */
+void simd_int_to_double(const void *x, int bits, int64_t n, double *y);
+void simd_int_to_float(const void *x, int bits, int64_t n, float *y);
+void simd_double_to_int(const double *x, int64_t n, int bits, void *y);
+void simd_float_to_int(const float *x, int64_t n, int bits, void *y);
@@ -0,0 +1,54 @@
+/*
+ * stft.h - streaming short time Fourier transform (waterfall rows)
+ *
+ * I hereby grant permission for anyone to use this software for any
+ * purpose that they choose, I do not warrant the software to be
+ * functional or even correct. It was written as part of an educational
+ * exercise and is not "product grade" as far as the author is concerned.
+ *
+ * NO WARRANTY, EXPRESS OR IMPLIED ACCOMPANIES THIS SOFTWARE. USE IT AT
+ * YOUR OWN RISK.
+ */
+#pragma once
+#include <stdint.h>
+#include <dsp/signal.h>
+#include <dsp/windows.h>
+#include <dsp/fft.h>
+
+/* what goes in each output row */
+typedef enum {
+	STFT_MAGNITUDE,		/* |X[k]|, RMS over the averaged frames */
+	STFT_DB				/* 20 log10 of the same */
+} stft_output;
+
+/*
+ * The state of a running STFT. Samples are fed in whatever sized
+ * pieces they arrive in, every 'hop' samples a 'bins' point windowed
+ * FFT is taken of the latest 'bins' samples, and every 'average' of
+ * those make one row of the waterfall. The last 'n_rows' rows are
+ * kept in a ring, so a display can redraw from them.
+ */
+typedef struct {
+	fft_plan_t		*plan;		/* the FFT (and its window) */
+	int				bins;		/* FFT size */
+	int				hop;		/* samples from one FFT to the next */
+	int				average;	/* FFTs per row */
+	stft_output		output;		/* magnitude or dB */
+	complex double	*hist;		/* the last 'fill' samples */
+	int				fill;		/* how many are in hist */
+	int				skip;		/* samples to drop (hop > bins) */
+	complex double	*work;		/* the FFT being computed */
+	double			*acc;		/* summed |X[k]|^2 for this row */
+	int				n_acc;		/* FFTs summed so far */
+	double			*rows;		/* n_rows rows of 'bins' values */
+	int				n_rows;		/* rows in the ring */
+	uint64_t		row_count;	/* rows computed since the start */
+	int				r;			/* sample rate of the stream */
+} stft_t;
+
+stft_t *stft_create(int bins, int hop, window_function window, int average,
+		stft_output output, int n_rows);
+void free_stft(stft_t *st);
+int stft_feed(stft_t *st, sample_buf_t *s);
+double *stft_row(stft_t *st, int age);
+void stft_reset(stft_t *st);
@@ -0,0 +1,50 @@
+/*
+ * stream.h - a ring buffer of samples, for continuous processing
+ *
+ * I hereby grant permission for anyone to use this software for any
+ * purpose that they choose, I do not warrant the software to be
+ * functional or even correct. It was written as part of an educational
+ * exercise and is not "product grade" as far as the author is concerned.
+ *
+ * NO WARRANTY, EXPRESS OR IMPLIED ACCOMPANIES THIS SOFTWARE. USE IT AT
+ * YOUR OWN RISK.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdatomic.h>
+#include <dsp/signal.h>
+
+/*
+ * A stream is 'size' (a power of 2) samples in a ring, plus a mirror
+ * of the first 'window' of them after the end. Any run of up to
+ * 'window' samples is then adjacent in memory wherever it starts, so
+ * it can be handed to the transforms as a view, with no copy. The
+ * cursors count samples since the start and are only ever increased,
+ * 'head' by the producer and 'tail' by the consumer, so one thread
+ * can write while another reads.
+ */
+typedef struct {
+	int				size;		/* samples in the ring, a power of 2 */
+	int				mask;		/* size - 1 */
+	int				window;		/* longest run that is always contiguous */
+	int				r;			/* sample rate */
+	sample_buf_t_type	type;	/* type given to the windows */
+	sample_t		*data;		/* size + window samples */
+	_Atomic int64_t	head;		/* samples written */
+	_Atomic int64_t	tail;		/* samples consumed */
+} stream_t;
+
+stream_t *stream_create(int size, int window, int sample_rate,
+		sample_buf_t_type type);
+void free_stream(stream_t *st);
+
+/* producer side */
+int stream_space(stream_t *st);
+int stream_write(stream_t *st, const sample_t *x, int n);
+int stream_write_buf(stream_t *st, sample_buf_t *s);
+
+/* consumer side */
+int stream_available(stream_t *st);
+sample_buf_t *stream_window(stream_t *st, sample_buf_t *view, int offset,
+		int len);
+void stream_consume(stream_t *st, int n);
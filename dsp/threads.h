@@ -0,0 +1,37 @@
+/*
+ * threads.h - a small pool of worker threads
+ *
+ * I hereby grant permission for anyone to use this software for any
+ * purpose that they choose, I do not warrant the software to be
+ * functional or even correct. It was written as part of an educational
+ * exercise and is not "product grade" as far as the author is concerned.
+ *
+ * NO WARRANTY, EXPRESS OR IMPLIED ACCOMPANIES THIS SOFTWARE. USE IT AT
+ * YOUR OWN RISK.
+ */
+#pragma once
+
+/*
+ * A task function is called once for each task number, 0 through
+ * n_tasks - 1. 'worker' says which thread is running it (0 through
+ * the pool size - 1) so the task can use per thread scratch space.
+ */
+typedef void (*thread_task_t)(void *arg, int task, int worker);
+
+struct thread_pool_t;
+
+/* create a pool of 'n' threads, 0 means one per CPU */
+struct thread_pool_t *thread_pool(int n);
+
+/* number of workers in the pool (1 for a NULL pool) */
+int thread_pool_size(struct thread_pool_t *pool);
+
+/*
+ * Run all of the tasks and wait for them to finish. A NULL pool
+ * runs them, in order, on the calling thread as worker 0.
+ */
+void thread_pool_run(struct thread_pool_t *pool, int n_tasks,
+		thread_task_t task, void *arg);
+
+/* stop the threads and release the pool */
+void free_thread_pool(struct thread_pool_t *pool);
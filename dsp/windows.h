@@ -23,12 +23,24 @@ typedef enum
 } window_function;
 
 /* prototypes */
+const double *window_table(window_function w, int n);
+const float *window_table_f(window_function w, int n);
+void window_cache_flush(void);
+
 double hann_window_function(int k, int N);
 void hann_window_buffer(sample_buf_t *b, int bins);
+void hann_window_buffer_f(sample_buf_f_t *b, int bins);
+void hann_window_buffer_split(sample_buf_split_t *b, int bins);
 
 double bh_window_function(int k, int N);
 void bh_window_buffer(sample_buf_t *b, int bins);
+void bh_window_buffer_f(sample_buf_f_t *b, int bins);
+void bh_window_buffer_split(sample_buf_split_t *b, int bins);
 
 double rect_window_function(int k, int N);
 void rect_window_buffer(sample_buf_t *b, int bins);
+void rect_window_buffer_f(sample_buf_f_t *b, int bins);
+void rect_window_buffer_split(sample_buf_split_t *b, int bins);
 
+/* the window as a sum of cosines, returns the number of terms (<= 4) */
+int window_cosine_terms(window_function w, double *coef);
@@ -292,7 +292,7 @@ int main(int argc, char *argv[]) {
 	if (data3 == NULL) {
 		fprintf(stderr, "Failure to allocate data 2\n");
 	}
-	printf("Data buffers are %d samples long\n", data1->n);
+	printf("Data buffers are %lld samples long\n", (long long) data1->n);
 
 	/* fill data 2 with 'known good data' */
 	add_cos(data2, tone, MAX_AMPLITUDE, 0);
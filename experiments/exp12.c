@@ -110,7 +110,7 @@ main(int argc, char *argv[])
 	fprintf(of, "High Level:1.0\n");
 	fprintf(of, "Low Level:-1.0\n");
 	fprintf(of, "Data Type:short\n");
-	fprintf(of, "Data Points:%d\n", wave->n);
+	fprintf(of, "Data Points:%lld\n", (long long) wave->n);
 
 	wave->sample_max = wave->sample_min = 0;
 
@@ -95,9 +95,7 @@ cvt2analytic(sample_buf_t *sig, int bins)
 {
 	sample_buf_t *res = alloc_buf(sig->n, sig->r);
 	sample_buf_t *fft_chain = NULL;
-	sample_buf_t *chunk = alloc_buf(bins, sig->r);
 	sample_buf_t *prev, *cur;
-	chunk->type = SAMPLE_SIGNAL;
 	int nfft = 0;
 
 	printf("Convert real->analytic using %d bin FFTs\n", bins);
@@ -110,14 +108,17 @@ cvt2analytic(sample_buf_t *sig, int bins)
 	nfft = 0;
 	printf("Generate FFT ..");
 	for (int k = 0; (k + bins) < sig->n; k += bins) {
-		sample_buf_t *ftmp;
+		sample_buf_t *ftmp, *chunk;
 
-		/* Grab bins worth of sample buffer */
+		/* Look at bins worth of sample buffer (no copy) */
 		printf(".[%d]..", nfft++);
-		for (int m = 0; m < bins; m++) {
-			chunk->data[m] = sig->data[k + m];
+		chunk = buf_view(sig, k, bins, 1);
+		if (chunk == NULL) {
+			exit(1);
 		}
+		chunk->type = SAMPLE_SIGNAL;
 		ftmp = compute_fft(chunk, bins, W_RECT, 0);
+		free_buf(chunk);
 		if (ftmp == NULL) {
 			exit(1);
 		}
@@ -151,7 +152,7 @@ cvt2analytic(sample_buf_t *sig, int bins)
 	 * to signal and then copy that chunk into the result buffer.
 	 */
 	printf("Inverting ..");
-	int k = 0;
+	int64_t k = 0;
 	nfft = 0;
 	for (sample_buf_t *t = fft_chain; t; t = t->nxt) {
 		sample_buf_t *q = compute_ifft(t);
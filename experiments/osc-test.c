@@ -165,7 +165,7 @@ int main(int argc, char *argv[]) {
 	 * and quadrature phase part to look at it.
 	 */
 	error_sig = alloc_buf(BINS, SAMPLE_RATE);
-	printf("Data buffers are %d samples long\n", data1->n);
+	printf("Data buffers are %lld samples long\n", (long long) data1->n);
 
 	/* fill data 2 with 'known good data' */
 	add_cos(data2, tone, MAX_AMPLITUDE, 0);
@@ -258,8 +258,8 @@ int main(int argc, char *argv[]) {
 		data3->data[i] = creal(data2->data[i]) + I * (creal(data1->data[i]));
 	}
 	printf("]\nDone Generating\n");
-	printf("Total %d adjustments in %d samples, samples/adjustment = %f\n",
-		adjustments, data1->n, (double)(data1->n) / (double) adjustments);
+	printf("Total %d adjustments in %lld samples, samples/adjustment = %f\n",
+		adjustments, (long long) data1->n, (double)(data1->n) / (double) adjustments);
 	/* Checking for a DC component */
 	{
 		int dc_i = 0, dc_q = 0;
@@ -283,7 +283,7 @@ main(int argc, char *argv[]) {
 		fprintf(stderr, "Failure to allocate data 2\n");
 	}
 	error_sig = alloc_buf(SAMPLE_RATE, SAMPLE_RATE);
-	printf("Data buffers are %d samples long\n", data1->n);
+	printf("Data buffers are %lld samples long\n", (long long) data1->n);
 
 	/* fill data 2 with 'known good data' */
 	add_cos(data2, tone, OSC_AMPLITUDE, 270);
@@ -406,8 +406,8 @@ main(int argc, char *argv[]) {
 		data3->data[i] = creal(data1->data[i]) + I * (creal(data2->data[i]));
 	}
 	printf("]\nDone Generating\n");
-	printf("Total %d adjustments in %d samples, samples/adjustment = %f\n",
-		adjustments, data1->n, (double)(data1->n) / (double) adjustments);
+	printf("Total %d adjustments in %lld samples, samples/adjustment = %f\n",
+		adjustments, (long long) data1->n, (double)(data1->n) / (double) adjustments);
 	double period_len = (double) zc_sample / (double) sample_rate;
 	measured_freq = (double) zero_crossings / (2.0 * period_len);
 	printf("     Zero crossings: %d\n", zero_crossings);
@@ -67,7 +67,7 @@ cic_decimate(sample_buf_t *inp, struct cic_filter_t *cic)
 {
 	sample_buf_t	*res;
 	int				xn, ndx = 0;
-	uint32_t		res_ndx = 0; /* index into sample buffers */
+	int64_t			res_ndx = 0; /* index into sample buffers */
 
 	/* allocate a buffer that is one n'th of the input buffer at a
  	 * sample rate that is also one n'th.
@@ -77,7 +77,7 @@ cic_decimate(sample_buf_t *inp, struct cic_filter_t *cic)
 		return NULL;
 	}
 
-	for (int i = 0; i < inp->n; i ++) {
+	for (int64_t i = 0; i < inp->n; i ++) {
 		cic->iter = (cic->iter + 1) % cic->r; /* count this iteration */
 		/* Run through each stage */
 		for (int k = 0; k < cic->n; k++) {
@@ -0,0 +1,235 @@
+/*
+ * czt.c - the chirp-z transform, for zooming in on part of a spectrum
+ *
+ * I hereby grant permission for anyone to use this software for any
+ * purpose that they choose, I do not warrant the software to be
+ * functional or even correct. It was written as part of an educational
+ * exercise and is not "product grade" as far as the author is concerned.
+ *
+ * NO WARRANTY, EXPRESS OR IMPLIED ACCOMPANIES THIS SOFTWARE. USE IT AT
+ * YOUR OWN RISK.
+ *
+ * The DFT evaluates the z transform of the samples at N points spread
+ * evenly around the unit circle. The chirp-z transform evaluates it at
+ * M points spread along any arc of it, so you can put all M bins
+ * between two frequencies of interest and see that band in as much
+ * detail as you like. It is the same trick the Bluestein FFT uses
+ * (see fft.c), with
+ *
+ *     X[k] = sum( x[t] * A^-t * W^(t * k) )
+ *
+ * where A is the start of the arc and W the step from bin to bin,
+ * and t * k = (t^2 + k^2 - (k - t)^2) / 2, this becomes
+ *
+ *     X[k] = W^(k^2 / 2) * sum( (x[t] * A^-t * W^(t^2 / 2)) * W^(-(k - t)^2 / 2) )
+ *
+ * which is a convolution, done with power of 2 FFTs in
+ * O((N + M) log(N + M)) rather than the O(N * M) of the DFT.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <complex.h>
+#include <dsp/signal.h>
+#include <dsp/windows.h>
+#include <dsp/fft.h>
+#include <dsp/czt.h>
+
+/*
+ * e^(i * pi * a * j^2), 'a' being the bin step over the sample rate.
+ * j^2 gets big fast, so it is done in integers and the angle (in
+ * units of pi) is reduced modulo 2 in long double before the cosine
+ * and sine ever see it.
+ */
+static complex double
+czt_chirp(long double a, long long j)
+{
+	long double angle = fmodl(a * (long double) (j * j), 2.0L);
+
+	return cexp(I * M_PI * (double) angle);
+}
+
+/*
+ * free_czt_plan( ... )
+ *
+ * Release a plan built by czt_plan().
+ */
+void
+free_czt_plan(czt_plan_t *plan)
+{
+	if (plan == NULL) {
+		return;
+	}
+	free(plan->pre);
+	free(plan->post);
+	free(plan->h_fft);
+	free(plan->work);
+	free_fft_plan(plan->fft);
+	free(plan);
+}
+
+/*
+ * czt_plan( ... )
+ *
+ * Plan a zoom of 'n' samples into 'bins' bins. The frequency
+ * arguments are the same as for compute_dft(): a center of 0 means
+ * half the sample rate (a span of 0 to the sample rate), and start
+ * and end frequencies of 0 mean the bottom and top of the span. The
+ * bins are at start + k * (end - start) / bins, so with the defaults
+ * they are the DFT's bins. For IQ data (a center other than 0) the
+ * center frequency is at baseband DC, so the zoom starts fs - center
+ * around the circle, for real data it starts fs around it.
+ */
+czt_plan_t *
+czt_plan(int n, int bins, window_function w, int sample_rate, double center,
+		 double fs, double fe)
+{
+	czt_plan_t *plan;
+	double	span = sample_rate;
+	double	low, base;
+	long double step;
+	const double *win;
+	int		l;
+
+	if ((n < 1) || (bins < 1)) {
+		fprintf(stderr, "czt_plan: need at least one sample and one bin\n");
+		return NULL;
+	}
+	/* the frequency that is at DC in the samples */
+	base = (center == 0) ? 0 : center;
+	center = (center == 0) ? (span / 2.0) : center;
+	low = center - span / 2.0;
+	fs = (fs == 0) ? low : fs;
+	fe = (fe == 0) ? center + span / 2.0 : fe;
+	if ((fs < low) || (fe > (center + span / 2.0)) || (fe <= fs)) {
+		fprintf(stderr, "CZT Frequencies of interest are outside of span.\n");
+		return NULL;
+	}
+
+	for (l = 1; l < n + bins - 1; l <<= 1) ;
+	plan = calloc(1, sizeof(czt_plan_t));
+	if (plan == NULL) {
+		return NULL;
+	}
+	plan->n = n;
+	plan->m = bins;
+	plan->l = l;
+	plan->window = w;
+	plan->r = sample_rate;
+	plan->center = center;
+	plan->start = fs;
+	plan->end = fe;
+	plan->pre = malloc(sizeof(complex double) * n);
+	plan->post = malloc(sizeof(complex double) * bins);
+	plan->h_fft = calloc(l, sizeof(complex double));
+	plan->work = malloc(sizeof(complex double) * l);
+	plan->fft = fft_plan(l, W_RECT);
+	win = window_table(w, n);
+	if ((plan->pre == NULL) || (plan->post == NULL) || (win == NULL) ||
+		(plan->h_fft == NULL) || (plan->work == NULL) || (plan->fft == NULL)) {
+		fprintf(stderr, "czt_plan: out of memory\n");
+		free_czt_plan(plan);
+		return NULL;
+	}
+
+	/* W = e^(-2 pi i step), so W^(j^2 / 2) = e^(-i pi step j^2) */
+	step = ((long double) fe - fs) / ((long double) bins * span);
+	for (int t = 0; t < n; t++) {
+		/* A^-t = e^(-2 pi i t (start - base) / span) */
+		double a = 2.0 * M_PI *
+				(double) fmodl(((long double) fs - base) * t / span, 1.0L);
+		plan->pre[t] = win[t] * cexp(-I * a) * conj(czt_chirp(step, t));
+	}
+	for (int k = 0; k < bins; k++) {
+		plan->post[k] = conj(czt_chirp(step, k));
+	}
+	/* the filter, indexed by k - t, which runs from -(n - 1) to m - 1 */
+	for (int j = 0; j < bins; j++) {
+		plan->h_fft[j] = czt_chirp(step, j);
+	}
+	for (int j = 1; j < n; j++) {
+		plan->h_fft[l - j] = czt_chirp(step, j);
+	}
+	fft_transform(plan->fft, plan->h_fft);
+	for (int j = 0; j < l; j++) {
+		plan->h_fft[j] /= (double) l;
+	}
+	return plan;
+}
+
+/*
+ * czt_execute( ... )
+ *
+ * Zoom into the first plan->n samples of 's' (zero padded if there
+ * are fewer) and return the bins in a new buffer.
+ */
+sample_buf_t *
+czt_execute(czt_plan_t *plan, sample_buf_t *s)
+{
+	sample_buf_t *res;
+	complex double *w = plan->work;
+
+	res = alloc_buf_noclear(plan->m, plan->r);
+	if (res == NULL) {
+		return NULL;
+	}
+	if (res->n != plan->m) {
+		free_buf(res);
+		return NULL;
+	}
+	for (int t = 0; t < plan->n; t++) {
+		w[t] = (t < s->n) ? s->data[t] * plan->pre[t] : 0;
+	}
+	memset(w + plan->n, 0, sizeof(complex double) * (plan->l - plan->n));
+	fft_transform(plan->fft, w);
+
+	/* the inverse FFT of Y * H is conj(FFT(conj(Y * H))), 1/l is in H */
+	for (int j = 0; j < plan->l; j++) {
+		w[j] = conj(w[j] * plan->h_fft[j]);
+	}
+	fft_transform(plan->fft, w);
+	for (int k = 0; k < plan->m; k++) {
+		res->data[k] = plan->post[k] * conj(w[k]);
+	}
+
+	res->type = SAMPLE_DFT;
+	res->center_freq = plan->center;
+	res->min_freq = plan->start;
+	res->max_freq = plan->end;
+	reset_minmax(res);
+	for (int k = 0; k < res->n; k++) {
+		set_minmax(res, k);
+	}
+	return res;
+}
+
+/*
+ * compute_czt( ... )
+ *
+ * Zoom into all of the samples in 's', with 'bins' bins between the
+ * start and end frequencies. The arguments are the same as for
+ * compute_dft().
+ */
+sample_buf_t *
+compute_czt(sample_buf_t *s, int bins, window_function w, double center,
+			double fs, double fe)
+{
+	czt_plan_t *plan;
+	sample_buf_t *res;
+
+	if (s->n > INT_MAX) {
+		fprintf(stderr, "compute_czt: %lld samples is too many for one plan\n",
+				(long long) s->n);
+		return NULL;
+	}
+	plan = czt_plan((int) s->n, bins, w, s->r, center, fs, fe);
+	if (plan == NULL) {
+		return NULL;
+	}
+	res = czt_execute(plan, s);
+	free_czt_plan(plan);
+	return res;
+}
@@ -53,8 +53,8 @@ usage(void)
 	"  -f {sample|norm} -- set frequency scale to normalize (-Fs/2 to Fs/2)\n"
 	"                      or by sample frequency.\n"
 	"         -s <rate> -- Set the sample rate to <rate> Hz.\n"
-	"      -a {fft|dft} -- Algorithm to use, fft is faster but requires\n"
-	"                      the number of bins to be a power of 2\n"
+	"      -a {fft|dft} -- Algorithm to use, fft is faster and works\n"
+	"                      with any number of bins\n"
 	"         -b <bins> -- Use <bins> bins for the transform.\n"
 	" -w {bh|hann|rect} -- Window function, choices are Blackman-Harris,\n"
 	"                      Hann, or rectangle.\n"
@@ -76,7 +76,6 @@ main(int argc, char *argv[])
 	int ampl = USE_DB_AMPLITUDE;
 	int bins = BINS;
 	int	n_freqs;
-	double	t;
 	double	*freqs;
 	FILE	*of;
 	char	filename[128];
@@ -202,13 +201,6 @@ main(int argc, char *argv[])
 	for (int i = 0; i < n_freqs; i++) {
 		add_cos(sig, freqs[i], 1.0, 0);
 	}
-	if (algo == USE_FFT) {
-		t = log(bins) / log(2);
-		if (modf(t, &t) > 0) {
-			fprintf(stderr, "Warning: FFT needs a power of 2 number of bins, %d specfied, using DFT instead.\n", bins);
-			algo = USE_DFT;
-		}
-	}
 	switch (algo) {
 		case USE_FFT:
 			ft = compute_fft(sig, bins, wf, 0);
@@ -38,6 +38,9 @@
 #include <dsp/windows.h>
 #include <dsp/dft.h>
 #include <dsp/fft.h>
+#include <dsp/czt.h>
+#include <dsp/goertzel.h>
+#include <dsp/sdft.h>
 #include <dsp/plot.h>
 
 #define BINS 1024
@@ -45,6 +48,216 @@
 
 #define PLOT_FILE "plots/dft-test.plot"
 
+/* IQ regression checks, a tone TONE Hz above a CENTER Hz center */
+#define CENTER	1000000.0
+#define TONE	1000.0
+
+/*
+ * check_iq_czt( ... )
+ *
+ * Zoom in on the IQ tone with the CZT, 1 Hz bins from 500 to 1500 Hz
+ * above the center, and check that the peak lands on the tone the FFT
+ * finds, at the same height.
+ */
+static int
+check_iq_czt(sample_buf_t *iq)
+{
+	sample_buf_t	*fft, *czt;
+	double	rbw = (double) iq->r / BINS;
+	double	fft_freq, czt_freq;
+	int		fk = 0, ck = 0;
+	int		bad;
+
+	fft = compute_fft(iq, BINS, W_RECT, CENTER);
+	czt = compute_czt(iq, 1000, W_RECT, CENTER, CENTER + 500.0, CENTER + 1500.0);
+	if ((fft == NULL) || (czt == NULL)) {
+		return 1;
+	}
+	for (int k = 0; k < BINS; k++) {
+		fk = (cabs(fft->data[k]) > cabs(fft->data[fk])) ? k : fk;
+	}
+	for (int k = 0; k < 1000; k++) {
+		ck = (cabs(czt->data[k]) > cabs(czt->data[ck])) ? k : ck;
+	}
+	fft_freq = CENTER + ((fk < BINS / 2) ? fk : fk - BINS) * rbw;
+	czt_freq = CENTER + 500.0 + ck;
+	bad = (fabs(fft_freq - czt_freq) > 1.0) ||
+		  (fabs(cabs(czt->data[ck]) - cabs(fft->data[fk])) >
+		   1e-6 * cabs(fft->data[fk]));
+	printf("IQ zoom peak at %.0f Hz, FFT peak at %.0f Hz\n", czt_freq, fft_freq);
+	free_buf(fft);
+	free_buf(czt);
+	return bad;
+}
+
+/*
+ * check_iq_band( ... )
+ *
+ * With a center frequency the data is IQ, bin 0 is the center and the
+ * top half of the bins are below it. A DFT limited to the band from
+ * 'lo' to 'hi' has to match the full DFT in the bins inside the band
+ * (even when it wraps through the center) and be zero outside it.
+ * Returns the number of bins that are wrong.
+ */
+static int
+check_iq_band(sample_buf_t *iq, double lo, double hi)
+{
+	sample_buf_t	*full, *band;
+	double	rbw = (double) iq->r / BINS;
+	long	k_lo = lround((lo - CENTER) / rbw);
+	long	k_hi = lround((hi - CENTER) / rbw);
+	int		bad = 0;
+
+	full = compute_dft(iq, BINS, W_RECT, CENTER, 0, 0);
+	band = compute_dft(iq, BINS, W_RECT, CENTER, lo, hi);
+	if ((full == NULL) || (band == NULL)) {
+		return BINS;
+	}
+	for (int k = 0; k < BINS; k++) {
+		long off = (k < BINS / 2) ? k : k - BINS;
+		int in_band = (off >= k_lo) && (off <= k_hi);
+		double want = (in_band) ? cabs(full->data[k]) : 0;
+
+		if (fabs(cabs(band->data[k]) - want) > 1e-9 * BINS) {
+			bad++;
+		}
+	}
+	printf("IQ band %.0f to %.0f Hz: %d bad bins\n", lo, hi, bad);
+	free_buf(full);
+	free_buf(band);
+	return bad;
+}
+
+/*
+ * check_goertzel( ... )
+ *
+ * A Goertzel filter at a bin's frequency, run over BINS samples, has
+ * to give the same value as that DFT bin, however the samples are
+ * split up when they are fed to it. Off the bin centers it is the sum
+ * of x[n] e^(-i w n), so check one of those against the sum itself.
+ * Returns the number of filters that are wrong.
+ */
+static int
+check_goertzel(sample_buf_t *s)
+{
+	double	rbw = (double) s->r / BINS;
+	int		on[] = { 0, 1, 100, 175, 300, 350, 511 };
+	int		n_on = sizeof(on) / sizeof(on[0]);
+	double	freqs[8];
+	complex double	bins[8], whole[8];
+	complex double	sum = 0;
+	sample_buf_t	*dft, *piece;
+	goertzel_t		*g;
+	int		bad = 0;
+
+	for (int i = 0; i < n_on; i++) {
+		freqs[i] = on[i] * rbw;
+	}
+	/* falls between bins 123 and 124 */
+	freqs[n_on] = 1234.5;
+	g = goertzel_bank(n_on + 1, freqs, s->r);
+	dft = compute_dft(s, BINS, W_RECT, 0, 0, 0);
+	if ((g == NULL) || (dft == NULL)) {
+		return n_on + 1;
+	}
+
+	/* in uneven pieces, then all at once after a reset */
+	for (int off = 0, len = 1; off < BINS; off += len, len = len * 3 + 1) {
+		piece = buf_view(s, off, (off + len > BINS) ? BINS - off : len, 1);
+		if (piece == NULL) {
+			return n_on + 1;
+		}
+		goertzel_feed(g, piece);
+		free_buf(piece);
+	}
+	goertzel_bins(g, bins);
+	goertzel_reset(g);
+	piece = buf_view(s, 0, BINS, 1);
+	if (piece == NULL) {
+		return n_on + 1;
+	}
+	goertzel_feed(g, piece);
+	free_buf(piece);
+	goertzel_bins(g, whole);
+
+	for (int i = 0; i < n_on; i++) {
+		if ((cabs(bins[i] - dft->data[on[i]]) > 1e-9 * BINS) ||
+			(cabs(whole[i] - bins[i]) > 1e-9 * BINS)) {
+			bad++;
+		}
+	}
+	for (int t = 0; t < BINS; t++) {
+		sum += s->data[t] * cexp(-2.0 * M_PI * I * freqs[n_on] * t / s->r);
+	}
+	if ((cabs(bins[n_on] - sum) > 1e-9 * BINS) ||
+		(cabs(whole[n_on] - bins[n_on]) > 1e-9 * BINS)) {
+		bad++;
+	}
+	printf("Goertzel bank against DFT bins: %d bad filters\n", bad);
+	free_goertzel_bank(g);
+	free_buf(dft);
+	return bad;
+}
+
+/*
+ * check_sdft( ... )
+ *
+ * After every sample the sliding DFT has to match a DFT of the last
+ * 'n' samples, oldest first, with each one weighted by damping^age.
+ * Returns the number of windows that are wrong.
+ */
+static int
+check_sdft(int n, window_function w, double damping)
+{
+	const char	*names[] = { "rectangular", "Hann", "Blackman-Harris" };
+	int		bins[] = { 0, 1, 5, n / 2, n - 1 };
+	int		n_bins = sizeof(bins) / sizeof(bins[0]);
+	complex double	out[5];
+	sample_buf_t	*s, *last, *dft;
+	sdft_t	*sd;
+	int		bad = 0;
+
+	s = alloc_buf(5 * n, SAMPLE_RATE);
+	last = alloc_buf(n, SAMPLE_RATE);
+	sd = sdft_create(n, bins, n_bins, w, damping);
+	if ((s == NULL) || (last == NULL) || (sd == NULL)) {
+		return 5 * n;
+	}
+	srand(n);
+	for (int t = 0; t < s->n; t++) {
+		s->data[t] = (rand() / (double) RAND_MAX - 0.5) +
+					 (rand() / (double) RAND_MAX - 0.5) * I;
+	}
+	for (int t = 0; t < s->n; t++) {
+		double err = 0;
+
+		sdft_update(sd, s->data[t]);
+		if (t < n - 1) {
+			continue;
+		}
+		for (int j = 0; j < n; j++) {
+			last->data[j] = s->data[t - n + 1 + j] * pow(damping, n - 1 - j);
+		}
+		dft = compute_dft(last, n, w, 0, 0, 0);
+		if (dft == NULL) {
+			return 5 * n;
+		}
+		sdft_bins(sd, out);
+		for (int i = 0; i < n_bins; i++) {
+			double e = cabs(out[i] - dft->data[bins[i]]);
+			err = (e > err) ? e : err;
+		}
+		bad += (err > 1e-10 * n);
+		free_buf(dft);
+	}
+	printf("Sliding DFT, %d samples, %s, damping %g: %d bad windows\n",
+			n, names[w], damping, bad);
+	free_sdft(sd);
+	free_buf(last);
+	free_buf(s);
+	return bad;
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -52,8 +265,10 @@ main(int argc, char *argv[])
 	sample_buf_t	*dft;
 	sample_buf_t	*fft;
 	FILE			*pf;
+	sample_buf_t	*iq;
 	window_function wf = W_RECT;
 	int bins = BINS;
+	int bad;
 
 	printf("Running a simple DFT test\n");
 
@@ -74,8 +289,8 @@ main(int argc, char *argv[])
 	add_cos(test, 3000.0, 1.0, 0); 	// 3 kHz
 	add_cos(test, 3500.0, 1.0, 0); 	// 3 kHz
 
-	/* Now compute the DFT */
-	dft = compute_dft(test, bins, wf, 0, 0, 4096);
+	/* Now compute the DFT, over the whole span so the plot has every bin */
+	dft = compute_dft(test, bins, wf, 0, 0, 0);
 	fft = compute_fft(test, bins, wf, 0);
 
 	if (! dft) {
@@ -96,5 +311,40 @@ main(int argc, char *argv[])
 	plot(pf, "FFT Test Data", "fft", PLOT_X_REAL_FREQUENCY, PLOT_Y_DB);
 	multiplot_end(pf);
 	fclose(pf);
+
+	if (check_goertzel(test)) {
+		fprintf(stderr, "Goertzel bank does not match the DFT\n");
+		exit(1);
+	}
+	bad = 0;
+	for (int d = 0; d < 2; d++) {
+		bad += check_sdft(64, W_RECT, (d) ? 0.999 : 1.0);
+		bad += check_sdft(64, W_HANN, (d) ? 0.999 : 1.0);
+		bad += check_sdft(64, W_BH, (d) ? 0.999 : 1.0);
+	}
+	if (bad) {
+		fprintf(stderr, "Sliding DFT does not match the DFT\n");
+		exit(1);
+	}
+
+	/* band limited DFTs of IQ data, one side of the center and across it */
+	iq = alloc_buf(BINS, SAMPLE_RATE);
+	if (iq == NULL) {
+		fprintf(stderr, "Unable to allocate the IQ test buffer\n");
+		exit(1);
+	}
+	iq->type = SAMPLE_SIGNAL;
+	add_cos(iq, TONE, 1.0, 0);
+	bad = check_iq_band(iq, CENTER + 500.0, CENTER + 1500.0);
+	bad += check_iq_band(iq, CENTER - 1500.0, CENTER + 1500.0);
+	if (bad) {
+		fprintf(stderr, "IQ band limited DFT does not match the full DFT\n");
+		exit(1);
+	}
+	if (check_iq_czt(iq)) {
+		fprintf(stderr, "IQ zoom does not match the FFT\n");
+		exit(1);
+	}
+	free_buf(iq);
 	printf("Done.\n");
 }
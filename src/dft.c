@@ -17,24 +17,79 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 #include <complex.h>
 #include <string.h>
 #include <dsp/sample.h>
 #include <dsp/signal.h>
 #include <dsp/windows.h>
+#include <dsp/threads.h>
 #include <dsp/dft.h>
 
+/*
+ * What each thread needs to compute its share of the bins.
+ */
+struct dft_job {
+	complex double	*x;		/* windowed samples */
+	int				n_x;	/* how many of them aren't zero */
+	complex double	*tw;	/* e^(-2 pi i m / bins), m = 0 .. bins - 1 */
+	int				bins;
+	int				first;	/* the bins to compute */
+	int				last;
+	int				n_tasks;
+	complex double	*out;
+};
+
+/*
+ * Each task computes a run of the bins. The angle for sample 't' of
+ * bin 'k' is 2 pi t k / bins, which is the same as 2 pi m / bins
+ * where m = t * k mod bins, so the table lookup just steps 'm' by 'k'
+ * each sample and wraps it. No trig at all in the inner loop.
+ */
+static void
+dft_task(void *arg, int task, int worker)
+{
+	struct dft_job *job = arg;
+	int span = job->last - job->first + 1;
+	int first = job->first + (int) ((long long) span * task / job->n_tasks);
+	int last = job->first + (int) ((long long) span * (task + 1) / job->n_tasks);
+
+	(void) worker;
+	for (int k = first; k < last; k++) {	// for each bin
+		sample_t x = 0;
+		int m = 0;
+		for (int t = 0; t < job->n_x; t++) { // for each sample
+			x += job->x[t] * job->tw[m];
+			m += k;
+			if (m >= job->bins) {
+				m -= job->bins;
+			}
+		}
+		job->out[k] = x;
+	}
+}
+
 /* 
- *  compute_dft(...)
+ *  compute_dft_threads(...)
  *
  *  This computes a discrete fourier transform, it can use any number
- *  of bins. (the FFT requires a power of 2) It exploits the speedup
- *  of precomputing the angular rotation so that during the multiply
- *  accumulate loop you're just doing multiplies, no accumulation. It
+ *  of bins. (so can the FFT now, but this is easier to follow) It
+ *  exploits the speedup of precomputing the angular rotation so that
+ *  during the multiply accumulate loop you're just doing multiplies
+ *  and adds, the unit roots come from a table and the window is
+ *  applied to the samples once, up front. It
  *  also takes a window function which can work around spectral leakage
  *  issues. 
  *
+ *  Only the bins between the start and end frequencies are computed,
+ *  the others are left at zero. With a center of 0 the data is real
+ *  and bin k is at k * sample rate / bins. Otherwise it is IQ data,
+ *  bin 0 is the center frequency and the bins from bins / 2 up are
+ *  below it, as in an FFT, so a band that crosses the center is two
+ *  runs of bins. The bins are split up between the threads in 'pool'
+ *  (NULL to just use this one).
+ *
  *  There is a great description of how this works here: Original source:
  *  * Discrete Fourier transform (C)
  *  * by Project Nayuki, 2017. Public domain.
@@ -44,58 +99,115 @@
  *  of the rotation angle to the fundamental frequency.
  */
 sample_buf_t *
-compute_dft(sample_buf_t *input, int bins, window_function w,
-						double center, double fs, double fe) {
-	sample_buf_t *res = alloc_buf(bins, input->r);
-	complex double root, rotation;
+compute_dft_threads(sample_buf_t *input, int bins, window_function w,
+				double center, double fs, double fe, struct thread_pool_t *pool)
+{
+	sample_buf_t *res;
+	struct dft_job job;
 	double	span = input->r;
 	double	rbw = span / (double) bins;
-	double	(*win_func)(int, int);
-	switch (w) {
-		default:
-		case W_RECT:
-			win_func = rect_window_function;
-			break;
-		case W_BH:
-			win_func = bh_window_function;
-			break;
-		case W_HANN:
-			win_func = hann_window_function;
-			break;
-	}
+	double	low, min_freq, max_freq;
+	int		is_real = (center == 0);
+	int		first[2], last[2];
+	const double *win;
 
-	res->type = SAMPLE_DFT;
-	res->r = input->r;
 	/* these indicate the frequencies of interest */
-	res->center_freq = (center == 0) ? (span / 2.0) : center;
-	center = res->center_freq; // the one we computed
-	res->min_freq = (fs == 0) ? res->center_freq - span/2.0 : fs;
-	res->max_freq = (fe == 0) ? res->center_freq + span/2.0 : fe;
-	if ((fs < (center - span/2.0)) || (fe > (center + span/2.0))) {
+	center = (is_real) ? (span / 2.0) : center;
+	min_freq = (fs == 0) ? center - span/2.0 : fs;
+	max_freq = (fe == 0) ? center + span/2.0 : fe;
+	if ((min_freq < (center - span/2.0)) || (max_freq > (center + span/2.0))) {
 		fprintf(stderr, "DFT Frequencies of interest are outside of span.\n");
 		return NULL;
 	}
-	/* Baseline implementation following the paper 
-	 *
-	 * iterator k is the bin number, 
-	 * iterator t is the sample index.
-	 */
-	for (int k = 0; k < bins; k++) {	// for each bin
-		sample_t x = 0;
-		for (int t = 0; t < bins; t++) { // for each sample
-			double angle = 2 * M_PI * t * k / bins;
-			sample_t y = (t < input->n) ? input->data[t] : 0;
-			/* apply the window function based on the bin # */
-			y = y * win_func(t, bins);
-			x += y * (cos(angle) - sin(angle)*I);
+	res = alloc_buf(bins, input->r);
+	if (res == NULL) {
+		return NULL;
+	}
+	res->type = SAMPLE_DFT;
+	res->r = input->r;
+	res->center_freq = center;
+	res->min_freq = min_freq;
+	res->max_freq = max_freq;
+
+	/* the bins that fall between the frequencies of interest */
+	first[1] = 0;
+	last[1] = -1;
+	if (is_real) {
+		low = center - span / 2.0;
+		first[0] = (int) ceil((min_freq - low) / rbw);
+		last[0] = (int) floor((max_freq - low) / rbw);
+		first[0] = (first[0] < 0) ? 0 : first[0];
+		last[0] = (last[0] > bins - 1) ? bins - 1 : last[0];
+	} else {
+		long lo = (long) round((min_freq - center) / rbw);
+		long hi = (long) round((max_freq - center) / rbw);
+
+		first[0] = (int) ((lo % bins + bins) % bins);
+		last[0] = (int) ((hi % bins + bins) % bins);
+		if (hi - lo + 1 >= bins) {
+			/* the whole circle */
+			first[0] = 0;
+			last[0] = bins - 1;
+		} else if (first[0] > last[0]) {
+			/* wraps through the center, bin 0 */
+			first[1] = 0;
+			last[1] = last[0];
+			last[0] = bins - 1;
+		}
+	}
+
+	/* samples past the end of the input are zero, so skip them */
+	job.bins = bins;
+	job.n_x = (input->n < bins) ? (int) input->n : bins;
+	job.x = malloc(sizeof(complex double) * job.n_x);
+	job.tw = malloc(sizeof(complex double) * bins);
+	win = window_table(w, bins);
+	if ((job.x == NULL) || (job.tw == NULL) || (win == NULL)) {
+		fprintf(stderr, "compute_dft: out of memory\n");
+		free(job.x);
+		free(job.tw);
+		free_buf(res);
+		return NULL;
+	}
+	for (int t = 0; t < job.n_x; t++) {
+		/* apply the window function based on the sample # */
+		job.x[t] = input->data[t] * win[t];
+	}
+	for (int m = 0; m < bins; m++) {
+		double angle = 2 * M_PI * m / bins;
+		job.tw[m] = cos(angle) - sin(angle) * I;
+	}
+
+	job.out = res->data;
+	job.n_tasks = thread_pool_size(pool);
+	for (int r = 0; r < 2; r++) {
+		job.first = first[r];
+		job.last = last[r];
+		if (job.last >= job.first) {
+			thread_pool_run(pool, job.n_tasks, dft_task, &job);
 		}
-		res->sample_min = min(x, res->sample_min);
-		res->sample_max = max(x, res->sample_max);
-		res->data[k] = x;
+	}
+	free(job.x);
+	free(job.tw);
+
+	reset_minmax(res);
+	for (int k = 0; k < bins; k++) {
+		set_minmax(res, k);
 	}
 	return res;
 }
 
+/*
+ * compute_dft(...)
+ *
+ * The DFT using just the calling thread.
+ */
+sample_buf_t *
+compute_dft(sample_buf_t *input, int bins, window_function w,
+						double center, double fs, double fe) {
+	return compute_dft_threads(input, bins, w, center, fs, fe, NULL);
+}
+
 /*
  * plot_dft(...)
  *
@@ -111,7 +223,7 @@ plot_dft(FILE *of, sample_buf_t *dft, char *tag, double fs, double fe)
 	/* insure MIN and MAX are accurate */
 	dft->sample_max = 0;
 	dft->sample_min = 0;
-	for (int k = 0; k < dft->n; k++) {
+	for (int64_t k = 0; k < dft->n; k++) {
 		set_minmax(dft, k);
 	}
 	fprintf(of, "%s_min = %f\n", tag, dft->sample_min);
@@ -131,7 +243,7 @@ plot_dft(FILE *of, sample_buf_t *dft, char *tag, double fs, double fe)
 	fprintf(of, "# 4. Magnitude in decibels\n");
 	fprintf(of, "# 5. Absolute magnitude\n");
 	fprintf(of, "#\n");
-	for (int k = dft->n / 2; k < dft->n; k++) {
+	for (int64_t k = dft->n / 2; k < dft->n; k++) {
 		double xnorm, freq, ynorm, db, mag;
 		xnorm = -0.5 + (double) (k - (dft->n / 2))/ (double) dft->n;
 		freq = xnorm * (double) dft->r;
@@ -142,7 +254,7 @@ plot_dft(FILE *of, sample_buf_t *dft, char *tag, double fs, double fe)
 		fprintf(of, "%f %f %f %f %f\n", xnorm, freq, ynorm, db, mag);
 	}
 
-	for (int k = 0; k < dft->n; k++) {
+	for (int64_t k = 0; k < dft->n; k++) {
 		double xnorm, freq, ynorm, db, mag;
 		xnorm = (double) (k)/ (double) dft->n;
 		freq = xnorm * (double) dft->r;
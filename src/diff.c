@@ -56,7 +56,7 @@ solve_diff_e(sample_buf_t *x, complex B[], size_t NB,
 	res = alloc_buf(x->n, x->r);
 
 	/* iterate over all samples */
-	for (int i = 0; i < x->n; i++) {
+	for (int64_t i = 0; i < x->n; i++) {
 		complex r = 0.0; /* recursive result */
 		complex n = 0.0; /* non-recursive result */
 
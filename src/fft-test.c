@@ -27,15 +27,606 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <float.h>
 #include <math.h>
 #include <complex.h>
 #include <dsp/signal.h>
 #include <dsp/fft.h>
+#include <dsp/fxfft.h>
+#include <dsp/simd.h>
+#include <dsp/threads.h>
 #include <dsp/plot.h>
 
 #define BINS 1024
 #define SAMPLE_RATE	8192
 
+/*
+ * fill_noise( ... )
+ *
+ * Fill a buffer with uniform noise from 'seed', so a failure can be
+ * reproduced. Real buffers get zero imaginary parts.
+ */
+static void
+fill_noise(sample_buf_t *s, unsigned int seed, int is_real)
+{
+	srand(seed);
+	for (int64_t i = 0; i < s->n; i++) {
+		double re = (double) rand() / RAND_MAX - 0.5;
+		double im = (is_real) ? 0 : (double) rand() / RAND_MAX - 0.5;
+		s->data[i] = re + im * I;
+	}
+	s->type = (is_real) ? SAMPLE_REAL_SIGNAL : SAMPLE_SIGNAL;
+}
+
+/*
+ * slow_dft( ... )
+ *
+ * The DFT the slow way, sum( x[t] * e^(-2 pi i k t / bins) ), in
+ * long double with the angle reduced exactly, as the reference for
+ * the FFT paths. The window is applied the way the plans apply it.
+ */
+static void
+slow_dft(sample_buf_t *s, int bins, window_function w, complex double *out)
+{
+	const double *win = window_table(w, bins);
+	long double *c = malloc(sizeof(long double) * bins);
+	long double *sn = malloc(sizeof(long double) * bins);
+
+	for (int j = 0; j < bins; j++) {
+		long double a = 2.0L * M_PI * j / bins;
+		c[j] = cosl(a);
+		sn[j] = sinl(a);
+	}
+	for (int k = 0; k < bins; k++) {
+		long double re = 0, im = 0;
+		for (int t = 0; (t < bins) && (t < s->n); t++) {
+			int j = (int) (((long long) k * t) % bins);
+			long double xr = win[t] * creal(s->data[t]);
+			long double xi = win[t] * cimag(s->data[t]);
+			re += xr * c[j] + xi * sn[j];
+			im += xi * c[j] - xr * sn[j];
+		}
+		out[k] = (double) re + (double) im * I;
+	}
+	free(c);
+	free(sn);
+}
+
+/*
+ * max_error( ... )
+ *
+ * The largest difference between 'x' and 'ref', relative to the
+ * largest value in 'ref'.
+ */
+static double
+max_error(const complex double *x, const complex double *ref, int64_t n)
+{
+	double err = 0, big = 0;
+
+	for (int64_t i = 0; i < n; i++) {
+		err = fmax(err, cabs(x[i] - ref[i]));
+		big = fmax(big, cabs(ref[i]));
+	}
+	return (big > 0) ? err / big : err;
+}
+
+/* print how a check went, returns 1 if it failed */
+static int
+report(const char *what, double err, double tol)
+{
+	printf("  %-48s error %9.3g  %s\n", what, err,
+		   (err <= tol) ? "ok" : "FAILED");
+	return (err <= tol) ? 0 : 1;
+}
+
+/*
+ * check_plan( ... )
+ *
+ * One plan used for several transforms. Each has to match the slow
+ * DFT, and running the plan again must give the same bins.
+ */
+static int
+check_plan(void)
+{
+	fft_plan_t		*plan = fft_plan(BINS, W_HANN);
+	sample_buf_t	*s = alloc_buf(BINS, SAMPLE_RATE);
+	sample_buf_t	*a, *b;
+	complex double	*ref = malloc(sizeof(complex double) * BINS);
+	int				bad = 0;
+
+	for (unsigned int seed = 1; seed <= 3; seed++) {
+		fill_noise(s, seed, 0);
+		slow_dft(s, BINS, W_HANN, ref);
+		a = fft_execute(plan, s, 0);
+		b = fft_execute(plan, s, 0);
+		bad += report("plan vs slow DFT", max_error(a->data, ref, BINS), 1e-12);
+		bad += report("plan used twice", max_error(b->data, a->data, BINS), 0);
+		free_buf(a);
+		free_buf(b);
+	}
+	free(ref);
+	free_buf(s);
+	free_fft_plan(plan);
+	return bad;
+}
+
+/*
+ * check_real( ... )
+ *
+ * SAMPLE_REAL_SIGNAL buffers go through the half size real FFT. It
+ * has to give the same bins as the slow DFT at every size, including
+ * the tiny ones and a buffer shorter than the transform.
+ */
+static int
+check_real(void)
+{
+	static const int sizes[] = { 2, 4, 8, 64, BINS, 4096 };
+	sample_buf_t	*s, *fft;
+	complex double	*ref = malloc(sizeof(complex double) * 4096);
+	char			what[64];
+	int				bad = 0;
+
+	for (int i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); i++) {
+		for (int len = sizes[i]; len >= sizes[i] - 300; len -= 300) {
+			if (len < 1) {
+				break;
+			}
+			s = alloc_buf(len, SAMPLE_RATE);
+			fill_noise(s, (unsigned int) len, 1);
+			slow_dft(s, sizes[i], W_BH, ref);
+			fft = compute_fft(s, sizes[i], W_BH, 0);
+			snprintf(what, sizeof(what), "real %d samples, %d bins", len,
+					 sizes[i]);
+			bad += report(what, max_error(fft->data, ref, sizes[i]), 1e-12);
+			free_buf(fft);
+			free_buf(s);
+		}
+	}
+	free(ref);
+	return bad;
+}
+
+/*
+ * check_into( ... )
+ *
+ * The variants that write into the caller's buffer, or over the
+ * samples themselves, have to give the bins compute_fft() does, for
+ * each algorithm and for real as well as complex samples.
+ */
+static int
+check_into(void)
+{
+	static const int sizes[] = { BINS, 1000, 1009 };
+	sample_buf_t	*s, *fft, *into, *inplace;
+	char			what[64];
+	int				bad = 0;
+
+	for (int i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); i++) {
+		for (int is_real = 0; is_real < 2; is_real++) {
+			int n = sizes[i];
+
+			s = alloc_buf(n, SAMPLE_RATE);
+			inplace = alloc_buf(n, SAMPLE_RATE);
+			into = alloc_buf(n, SAMPLE_RATE);
+			fill_noise(s, (unsigned int) n, is_real);
+			fill_noise(inplace, (unsigned int) n, is_real);
+			fft = compute_fft(s, n, W_HANN, 0);
+			compute_fft_into(s, into, n, W_HANN, 0);
+			compute_fft_inplace(inplace, W_HANN, 0);
+			snprintf(what, sizeof(what), "%s into, %d bins",
+					 (is_real) ? "real" : "complex", n);
+			bad += report(what, max_error(into->data, fft->data, n), 0);
+			snprintf(what, sizeof(what), "%s in place, %d bins",
+					 (is_real) ? "real" : "complex", n);
+			bad += report(what, max_error(inplace->data, fft->data, n), 0);
+			free_buf(fft);
+			free_buf(into);
+			free_buf(inplace);
+			free_buf(s);
+		}
+	}
+	return bad;
+}
+
+/*
+ * check_any_size( ... )
+ *
+ * Sizes that aren't powers of 2, products of 2, 3, 5, and 7 (mixed
+ * radix) and ones with bigger prime factors (Bluestein), against the
+ * slow DFT. Each plan has to use the algorithm its size calls for.
+ */
+static int
+check_any_size(void)
+{
+	static const struct {
+		int				n;
+		fft_algorithm	algorithm;
+	} sizes[] = {
+		{ 1, FFT_RADIX_2 }, { 3, FFT_MIXED_RADIX }, { 7, FFT_MIXED_RADIX },
+		{ 12, FFT_MIXED_RADIX }, { 360, FFT_MIXED_RADIX },
+		{ 840, FFT_MIXED_RADIX }, { 1000, FFT_MIXED_RADIX },
+		{ 11, FFT_BLUESTEIN }, { 17, FFT_BLUESTEIN }, { 1001, FFT_BLUESTEIN },
+		{ 1009, FFT_BLUESTEIN }, { 1018, FFT_BLUESTEIN }
+	};
+	static const char *names[] = {
+		"radix 2", "mixed radix", "Bluestein", "four step"
+	};
+	fft_plan_t		*plan;
+	sample_buf_t	*s, *fft;
+	complex double	*ref = malloc(sizeof(complex double) * 1024);
+	char			what[64];
+	int				bad = 0;
+
+	for (int i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); i++) {
+		int n = sizes[i].n;
+
+		plan = fft_plan(n, W_HANN);
+		if ((plan == NULL) || (plan->algorithm != sizes[i].algorithm)) {
+			printf("  %d bins doesn't get the right algorithm  FAILED\n", n);
+			bad++;
+			free_fft_plan(plan);
+			continue;
+		}
+		/* full length, then short of the transform (zero padded) */
+		for (int len = n; len >= n - n / 3; len -= (n / 3 > 0) ? n / 3 : 1) {
+			s = alloc_buf(len, SAMPLE_RATE);
+			fill_noise(s, (unsigned int) len, 0);
+			slow_dft(s, n, W_HANN, ref);
+			fft = fft_execute(plan, s, 0);
+			snprintf(what, sizeof(what), "%s, %d samples, %d bins",
+					 names[sizes[i].algorithm], len, n);
+			bad += report(what, max_error(fft->data, ref, n), 1e-12);
+			free_buf(fft);
+			free_buf(s);
+		}
+		free_fft_plan(plan);
+	}
+	free(ref);
+	return bad;
+}
+
+/*
+ * simd_transforms( ... )
+ *
+ * Every transform that has vector kernels, of the same noise, at
+ * whatever SIMD level is in use. Complex, real, split complex and
+ * batched (4 frames) bins go in 'out' one after the other, 7 * n in
+ * all, and the single precision bins in 'outf'.
+ */
+static void
+simd_transforms(int n, complex double *out, complex float *outf)
+{
+	fft_plan_t			*plan = fft_plan(n, W_HANN);
+	fft_plan_t			*plan_s = fft_plan_split(n, W_HANN);
+	fft_plan_t			*plan_f = fft_plan_f(n, W_HANN);
+	sample_buf_t		*s = alloc_buf(4 * n, SAMPLE_RATE);
+	sample_buf_t		*fft;
+	sample_buf_split_t	*ss, *fs;
+	sample_buf_f_t		*sf, *ff;
+
+	fill_noise(s, 5, 0);
+	fft = fft_execute(plan, s, 0);
+	memcpy(out, fft->data, sizeof(complex double) * n);
+	free_buf(fft);
+	fft = fft_execute_batch(plan, s, 4, n, 0);
+	memcpy(out + 3 * n, fft->data, sizeof(complex double) * 4 * n);
+	free_buf(fft);
+	ss = buf_to_split(s);
+	fs = fft_execute_split(plan_s, ss, 0);
+	for (int k = 0; k < n; k++) {
+		out[2 * n + k] = fs->re[k] + fs->im[k] * I;
+	}
+	sf = buf_to_float(s);
+	ff = fft_execute_f(plan_f, sf, 0);
+	memcpy(outf, ff->data, sizeof(complex float) * n);
+	fill_noise(s, 5, 1);
+	fft = fft_execute(plan, s, 0);
+	memcpy(out + n, fft->data, sizeof(complex double) * n);
+	free_buf(fft);
+	free_buf_split(ss);
+	free_buf_split(fs);
+	free_buf_f(sf);
+	free_buf_f(ff);
+	free_buf(s);
+	free_fft_plan(plan);
+	free_fft_plan(plan_s);
+	free_fft_plan(plan_f);
+}
+
+/*
+ * check_simd( ... )
+ *
+ * Each SIMD level the CPU has, against the scalar code. As simd.c
+ * says, they should match bit for bit, or if the compiler fuses
+ * multiplies and adds be within an ulp or so of the largest bin per
+ * stage, log2(n) stages.
+ */
+static int
+check_simd(void)
+{
+	static const int sizes[] = { 2, 8, 64, BINS };
+	simd_level		best = simd_get_level();
+	complex double	*ref = malloc(sizeof(complex double) * 7 * BINS);
+	complex double	*out = malloc(sizeof(complex double) * 7 * BINS);
+	complex float	*reff = malloc(sizeof(complex float) * BINS);
+	complex float	*outf = malloc(sizeof(complex float) * BINS);
+	char			what[64];
+	int				bad = 0;
+
+	for (int i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); i++) {
+		int n = sizes[i];
+		double tol = 2 * log2(n) * DBL_EPSILON;
+		double tolf = 2 * log2(n) * FLT_EPSILON;
+
+		simd_set_level(SIMD_NONE);
+		simd_transforms(n, ref, reff);
+		for (simd_level l = SIMD_SSE2; l <= best; l++) {
+			static const char *what_kind[] = {
+				"complex", "real", "split", "batch"
+			};
+			double err, big;
+
+			if (simd_set_level(l) != l) {
+				continue;
+			}
+			simd_transforms(n, out, outf);
+			for (int j = 0; j < 4; j++) {
+				int len = (j == 3) ? 4 * n : n;
+
+				snprintf(what, sizeof(what), "%s %s, %d bins",
+						 simd_level_name(l), what_kind[j], n);
+				bad += report(what, max_error(out + j * n, ref + j * n, len),
+							  tol);
+			}
+			err = big = 0;
+			for (int k = 0; k < n; k++) {
+				err = fmax(err, cabsf(outf[k] - reff[k]));
+				big = fmax(big, cabsf(reff[k]));
+			}
+			snprintf(what, sizeof(what), "%s float, %d bins",
+					 simd_level_name(l), n);
+			bad += report(what, err / big, tolf);
+		}
+	}
+	simd_set_level(best);
+	free(ref);
+	free(out);
+	free(reff);
+	free(outf);
+	return bad;
+}
+
+/*
+ * check_four_step( ... )
+ *
+ * Sizes of FFT_FOUR_STEP_MIN and up use the four step FFT, which
+ * split complex plans don't. So compare it with a split complex
+ * transform of the same samples, and a few bins with the sum done
+ * the slow way, on its own and spread over a thread pool.
+ */
+static int
+check_four_step(void)
+{
+	static const int sizes[] = { FFT_FOUR_STEP_MIN, 2 * FFT_FOUR_STEP_MIN };
+	struct thread_pool_t *pool = thread_pool(4);
+	fft_plan_t			*plan, *plan_s;
+	sample_buf_t		*s, *fft, *fft_t;
+	sample_buf_split_t	*ss, *fs;
+	complex double		*ref;
+	char				what[64];
+	int					bad = 0;
+
+	for (int i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); i++) {
+		int n = sizes[i];
+		const double *win = window_table(W_HANN, n);
+		double err = 0, big = 0;
+
+		plan = fft_plan(n, W_HANN);
+		plan_s = fft_plan_split(n, W_HANN);
+		if ((plan == NULL) || (plan->algorithm != FFT_FOUR_STEP)) {
+			printf("  %d bins isn't a four step plan  FAILED\n", n);
+			bad++;
+			free_fft_plan(plan);
+			free_fft_plan(plan_s);
+			continue;
+		}
+		/* a bit short, so the end is zero padded */
+		s = alloc_buf(n - 1000, SAMPLE_RATE);
+		fill_noise(s, 7, 0);
+		ss = buf_to_split(s);
+		fs = fft_execute_split(plan_s, ss, 0);
+		ref = malloc(sizeof(complex double) * n);
+		for (int k = 0; k < n; k++) {
+			ref[k] = fs->re[k] + fs->im[k] * I;
+		}
+		fft = fft_execute(plan, s, 0);
+		snprintf(what, sizeof(what), "four step, %d bins", n);
+		bad += report(what, max_error(fft->data, ref, n), 1e-12);
+
+		/* a few bins the slow way */
+		for (int k = 0; k < n; k += n / 4 + 1) {
+			long double re = 0, im = 0;
+			for (int t = 0; t < s->n; t++) {
+				long double a = 2.0L * M_PI * (((long long) k * t) % n) / n;
+				re += win[t] * (creal(s->data[t]) * cosl(a) +
+								cimag(s->data[t]) * sinl(a));
+				im += win[t] * (cimag(s->data[t]) * cosl(a) -
+								creal(s->data[t]) * sinl(a));
+			}
+			err = fmax(err, cabs(fft->data[k] - ((double) re + (double) im * I)));
+			big = fmax(big, cabs(fft->data[k]));
+		}
+		snprintf(what, sizeof(what), "four step, %d bins, slow DFT bins", n);
+		bad += report(what, err / big, 1e-11);
+
+		fft_plan_threads(plan, pool);
+		fft_t = fft_execute(plan, s, 0);
+		snprintf(what, sizeof(what), "four step, %d bins, %d threads", n,
+				 thread_pool_size(pool));
+		bad += report(what, max_error(fft_t->data, fft->data, n), 0);
+
+		free(ref);
+		free_buf(fft);
+		free_buf(fft_t);
+		free_buf_split(ss);
+		free_buf_split(fs);
+		free_buf(s);
+		free_fft_plan(plan);
+		free_fft_plan(plan_s);
+	}
+	free_thread_pool(pool);
+	return bad;
+}
+
+/*
+ * check_batch( ... )
+ *
+ * A batch of frames has to give the same bins as transforming each
+ * frame on its own. Frames back to back, overlapping, with gaps, and
+ * running off the end of the samples (zero padded), real and complex,
+ * on one thread and spread over a pool.
+ */
+static int
+check_batch(void)
+{
+	static const int sizes[] = { BINS, 1000 };
+	struct thread_pool_t *pool = thread_pool(4);
+	fft_plan_t		*plan;
+	sample_buf_t	*s, *frame, *one, *batch;
+	char			what[80];
+	int				frames = 9;
+	int				bad = 0;
+
+	for (int i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); i++) {
+		int n = sizes[i];
+		int strides[] = { n, n / 2, n + 100 };
+
+		plan = fft_plan(n, W_HANN);
+		for (int j = 0; j < 3; j++) {
+			for (int is_real = 0; is_real < 2; is_real++) {
+				for (int threads = 0; threads < 2; threads++) {
+					int stride = strides[j];
+					double err = 0;
+
+					/* the last frame is a bit short */
+					s = alloc_buf((int64_t) (frames - 1) * stride + n / 2,
+								  SAMPLE_RATE);
+					fill_noise(s, (unsigned int) stride, is_real);
+					fft_plan_threads(plan, (threads) ? pool : NULL);
+					batch = fft_execute_batch(plan, s, frames, stride, 0);
+					frame = alloc_buf(n, SAMPLE_RATE);
+					frame->type = s->type;
+					for (int f = 0; f < frames; f++) {
+						for (int t = 0; t < n; t++) {
+							int64_t ndx = (int64_t) f * stride + t;
+							frame->data[t] = (ndx < s->n) ? s->data[ndx] : 0;
+						}
+						one = fft_execute(plan, frame, 0);
+						err = fmax(err, max_error(batch->data +
+										(int64_t) f * n, one->data, n));
+						free_buf(one);
+					}
+					snprintf(what, sizeof(what),
+							 "batch %s, %d bins, stride %d%s",
+							 (is_real) ? "real" : "complex", n, stride,
+							 (threads) ? ", threads" : "");
+					bad += report(what, err, 0);
+					free_buf(frame);
+					free_buf(batch);
+					free_buf(s);
+				}
+			}
+		}
+		fft_plan_threads(plan, NULL);
+		free_fft_plan(plan);
+	}
+	free_thread_pool(pool);
+	return bad;
+}
+
+/*
+ * check_fixed( ... )
+ *
+ * The Q15 and Q31 transforms against compute_fft(). They round every
+ * product, and the rounding noise grows with the square root of the
+ * size, so allow that many LSBs of the format (times a margin) of the
+ * largest bin. Block floating point must never saturate.
+ */
+static int
+check_fixed(void)
+{
+	static const int sizes[] = { 8, 64, BINS };
+	fx_fft_plan_t	*plan;
+	sample_buf_t	*s, *fft, *fx;
+	char			what[64];
+	int				bad = 0;
+
+	for (int i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); i++) {
+		int n = sizes[i];
+
+		s = alloc_buf(n, SAMPLE_RATE);
+		fill_noise(s, 11, 0);
+		fft = compute_fft(s, n, W_HANN, 0);
+		plan = fx_fft_plan(n, W_HANN, FX_SCALE_BLOCK);
+		for (int width = 16; width <= 32; width += 16) {
+			double tol = 32 * sqrt(n) * ldexp(1.0, 1 - width);
+			int overflows = -1;
+
+			fx = fx_fft_execute(plan, s, width, 0, &overflows);
+			snprintf(what, sizeof(what), "Q%d, %d bins", width - 1, n);
+			bad += report(what, max_error(fx->data, fft->data, n), tol);
+			if (overflows != 0) {
+				printf("  Q%d, %d bins saturated %d values  FAILED\n",
+					   width - 1, n, overflows);
+				bad++;
+			}
+			free_buf(fx);
+		}
+		free_fx_fft_plan(plan);
+		free_buf(fft);
+		free_buf(s);
+	}
+	return bad;
+}
+
+/*
+ * check_inverse( ... )
+ *
+ * A forward transform (rectangular window) and then the inverse has
+ * to give the samples back, for each algorithm, and the in place
+ * inverse has to agree with the one that allocates.
+ */
+static int
+check_inverse(void)
+{
+	static const int sizes[] = { 2, BINS, 1000, 1009, FFT_FOUR_STEP_MIN };
+	fft_plan_t		*plan;
+	sample_buf_t	*s, *fft, *sig;
+	char			what[64];
+	int				bad = 0;
+
+	for (int i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); i++) {
+		int n = sizes[i];
+
+		plan = fft_plan(n, W_RECT);
+		s = alloc_buf(n, SAMPLE_RATE);
+		fill_noise(s, 13, 0);
+		fft = fft_execute(plan, s, 0);
+		sig = fft_execute_inverse(plan, fft);
+		snprintf(what, sizeof(what), "inverse round trip, %d bins", n);
+		bad += report(what, max_error(sig->data, s->data, n), 1e-14);
+		fft_execute_inverse_inplace(plan, fft);
+		snprintf(what, sizeof(what), "inverse in place, %d bins", n);
+		bad += report(what, max_error(fft->data, sig->data, n), 0);
+		free_buf(sig);
+		free_buf(fft);
+		free_buf(s);
+		free_fft_plan(plan);
+	}
+	return bad;
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -45,6 +636,7 @@ main(int argc, char *argv[])
 	FILE			*of;
 	window_function wf = W_BH;
 	int bins = BINS;
+	int bad = 0;
 
 	printf("Running a simple FFT test\n");
 
@@ -105,5 +697,21 @@ main(int argc, char *argv[])
 						PLOT_X_TIME_MS, PLOT_Y_AMPLITUDE_NORMALIZED);
 	multiplot_end(of);
 	fclose(of);
+
+	/* and check the FFT paths against the slow DFT, and each other */
+	printf("Checking the FFT paths\n");
+	bad += check_plan();
+	bad += check_real();
+	bad += check_into();
+	bad += check_any_size();
+	bad += check_simd();
+	bad += check_four_step();
+	bad += check_batch();
+	bad += check_fixed();
+	bad += check_inverse();
+	if (bad) {
+		fprintf(stderr, "%d FFT checks failed\n", bad);
+		exit(1);
+	}
 	printf("Done.\n");
 }
@@ -18,11 +18,14 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <limits.h>
 #include <math.h>
 #include <complex.h>
 #include <dsp/signal.h>
 #include <dsp/windows.h>
 #include <dsp/fft.h>
+#include <dsp/simd.h>
+#include <dsp/threads.h>
 
 /* This defines turn of different levels of 'chattyness' about what
  *  The code is doing. It can be instructive when learning the code
@@ -34,88 +37,335 @@
 // #define DEBUG_SWAP_SORT
 
 /*
- * fft( ... )
+ * fft_factor( ... )
  *
- * Compute the complex FFT in 'n' bins given the sample
- * buffer. 
+ * Break 'n' into radix 2, 3, 5, and 7 factors, stored in the plan.
+ * Returns 0 if some other prime is left over.
  */
-sample_buf_t *
-compute_fft(sample_buf_t *iq, int bins, window_function window, double center)
+static int
+fft_factor(fft_plan_t *plan, int n)
 {
-	int i, j, k;
+	static const int radix[4] = { 2, 3, 5, 7 };
+
+	plan->n_factors = 0;
+	for (int i = 0; i < 4; i++) {
+		while ((n % radix[i]) == 0) {
+			plan->factors[plan->n_factors++] = radix[i];
+			n = n / radix[i];
+		}
+	}
+	return (n == 1);
+}
+
+/*
+ * fft_roots( ... )
+ *
+ * Fill 'tw' with the first 'count' of the 'n'th roots of unity,
+ * W(n)^k = e^(-2 pi i k / n). Computing each one directly, rather
+ * than by repeated multiplication, keeps rounding error from
+ * accumulating across the table.
+ */
+static void
+fft_roots(complex double *tw, int count, int n)
+{
+	for (int k = 0; k < count; k++) {
+		double angle = 2.0 * M_PI * (double) k / (double) n;
+		tw[k] = cos(angle) - sin(angle) * I;
+	}
+}
+
+static void fft_butterflies(complex double *, int, int, fft_plan_t *);
+static void fft_permute(fft_plan_t *, complex double *);
+static void fft_first_stages(complex double *, int, int);
+static int fft_four_step_plan(fft_plan_t *);
+
+/*
+ * fft_bluestein_plan( ... )
+ *
+ * Bluestein's algorithm turns an N point DFT into a convolution,
+ * using n * k = (n^2 + k^2 - (k - n)^2) / 2, so that
+ *
+ *     X[k] = c[k] * sum( x[n] * c[n] * conj(c[k - n]) )
+ *
+ * where c[n] = e^(-i pi n^2 / N) is a "chirp". The convolution is
+ * done with power of 2 FFTs that are at least 2N - 1 long, so the
+ * plan holds one of those, the chirp, and the FFT of the conjugate
+ * chirp (the filter we convolve with).
+ */
+static int
+fft_bluestein_plan(fft_plan_t *plan)
+{
+	int n = plan->n;
+	int m = 1;
+
+	while (m < (2 * n - 1)) {
+		m <<= 1;
+	}
+	plan->sub = fft_plan(m, W_RECT);
+	plan->chirp = malloc(sizeof(complex double) * n);
+	plan->chirp_fft = calloc(m, sizeof(complex double));
+	plan->work = simd_alloc(sizeof(complex double) * m);
+	if ((plan->sub == NULL) || (plan->chirp == NULL) ||
+		(plan->chirp_fft == NULL) || (plan->work == NULL)) {
+		return 0;
+	}
+
+	/* n^2 mod 2N keeps the angle small so it stays accurate */
+	for (int k = 0; k < n; k++) {
+		long long sq = ((long long) k * (long long) k) % (2LL * n);
+		double angle = M_PI * (double) sq / (double) n;
+		plan->chirp[k] = cos(angle) - sin(angle) * I;
+	}
+
+	/* the filter is the conjugate chirp, wrapped around for k < 0 */
+	plan->chirp_fft[0] = conj(plan->chirp[0]);
+	for (int k = 1; k < n; k++) {
+		plan->chirp_fft[k] = conj(plan->chirp[k]);
+		plan->chirp_fft[m - k] = conj(plan->chirp[k]);
+	}
+	fft_transform(plan->sub, plan->chirp_fft);
+	return 1;
+}
+
+static fft_plan_t *plan_build(int, window_function, int);
+
+/*
+ * fft_four_step_plan( ... )
+ *
+ * Once a transform gets big, the later radix 2 stages reach across
+ * more memory than the cache holds and every butterfly is a cache
+ * miss. The "four step" FFT avoids that by treating the N samples as
+ * an N1 x N2 matrix, x[N2 * n1 + n2], and doing
+ *
+ *   1) an N1 point FFT down each of the N2 columns,
+ *   2) multiplying element [k1][n2] by W(N)^(n2 * k1),
+ *   3) an N2 point FFT along each of the N1 rows,
+ *   4) reading the result out transposed, X[k1 + N1 * k2].
+ *
+ * Each small FFT fits in cache, and all of the column (or row) FFTs
+ * are independent so they can run on different threads. The plan
+ * holds the two small plans and the step 2 roots, which are split
+ * into W(N)^(a * N2) * W(N)^b so the tables are sqrt(N) long rather
+ * than N.
+ */
+static int
+fft_four_step_plan(fft_plan_t *plan)
+{
+	int n1 = 1 << (plan->bits / 2);
+	int n2 = plan->n / n1;
+
+	plan->algorithm = FFT_FOUR_STEP;
+	plan->n1 = n1;
+	plan->n2 = n2;
+	plan->sub = plan_build(n1, W_RECT, 0);
+	plan->sub2 = plan_build(n2, W_RECT, 0);
+	plan->tw_lo = malloc(sizeof(complex double) * n2);
+	plan->tw_hi = malloc(sizeof(complex double) * n1);
+	plan->work = simd_alloc(sizeof(complex double) * plan->n);
+	if ((plan->sub == NULL) || (plan->sub2 == NULL) ||
+		(plan->tw_lo == NULL) || (plan->tw_hi == NULL) ||
+		(plan->work == NULL)) {
+		return 0;
+	}
+	fft_roots(plan->tw_lo, n2, plan->n);
+	for (int a = 0; a < n1; a++) {
+		double angle = 2.0 * M_PI * (double) a / (double) n1;
+		plan->tw_hi[a] = cos(angle) - sin(angle) * I;
+	}
+	/* single threaded until told otherwise */
+	return (fft_plan_threads(plan, NULL) == 0);
+}
+
+/*
+ * fft_plan( ... )
+ *
+ * Build a plan for an FFT of 'bins' bins using window 'w'. All of
+ * the work that does not depend on the data is done here; the
+ * reflected index of each bin, the window coefficient of each sample
+ * (shared with everyone else using that window, see window_table()),
+ * and the unit roots (twiddles) used by the butterflies.
+ *
+ * Any number of bins is allowed. Powers of 2 use the classic radix 2
+ * FFT (or the four step FFT once they are FFT_FOUR_STEP_MIN or more),
+ * products of 2, 3, 5, and 7 use a mixed radix FFT, and any thing
+ * else (large prime factors) uses Bluestein's algorithm. All of them
+ * are O(N log N). Returns NULL if memory runs out.
+ */
+static fft_plan_t *
+plan_build(int bins, window_function window, int allow_four_step)
+{
+	fft_plan_t *plan;
 	int bits;
-	double t, half_span = (double) iq->r / 2.0;
-	double (*win_func)(int, int);
-	complex double alpha, uri, ur;
-	complex double *fft_result;
-	sample_buf_t *result;
 
-	/* and they must be a power of 2 */
-	t = log(bins) / log(2);
-	bits = (int) t;
+	if (bins < 1) {
+		fprintf(stderr, "compute_fft: %d is not a valid number of bins\n",
+				bins);
+		return NULL;
+	}
+	for (bits = 0; (1 << bits) < bins; bits++) ;
 #ifdef DEBUG_C_FFT
 	printf("Bits per index is %d\n", bits);
 #endif
-	if (modf(t, &t) > 0) {
-		fprintf(stderr, "compute_fft: %d is not a power of 2\n", bins);
+
+	plan = calloc(1, sizeof(fft_plan_t));
+	if (plan == NULL) {
+		return NULL;
+	}
+	plan->n = bins;
+	plan->window = window;
+	/* window coefficients are applied by source sample index */
+	plan->win = window_table(window, bins);
+	if (plan->win == NULL) {
+		fprintf(stderr, "fft_plan: out of memory\n");
+		free_fft_plan(plan);
+		return NULL;
+	}
+
+	if ((1 << bits) != bins) {
+		if (fft_factor(plan, bins)) {
+			/* mixed radix uses all N roots, and a place to work */
+			plan->algorithm = FFT_MIXED_RADIX;
+			plan->twiddle = malloc(sizeof(complex double) * bins);
+			plan->work = simd_alloc(sizeof(complex double) * bins);
+			if ((plan->twiddle == NULL) || (plan->work == NULL)) {
+				fprintf(stderr, "fft_plan: out of memory\n");
+				free_fft_plan(plan);
+				return NULL;
+			}
+			fft_roots(plan->twiddle, bins, bins);
+		} else {
+			plan->algorithm = FFT_BLUESTEIN;
+			if (! fft_bluestein_plan(plan)) {
+				fprintf(stderr, "fft_plan: out of memory\n");
+				free_fft_plan(plan);
+				return NULL;
+			}
+		}
+		return plan;
+	}
+
+	plan->bits = bits;
+	if (allow_four_step && (bins >= FFT_FOUR_STEP_MIN)) {
+		if (! fft_four_step_plan(plan)) {
+			fprintf(stderr, "fft_plan: out of memory\n");
+			free_fft_plan(plan);
+			return NULL;
+		}
+		return plan;
+	}
+
+	plan->algorithm = FFT_RADIX_2;
+	plan->rev = malloc(sizeof(int) * bins);
+	plan->twiddle = malloc(sizeof(complex double) * ((bins / 2) + 1));
+	plan->stage_tw = simd_alloc(sizeof(complex double) * bins);
+	plan->stage_itw = simd_alloc(sizeof(complex double) * bins);
+	if ((plan->rev == NULL) || (plan->twiddle == NULL) ||
+		(plan->stage_tw == NULL) || (plan->stage_itw == NULL)) {
+		fprintf(stderr, "fft_plan: out of memory\n");
+		free_fft_plan(plan);
 		return NULL;
 	}
 
 	/*
-	 * Allocate a buffer for the FFT, keep the sample rate from the
-	 * source data.
+	 * The reflection sort needs each bin index with its bits
+	 * reversed. Rather than reversing them one bit at a time for
+	 * every transform, build the table once. Reversing 'i' is the
+	 * same as reversing 'i >> 1' and shifting it back up one place,
+	 * then putting the low bit of 'i' in the top position.
 	 */
-	result = alloc_buf(bins, iq->r);
-	result->center_freq = center;
-	result->min_freq = (center == 0) ? 0 : center - half_span;
-	result->max_freq = (center == 0) ? half_span * 2 : center + half_span;
-
-	/* If center is 0  we treat it like a direct sample */
-	result->type = (center == 0) ? SAMPLE_REAL_FFT : SAMPLE_FFT;
-	result->nxt = NULL;
-	fft_result = result->data;
-	if (center == 0) {
-		result->type = SAMPLE_REAL_FFT;
-	}
-	switch (window) {
-		case W_RECT:
-		default:
-			win_func = rect_window_function;
-			break;
-		case W_HANN:
-			win_func = hann_window_function;
-			break;
-		case W_BH:
-			win_func = bh_window_function;
-			break;
+	plan->rev[0] = 0;
+	for (int i = 1; i < bins; i++) {
+		plan->rev[i] = (plan->rev[i >> 1] >> 1) | ((i & 1) << (bits - 1));
 	}
 
+	/*
+	 * Every stage of butterflies uses a subset of the N'th roots of
+	 * unity. A stage 'bfly_len' long needs W(bfly_len)^j, which is
+	 * the same as W(N)^(j * N / bfly_len), so one table of the
+	 * first N/2 roots serves every stage.
+	 */
+	fft_roots(plan->twiddle, (bins / 2) + 1, bins);
 
-	/* This first bit is a reflection sort,
-	 * Most people do a 'sort in place' of
-	 * the source data, but I'm trying to preserve
-	 * that original data for other use, so I
-	 * 'sort into place' from the source into
-	 * my allocated array result->data
-	 *
-	 * The end result is each entry is 2^n away
-	 * from its sibling.
+	/*
+	 * The vector kernels want each stage's roots next to each other
+	 * rather than spread out across the table, so make a copy laid
+	 * out by stage, W(2)^0 at [1], W(4)^0..1 at [2], W(8)^0..3 at [4],
+	 * etc. Starting each stage at [half] keeps its roots aligned.
 	 */
-	for (i = 0; i < bins; i++) {
-		complex double tmp;
-		/* compute reflected index */
-		for (k = 0, j = 0; j < bits; j++) {
-			k = (k << 1) | ((i >> j) & 1);
+	plan->stage_tw[0] = plan->stage_itw[0] = 1;
+	for (int half = 1; half < bins; half <<= 1) {
+		for (int j = 0; j < half; j++) {
+			plan->stage_tw[half + j] = plan->twiddle[j * (bins / (2 * half))];
+			plan->stage_itw[half + j] = conj(plan->stage_tw[half + j]);
 		}
-#ifdef DEBUG_SWAP_SORT
-		printf("index %d gets index %d, value (%f, %fi)\n", i, k, 
-						creal(iq->data[k]), cimag(iq->data[k]));
-#endif
-		/* if sample length is less than bins, pad with 0 */
-		tmp = (k < iq->n) ? iq->data[k] : 0;
-		/* apply the window function */
-		t = win_func(k, bins);
-		fft_result[i] = t * creal(tmp) + t * cimag(tmp) * I;
+	}
+	return plan;
+}
+
+fft_plan_t *
+fft_plan(int bins, window_function window)
+{
+	return plan_build(bins, window, 1);
+}
+
+/*
+ * free_fft_plan( ... )
+ *
+ * Release a plan built by fft_plan().
+ */
+void
+free_fft_plan(fft_plan_t *plan)
+{
+	if (plan == NULL) {
+		return;
+	}
+	free(plan->rev);
+	free(plan->twiddle);
+	free(plan->stage_tw);
+	free(plan->stage_itw);
+	free(plan->stage_twf);
+	free(plan->stage_re);
+	free(plan->stage_im);
+	free(plan->work);
+	free(plan->chirp);
+	free(plan->chirp_fft);
+	free_fft_plan(plan->sub);
+	free_fft_plan(plan->sub2);
+	free(plan->tw_lo);
+	free(plan->tw_hi);
+	for (int i = 0; i < plan->n_scratch; i++) {
+		free(plan->scratch[i]);
+	}
+	free(plan->scratch);
+	free(plan);
+}
+
+/*
+ * fft_butterflies( ... )
+ *
+ * Run the butterfly stages over 'bins' values that have already
+ * been put into reflected order, using the unit roots of a radix 2
+ * plan. 'bins' may be smaller than the plan (the real FFT runs a
+ * half size transform) since a smaller transform's roots are every
+ * so many of the larger one's. The stages before the one that makes
+ * 'first' bin DFTs have already been done (see fft_first_stages()),
+ * 'first' is 2 to do them all.
+ *
+ * If the CPU has vector instructions the stages are run by the
+ * kernels in simd.c, otherwise by the loop below.
+ */
+static void
+fft_butterflies(complex double *fft_result, int bins, int first,
+				fft_plan_t *plan)
+{
+	int i, j, k;
+	int tw_step = plan->n / bins;
+	const complex double *twiddle = plan->twiddle;
+	complex double alpha, ur;
+
+	if (simd_get_level() != SIMD_NONE) {
+		simd_fft_stages(fft_result, bins, first / 2, plan->stage_tw);
+		return;
 	}
 
 	/*
@@ -128,32 +378,19 @@ compute_fft(sample_buf_t *iq, int bins, window_function window, double center)
 	 * in the bin because a 1 bin DFT is the spectrum
 	 * of that DFT.
 	 */
-#ifdef DEBUG_C_FFT
-	printf("FFT Calc: %d stage bufferfly calculation\n", q);
-#endif
-
-	for (i = 1; i <= bits; i++) {
-		int bfly_len = 1 << i;			/* Butterfly elements */
+	for (i = first; i <= bins; i <<= 1) {
+		int bfly_len = i;				/* Butterfly elements */
 		int half_bfly = bfly_len / 2;		/* Half-the butterfly */
+		/*
+		 * The unity root for this stage is W(bfly_len), which
+		 * is every (bins / bfly_len)th entry of the plan's
+		 * twiddle table.
+		 */
+		int stride = tw_step * (bins / bfly_len);
 
-		/* nth root of K */
 #ifdef DEBUG_C_FFT
 		printf("Computing the roots of W(%d)\n", bfly_len);
 #endif
-
-		/* unity root value (complex) */
-		ur = 1.0;
-
-		/* This is the unity root increment (complex)
-		 * If you multiply ur by this value 'n' times then
-		 * ur will return to [1 + 0i]. 'n' in this case is
-		 * bfly_len times. Technically the argument to the
-		 * trancendentals would be 2 * pi / butterfly-span
-		 * but since we calculate butterfly-span / 2 (half_bfly)
-		 * we use algebra to simplify math to pi / half-bfly.
-		 */
-		uri = cos(M_PI / half_bfly) - sin(M_PI / half_bfly) * I;
-		
 		/*
 		 * Combine two 2^i DFTs into a single
 		 * 2^(i+1) DFT. So two 1 bin DFTs to
@@ -167,6 +404,8 @@ compute_fft(sample_buf_t *iq, int bins, window_function window, double center)
 		 * the way up to exactly one 512-bin DFT.
 		 */
 		for (j = 0; j < half_bfly ; j++) {
+			/* unity root value (complex) */
+			ur = twiddle[j * stride];
 			for (k = j; k < bins; k += bfly_len) {
 				/*
 				 * Apply the FFT butterfly function to
@@ -199,59 +438,1439 @@ compute_fft(sample_buf_t *iq, int bins, window_function window, double center)
 				 * representation.
 				 */
 			}
-			/*
-			 * Now my multiplying UR by URI we save ourselves from
-			 * recomputing the sin and cos, Euler tells us we can just
-			 * keep multiplying and the values will go through a 
-			 * sequence from 1 + 0, to 1 - i, to -1 + 0, to 1 + i and
-			 * then back to 1 + 0.
-			 */
-			ur = ur * uri;
-
 #ifdef DEBUG_C_FFT
-			printf("    ... Increment UR to [%f, %f]\r", creal(ur), cimag(ur));
+			printf("    ... UR is [%f, %f]\r", creal(ur), cimag(ur));
 #endif
 		}
 #ifdef DEBUG_C_FFT
 		printf("\n");
 #endif
 	}
-	/* This sets the min and maximum magnitude values in the result */
-	for (int i = 0; i < result->n; i++) {
-		set_minmax(result, i);
+}
+
+/*
+ * fft_permute( ... )
+ *
+ * Put a radix 2 plan's worth of values into reflected order in place.
+ */
+static void
+fft_permute(fft_plan_t *plan, complex double *data)
+{
+	for (int i = 0; i < plan->n; i++) {
+		int k = plan->rev[i];
+		if (i < k) {
+			complex double tmp = data[i];
+			data[i] = data[k];
+			data[k] = tmp;
+		}
 	}
-#ifdef DEBUG_C_FFT
-	printf("\nDone.\n");
-#endif
-	return result;
 }
 
 /*
- * compute_ifft(...)
+ * The first two stages of butterflies on four values in reflected
+ * order, as one radix 4 butterfly. The roots of these stages are 1
+ * and W(4) = -i, which just swap the real and imaginary parts around,
+ * so there are no multiplies. The inverse uses W(4)^-1 = i.
+ */
+static inline void
+fft_radix4(complex double *out, complex double x0, complex double x1,
+		   complex double x2, complex double x3, int inverse)
+{
+	complex double a0 = x0 + x1;
+	complex double a1 = x0 - x1;
+	complex double a2 = x2 + x3;
+	complex double a3 = x2 - x3;
+	complex double t = (inverse) ? -cimag(a3) + creal(a3) * I :
+								   cimag(a3) - creal(a3) * I;
+
+	out[0] = a0 + a2;
+	out[2] = a0 - a2;
+	out[1] = a1 + t;
+	out[3] = a1 - t;
+}
+
+/*
+ * fft_first_stages( ... )
  *
- * Computes the inverse FFT (the time domain signal) from the given
- * FFT. This uses an algorithm described by Rick Lyons in his note
- * "Four Ways to Compute and Inverse FFT USing the Forward FFT Algorithm"
+ * Stages one and two, in one sweep rather than two, on 'n' values (a
+ * multiple of 4) already in reflected order.
  */
-sample_buf_t *
-compute_ifft(sample_buf_t *fft)
+static void
+fft_first_stages(complex double *data, int n, int inverse)
 {
-	sample_buf_t	*res;
+	for (int i = 0; i < n; i += 4) {
+		fft_radix4(data + i, data[i], data[i + 1], data[i + 2], data[i + 3],
+				   inverse);
+	}
+}
 
-	res = compute_fft(fft, fft->n, W_RECT, 0);
-	if (res == NULL) {
-		return NULL;
+/*
+ * fft_mixed( ... )
+ *
+ * The mixed radix FFT is the same idea as the radix 2 one, but the
+ * 'n' point transform is split into 'p' interleaved transforms of
+ * n / p points each, where p is the first factor. Those are computed
+ * recursively (from every p'th input sample) into consecutive runs
+ * of 'out', and then combined with a p point butterfly,
+ *
+ *     X[u + k*m] = sum over q of ( W(n)^(q*u) * Y_q[u] ) * W(p)^(q*k)
+ *
+ * where m = n / p and Y_q is the q'th sub-transform. 'stride' is
+ * the distance between this level's input samples, and N / n.
+ */
+static void
+fft_mixed(fft_plan_t *plan, complex double *out, const complex double *in,
+		  int n, int stride, const int *factors)
+{
+	const complex double *tw = plan->twiddle;
+	int p = factors[0];
+	int m = n / p;
+	int root_p = plan->n / p;	/* W(p) is every N/p'th root */
+
+	if (m == 1) {
+		for (int q = 0; q < p; q++) {
+			out[q] = in[q * stride];
+		}
+	} else {
+		for (int q = 0; q < p; q++) {
+			fft_mixed(plan, out + q * m, in + q * stride, m, stride * p,
+					  factors + 1);
+		}
+	}
+
+	for (int u = 0; u < m; u++) {
+		complex double y[7];
+
+		/* twiddle each sub-transform's value for this bin */
+		y[0] = out[u];
+		for (int q = 1; q < p; q++) {
+			y[q] = out[u + q * m] * tw[q * u * stride];
+		}
+		if (p == 2) {
+			/* the familiar butterfly */
+			out[u] = y[0] + y[1];
+			out[u + m] = y[0] - y[1];
+			continue;
+		}
+		/* a p point DFT of the twiddled values */
+		for (int k = 0; k < p; k++) {
+			complex double acc = y[0];
+			for (int q = 1; q < p; q++) {
+				acc += y[q] * tw[((q * k) % p) * root_p];
+			}
+			out[u + k * m] = acc;
+		}
+	}
+}
+
+/*
+ * fft_bluestein( ... )
+ *
+ * Transform N linear order (already windowed) values in place by
+ * convolving them with the chirp as described in fft_bluestein_plan().
+ * The inverse FFT of the convolution is done with the forward FFT by
+ * conjugating going in and coming out.
+ */
+static void
+fft_bluestein(fft_plan_t *plan, complex double *data)
+{
+	int n = plan->n;
+	int m = plan->sub->n;
+	complex double *w = plan->work;
+
+	for (int k = 0; k < n; k++) {
+		w[k] = data[k] * plan->chirp[k];
+	}
+	for (int k = n; k < m; k++) {
+		w[k] = 0;
+	}
+	fft_transform(plan->sub, w);
+	for (int k = 0; k < m; k++) {
+		w[k] = conj(w[k] * plan->chirp_fft[k]);
+	}
+	fft_transform(plan->sub, w);
+	for (int k = 0; k < n; k++) {
+		data[k] = plan->chirp[k] * conj(w[k]) / (double) m;
+	}
+}
+
+/*
+ * fft_window( ... )
+ *
+ * Copy the windowed samples, in order, into 'dst', zero padding if
+ * the sample buffer is shorter than the transform. 'dst' may be the
+ * sample data itself.
+ */
+static void
+fft_window(fft_plan_t *plan, sample_buf_t *iq, complex double *dst)
+{
+	for (int i = 0; i < plan->n; i++) {
+		dst[i] = (i < iq->n) ? plan->win[i] * buf_sample(iq, i) : 0;
+	}
+}
+
+/*
+ * fft_plan_threads( ... )
+ *
+ * Give the plan threads to use, 'pool' (NULL for just the calling
+ * thread). A four step plan spreads its sub-transforms over them, and
+ * each thread gets its own scratch space for gathering columns. The
+ * batch functions spread radix 2 frames over them. Returns 0 on
+ * success, or -1 with the plan still using its old threads.
+ */
+int
+fft_plan_threads(fft_plan_t *plan, struct thread_pool_t *pool)
+{
+	int n = thread_pool_size(pool);
+	complex double **scratch;
+
+	if (plan->algorithm != FFT_FOUR_STEP) {
+		plan->pool = pool;
+		return 0;
+	}
+	/* build the new scratch first, so a failure leaves the plan as it was */
+	scratch = calloc(n, sizeof(complex double *));
+	if (scratch == NULL) {
+		return -1;
+	}
+	for (int i = 0; i < n; i++) {
+		scratch[i] = simd_alloc(sizeof(complex double) *
+								FFT_FOUR_STEP_BLOCK * plan->n1);
+		if (scratch[i] == NULL) {
+			while (--i >= 0) {
+				free(scratch[i]);
+			}
+			free(scratch);
+			return -1;
+		}
+	}
+	for (int i = 0; i < plan->n_scratch; i++) {
+		free(plan->scratch[i]);
+	}
+	free(plan->scratch);
+	plan->scratch = scratch;
+	plan->n_scratch = n;
+	plan->pool = pool;
+	return 0;
+}
+
+/*
+ * What the four step tasks need to know about the transform.
+ */
+struct four_step_job {
+	fft_plan_t				*plan;
+	const complex double	*in;		/* samples */
+	int64_t					n_in;		/* number of samples (zero pad) */
+	int						stride;		/* distance between samples in 'in' */
+	const double			*win;		/* window, or NULL */
+	complex double			*out;		/* bins */
+};
+
+/*
+ * Steps 1 and 2 for a block of FFT_FOUR_STEP_BLOCK columns. The
+ * columns are gathered a row at a time, so each read is a run of
+ * adjacent samples, transformed in the worker's scratch space, and
+ * the twiddled results written a row at a time into plan->work.
+ */
+static void
+four_step_columns(void *arg, int task, int worker)
+{
+	struct four_step_job *job = arg;
+	fft_plan_t *plan = job->plan;
+	int n1 = plan->n1;
+	int n2 = plan->n2;
+	int c0 = task * FFT_FOUR_STEP_BLOCK;
+	complex double *s = plan->scratch[worker];
+
+	for (int n = 0; n < n1; n++) {
+		for (int b = 0; b < FFT_FOUR_STEP_BLOCK; b++) {
+			int ndx = n2 * n + c0 + b;
+			complex double v = (ndx < job->n_in) ?
+							job->in[(long long) ndx * job->stride] : 0;
+			s[b * n1 + n] = (job->win) ? job->win[ndx] * v : v;
+		}
+	}
+	for (int b = 0; b < FFT_FOUR_STEP_BLOCK; b++) {
+		fft_transform(plan->sub, s + b * n1);
+	}
+	for (int k = 0; k < n1; k++) {
+		for (int b = 0; b < FFT_FOUR_STEP_BLOCK; b++) {
+			long long m = ((long long) (c0 + b) * k) % plan->n;
+			complex double w = plan->tw_hi[m / n2] * plan->tw_lo[m % n2];
+			plan->work[(long long) k * n2 + c0 + b] = s[b * n1 + k] * w;
+		}
+	}
+}
+
+/*
+ * Steps 3 and 4 for a block of rows. The rows are already adjacent in
+ * plan->work so they are transformed there, and then written out a
+ * few bins at a time in transposed order.
+ */
+static void
+four_step_rows(void *arg, int task, int worker)
+{
+	struct four_step_job *job = arg;
+	fft_plan_t *plan = job->plan;
+	int n1 = plan->n1;
+	int n2 = plan->n2;
+	int r0 = task * FFT_FOUR_STEP_BLOCK;
+
+	(void) worker;
+	for (int b = 0; b < FFT_FOUR_STEP_BLOCK; b++) {
+		fft_transform(plan->sub2, plan->work + (long long) (r0 + b) * n2);
+	}
+	for (int k = 0; k < n2; k++) {
+		for (int b = 0; b < FFT_FOUR_STEP_BLOCK; b++) {
+			job->out[r0 + b + (long long) n1 * k] =
+						plan->work[(long long) (r0 + b) * n2 + k];
+		}
+	}
+}
+
+/*
+ * fft_four_step( ... )
+ *
+ * Run the four step transform from 'in' (every 'stride'th value of
+ * it) to 'out', which may be the same array since everything passes
+ * through plan->work in between.
+ */
+static void
+fft_four_step(fft_plan_t *plan, const complex double *in, int64_t n_in,
+			  int stride, const double *win, complex double *out)
+{
+	struct four_step_job job;
+
+	job.plan = plan;
+	job.in = in;
+	job.n_in = n_in;
+	job.stride = stride;
+	job.win = win;
+	job.out = out;
+	thread_pool_run(plan->pool, plan->n2 / FFT_FOUR_STEP_BLOCK,
+					four_step_columns, &job);
+	thread_pool_run(plan->pool, plan->n1 / FFT_FOUR_STEP_BLOCK,
+					four_step_rows, &job);
+}
+
+/*
+ * fft_transform( ... )
+ *
+ * The bare transform, in place, on plan->n values in their natural
+ * order with no window. This is the building block for things that
+ * need an FFT of some intermediate result rather than of a sample
+ * buffer. Only radix 2 plans may be used by more than one thread at
+ * a time, the others use scratch space in the plan.
+ */
+void
+fft_transform(fft_plan_t *plan, complex double *data)
+{
+	switch (plan->algorithm) {
+		case FFT_RADIX_2:
+			fft_permute(plan, data);
+			if (plan->n >= 4) {
+				fft_first_stages(data, plan->n, 0);
+				fft_butterflies(data, plan->n, 8, plan);
+			} else {
+				fft_butterflies(data, plan->n, 2, plan);
+			}
+			break;
+		case FFT_MIXED_RADIX:
+			memcpy(plan->work, data, sizeof(complex double) * plan->n);
+			fft_mixed(plan, data, plan->work, plan->n, 1, plan->factors);
+			break;
+		case FFT_BLUESTEIN:
+			fft_bluestein(plan, data);
+			break;
+		case FFT_FOUR_STEP:
+			fft_four_step(plan, data, plan->n, 1, NULL, data);
+			break;
 	}
+}
+
+/*
+ * fft_complex( ... )
+ *
+ * The full N point complex transform of the sample buffer.
+ */
+static void
+fft_complex(fft_plan_t *plan, sample_buf_t *iq, complex double *fft_result)
+{
+	int bins = plan->n;
 
-	/* swap in place and divide by N */
-	res->data[0] = res->data[0] / (double) res->n;
-	res->data[res->n / 2] = res->data[res->n / 2] / (double) res->n;
-	for (int k = 1; k < (res->n / 2); k++) {
-		complex double td;
-		td = res->data[k] / (double) res->n;
-		res->data[k] = res->data[res->n - k] / (double) res->n;
-		res->data[res->n - k] = td;
+	if (plan->algorithm == FFT_FOUR_STEP) {
+		fft_four_step(plan, iq->data, iq->n, iq->stride, plan->win,
+					  fft_result);
+		return;
+	} else if (plan->algorithm == FFT_MIXED_RADIX) {
+		fft_window(plan, iq, plan->work);
+		fft_mixed(plan, fft_result, plan->work, bins, 1, plan->factors);
+		return;
+	} else if (plan->algorithm == FFT_BLUESTEIN) {
+		fft_window(plan, iq, fft_result);
+		fft_bluestein(plan, fft_result);
+		return;
 	}
-	res->type = SAMPLE_SIGNAL;
-	return res;
+
+	/* This first bit is a reflection sort,
+	 * Most people do a 'sort in place' of
+	 * the source data, but I'm trying to preserve
+	 * that original data for other use, so I
+	 * 'sort into place' from the source into
+	 * my allocated array result->data
+	 *
+	 * The end result is each entry is 2^n away
+	 * from its sibling.
+	 */
+	if (fft_result == iq->data) {
+		/*
+		 * Unless the caller asked to transform in place, then it
+		 * is the classic version, swap each pair of reflected
+		 * indices once, windowing both as they are swapped.
+		 */
+		for (int i = 0; i < bins; i++) {
+			int k = plan->rev[i];
+			if (i < k) {
+				complex double tmp = plan->win[i] * fft_result[i];
+				fft_result[i] = plan->win[k] * fft_result[k];
+				fft_result[k] = tmp;
+			} else if (i == k) {
+				fft_result[i] *= plan->win[i];
+			}
+		}
+		if (bins >= 4) {
+			fft_first_stages(fft_result, bins, 0);
+			fft_butterflies(fft_result, bins, 8, plan);
+		} else {
+			fft_butterflies(fft_result, bins, 2, plan);
+		}
+		return;
+	}
+
+	if (bins < 4) {
+		for (int i = 0; i < bins; i++) {
+			int k = plan->rev[i];
+			fft_result[i] = (k < iq->n) ? plan->win[k] * buf_sample(iq, k) : 0;
+		}
+		fft_butterflies(fft_result, bins, 2, plan);
+		return;
+	}
+
+	/*
+	 * Every group of four in reflected order is a 4 point DFT, so
+	 * rather than sorting (and windowing) them into place and then
+	 * making a pass for each of the first two stages, do those two
+	 * stages on the four values as they are loaded. The remaining
+	 * stages start with 4 bin DFTs.
+	 */
+	for (int i = 0; i < bins; i += 4) {
+		complex double x[4];
+		for (int j = 0; j < 4; j++) {
+			/* reflected index comes from the plan */
+			int k = plan->rev[i + j];
+#ifdef DEBUG_SWAP_SORT
+			printf("index %d gets index %d\n", i + j, k);
+#endif
+			/* if sample length is less than bins, pad with 0, and window */
+			x[j] = (k < iq->n) ? plan->win[k] * buf_sample(iq, k) : 0;
+		}
+		fft_radix4(fft_result + i, x[0], x[1], x[2], x[3], 0);
+	}
+#ifdef DEBUG_C_FFT
+	printf("FFT Calc: %d stage bufferfly calculation\n", plan->bits);
+#endif
+	fft_butterflies(fft_result, bins, 8, plan);
+}
+
+/*
+ * fft_real( ... )
+ *
+ * When the signal is real there is no point in running an N point
+ * complex FFT with all of the imaginary parts set to zero. Instead
+ * the even samples are packed into the real parts, and the odd
+ * samples into the imaginary parts, of an N/2 point complex signal,
+ *
+ *     z[m] = x[2m] + i * x[2m + 1]
+ *
+ * and that is transformed with an N/2 point FFT, Z[k]. The two
+ * interleaved transforms are then "untangled" out of Z. The even
+ * and odd sample spectra are
+ *
+ *     E[k] = (Z[k] + conj(Z[N/2 - k])) / 2
+ *     O[k] = (Z[k] - conj(Z[N/2 - k])) / 2i
+ *
+ * and the last butterfly stage of the full size FFT combines them,
+ *
+ *     X[k] = E[k] + W(N)^k * O[k]
+ *
+ * The top half of a real signal's spectrum is the complex conjugate
+ * of the bottom half so it is filled in by reflection. This does
+ * about half the work of the complex transform.
+ */
+static void
+fft_real(fft_plan_t *plan, sample_buf_t *iq, complex double *fft_result)
+{
+	int bins = plan->n;
+	int half = bins / 2;
+	complex double z0;
+
+	/*
+	 * Reflection sort for the half size transform. Its reflected
+	 * indices are the full size ones shifted down a bit (the top
+	 * bit of the index is always 0 in the bottom half).
+	 */
+	if (fft_result == iq->data) {
+		/*
+		 * In place, pack first. z[m] only reads samples at 2m and
+		 * above, so walking up from 0 never reads a value that has
+		 * already been overwritten. Then swap into reflected order.
+		 */
+		for (int m = 0; m < half; m++) {
+			fft_result[m] = plan->win[2 * m] * creal(iq->data[2 * m]) +
+				plan->win[2 * m + 1] * creal(iq->data[2 * m + 1]) * I;
+		}
+		for (int i = 0; i < half; i++) {
+			int k = plan->rev[i] >> 1;
+			if (i < k) {
+				complex double tmp = fft_result[i];
+				fft_result[i] = fft_result[k];
+				fft_result[k] = tmp;
+			}
+		}
+		if (half >= 4) {
+			fft_first_stages(fft_result, half, 0);
+		}
+	} else for (int i = 0; i < half; i += 4) {
+		complex double x[4];
+
+		/* packed, windowed, and the first two stages, as in fft_complex() */
+		for (int j = 0; (j < 4) && (i + j < half); j++) {
+			int k = (plan->rev[i + j] >> 1) * 2;
+			double re, im;
+
+			re = (k < iq->n) ? plan->win[k] * creal(buf_sample(iq, k)) : 0;
+			im = ((k + 1) < iq->n) ?
+					plan->win[k + 1] * creal(buf_sample(iq, k + 1)) : 0;
+			x[j] = re + im * I;
+		}
+		if (half < 4) {
+			for (int j = 0; j < half; j++) {
+				fft_result[j] = x[j];
+			}
+		} else {
+			fft_radix4(fft_result + i, x[0], x[1], x[2], x[3], 0);
+		}
+	}
+	fft_butterflies(fft_result, half, (half >= 4) ? 8 : 2, plan);
+
+	/*
+	 * Untangle. Bins k and N/2 - k are built from the same two values
+	 * of Z, so do them as a pair to work in place. Bin 0 (DC) and bin
+	 * N/2 (Nyquist) both come from Z[0] alone.
+	 */
+	z0 = fft_result[0];
+	fft_result[0] = creal(z0) + cimag(z0);
+	fft_result[half] = creal(z0) - cimag(z0);
+	for (int k = 1; k <= half / 2; k++) {
+		complex double zk = fft_result[k];
+		complex double zm = fft_result[half - k];
+		complex double ek, ok, em, om;
+
+		ek = (zk + conj(zm)) * 0.5;
+		ok = (zk - conj(zm)) * -0.5 * I;
+		em = (zm + conj(zk)) * 0.5;
+		om = (zm - conj(zk)) * -0.5 * I;
+		fft_result[k] = ek + plan->twiddle[k] * ok;
+		fft_result[half - k] = em + plan->twiddle[half - k] * om;
+	}
+	/* and reflect the conjugates into the top half */
+	for (int k = 1; k < half; k++) {
+		fft_result[bins - k] = conj(fft_result[k]);
+	}
+}
+
+/*
+ * fft_execute_into( ... )
+ *
+ * Compute the FFT of the sample buffer using a previously built
+ * plan, putting the bins into a buffer the caller supplies. That
+ * buffer must hold exactly plan->n samples. Nothing is allocated
+ * so a streaming loop can reuse one result buffer forever. Passing
+ * the input buffer as the result transforms it in place, which
+ * also needs the input to be exactly plan->n samples long.
+ *
+ * Buffers marked SAMPLE_REAL_SIGNAL are transformed with the half
+ * size real FFT above when the size is a power of 2, everything
+ * else with the complex FFT.
+ */
+sample_buf_t *
+fft_execute_into(fft_plan_t *plan, sample_buf_t *iq, sample_buf_t *result,
+				 double center)
+{
+	int bins = plan->n;
+	double half_span = (double) iq->r / 2.0;
+	int is_real = (iq->type == SAMPLE_REAL_SIGNAL) && (bins > 1) &&
+				  (plan->algorithm == FFT_RADIX_2);
+
+	if (result->n != bins) {
+		fprintf(stderr, "fft_execute_into: result holds %lld samples, not %d\n",
+				(long long) result->n, bins);
+		return NULL;
+	}
+	if (result->stride != 1) {
+		fprintf(stderr, "fft_execute_into: result can't be a strided view\n");
+		return NULL;
+	}
+
+	if (is_real) {
+		fft_real(plan, iq, result->data);
+	} else {
+		fft_complex(plan, iq, result->data);
+	}
+
+	/* keep the sample rate from the source data. */
+	result->r = iq->r;
+	result->center_freq = center;
+	result->min_freq = (center == 0) ? 0 : center - half_span;
+	result->max_freq = (center == 0) ? half_span * 2 : center + half_span;
+
+	/* If center is 0  we treat it like a direct sample */
+	result->type = (center == 0) ? SAMPLE_REAL_FFT : SAMPLE_FFT;
+
+	/* This sets the min and maximum magnitude values in the result */
+	reset_minmax(result);
+	for (int i = 0; i < result->n; i++) {
+		set_minmax(result, i);
+	}
+#ifdef DEBUG_C_FFT
+	printf("\nDone.\n");
+#endif
+	return result;
+}
+
+/*
+ * fft_execute_inplace( ... )
+ *
+ * Replace the samples in the buffer with their FFT.
+ */
+sample_buf_t *
+fft_execute_inplace(fft_plan_t *plan, sample_buf_t *iq, double center)
+{
+	return fft_execute_into(plan, iq, iq, center);
+}
+
+/*
+ * fft_execute( ... )
+ *
+ * Compute the FFT of the sample buffer using a previously built
+ * plan. The result is a newly allocated buffer of plan->n bins.
+ */
+sample_buf_t *
+fft_execute(fft_plan_t *plan, sample_buf_t *iq, double center)
+{
+	sample_buf_t *result;
+
+	result = alloc_buf_noclear(plan->n, iq->r);
+	if (result == NULL) {
+		return NULL;
+	}
+	if (fft_execute_into(plan, iq, result, center) == NULL) {
+		free_buf(result);
+		return NULL;
+	}
+	return result;
+}
+
+/*
+ * The most recently used plans, one for the forward transforms, one
+ * for the inverse, so a windowed FFT followed by its inverse doesn't
+ * throw away the other's tables, and one each for single precision
+ * and split complex transforms, which need a plan from fft_plan_f()
+ * or fft_plan_split(). compute_fft() and friends keep them around,
+ * so calling them over and over with the same number of bins and
+ * window only builds the tables once. Like read_header() in signal.c,
+ * that makes them not re-entrant; threaded callers should hold their
+ * own plan.
+ */
+#define PLAN_FORWARD	0
+#define PLAN_INVERSE	1
+#define PLAN_FLOAT		2
+#define PLAN_SPLIT		3
+#define PLAN_SLOTS		4
+
+static fft_plan_t *
+cached_plan(int slot, int64_t bins, window_function window)
+{
+	static fft_plan_t *(* const build[PLAN_SLOTS])(int, window_function) = {
+		fft_plan, fft_plan, fft_plan_f, fft_plan_split
+	};
+	static fft_plan_t *plans[PLAN_SLOTS];
+	fft_plan_t *plan = plans[slot];
+
+	if (bins > INT_MAX) {
+		fprintf(stderr, "fft: %lld bins is too many for one plan\n",
+				(long long) bins);
+		return NULL;
+	}
+	if ((plan == NULL) || (plan->n != bins) || (plan->window != window)) {
+		free_fft_plan(plan);
+		plan = plans[slot] = build[slot]((int) bins, window);
+	}
+	return plan;
+}
+
+/*
+ * fft( ... )
+ *
+ * Compute the complex FFT in 'n' bins given the sample
+ * buffer. This is a thin wrapper around a plan.
+ */
+sample_buf_t *
+compute_fft(sample_buf_t *iq, int bins, window_function window, double center)
+{
+	fft_plan_t *plan = cached_plan(PLAN_FORWARD, bins, window);
+
+	return (plan == NULL) ? NULL : fft_execute(plan, iq, center);
+}
+
+/*
+ * compute_fft_into( ... )
+ *
+ * As compute_fft() but the bins go into 'result', which must be
+ * 'bins' samples long, rather than a newly allocated buffer.
+ */
+sample_buf_t *
+compute_fft_into(sample_buf_t *iq, sample_buf_t *result, int bins,
+				 window_function window, double center)
+{
+	fft_plan_t *plan = cached_plan(PLAN_FORWARD, bins, window);
+
+	return (plan == NULL) ? NULL : fft_execute_into(plan, iq, result, center);
+}
+
+/*
+ * compute_fft_inplace( ... )
+ *
+ * As compute_fft() but the samples in the buffer are replaced by
+ * their FFT, the number of bins is the buffer length.
+ */
+sample_buf_t *
+compute_fft_inplace(sample_buf_t *iq, window_function window, double center)
+{
+	fft_plan_t *plan = cached_plan(PLAN_FORWARD, iq->n, window);
+
+	return (plan == NULL) ? NULL : fft_execute_inplace(plan, iq, center);
+}
+
+/*
+ * fft_inverse( ... )
+ *
+ * The inverse transform of the bins in 'iq' into 'out' (which can be
+ * iq->data). A radix 2 plan runs the same butterflies with conjugated
+ * roots, W(N)^-k rather than W(N)^k. The 1/N is folded into the pass
+ * that puts the bins in reflected order rather than being another
+ * pass at the end, N is a power of 2 so this is exact and gives the
+ * same values as scaling afterward. The other algorithms use
+ * ifft(x) = conj(fft(conj(x))) / N, with the conjugates done as the
+ * values are copied in and scaled.
+ */
+static void
+fft_inverse(fft_plan_t *plan, sample_buf_t *iq, complex double *out)
+{
+	int n = plan->n;
+	double scale = 1.0 / (double) n;
+
+	if (plan->algorithm != FFT_RADIX_2) {
+		for (int i = 0; i < n; i++) {
+			out[i] = (i < iq->n) ? conj(buf_sample(iq, i)) : 0;
+		}
+		fft_transform(plan, out);
+		for (int i = 0; i < n; i++) {
+			out[i] = conj(out[i]) * scale;
+		}
+		return;
+	}
+
+	if (out == iq->data) {
+		for (int i = 0; i < n; i++) {
+			int k = plan->rev[i];
+			if (i < k) {
+				complex double tmp = out[i];
+				out[i] = out[k] * scale;
+				out[k] = tmp * scale;
+			} else if (i == k) {
+				out[i] *= scale;
+			}
+		}
+		if (n >= 4) {
+			fft_first_stages(out, n, 1);
+		}
+	} else if (n < 4) {
+		for (int i = 0; i < n; i++) {
+			int k = plan->rev[i];
+			out[i] = (k < iq->n) ? buf_sample(iq, k) * scale : 0;
+		}
+	} else {
+		/* first two stages on the way in, as fft_complex() does */
+		for (int i = 0; i < n; i += 4) {
+			complex double x[4];
+			for (int j = 0; j < 4; j++) {
+				int k = plan->rev[i + j];
+				x[j] = (k < iq->n) ? buf_sample(iq, k) * scale : 0;
+			}
+			fft_radix4(out + i, x[0], x[1], x[2], x[3], 1);
+		}
+	}
+	simd_fft_stages(out, n, (n >= 4) ? 4 : 1, plan->stage_itw);
+}
+
+/*
+ * fft_execute_inverse_into( ... )
+ *
+ * Turn the bins in 'iq' back into plan->n samples in 'result', which
+ * may be 'iq' itself. The plan's window isn't undone (it can't be),
+ * so use a W_RECT plan to get back exactly what went into the forward
+ * transform.
+ */
+sample_buf_t *
+fft_execute_inverse_into(fft_plan_t *plan, sample_buf_t *iq,
+						 sample_buf_t *result)
+{
+	if (result->n != plan->n) {
+		fprintf(stderr, "fft_execute_inverse_into: result holds %lld "
+				"samples, not %d\n", (long long) result->n, plan->n);
+		return NULL;
+	}
+	if (result->stride != 1) {
+		fprintf(stderr, "fft_execute_inverse_into: result can't be a "
+				"strided view\n");
+		return NULL;
+	}
+	fft_inverse(plan, iq, result->data);
+
+	result->r = iq->r;
+	result->center_freq = 0;
+	result->min_freq = 0;
+	result->max_freq = iq->r;
+	result->type = SAMPLE_SIGNAL;
+	reset_minmax(result);
+	for (int i = 0; i < result->n; i++) {
+		set_minmax(result, i);
+	}
+	return result;
+}
+
+/*
+ * fft_execute_inverse_inplace( ... )
+ *
+ * Replace the bins in the buffer with the samples they came from.
+ */
+sample_buf_t *
+fft_execute_inverse_inplace(fft_plan_t *plan, sample_buf_t *iq)
+{
+	return fft_execute_inverse_into(plan, iq, iq);
+}
+
+/*
+ * fft_execute_inverse( ... )
+ *
+ * As fft_execute_inverse_into() with a newly allocated result.
+ */
+sample_buf_t *
+fft_execute_inverse(fft_plan_t *plan, sample_buf_t *iq)
+{
+	sample_buf_t *result = alloc_buf_noclear(plan->n, iq->r);
+
+	if (result == NULL) {
+		return NULL;
+	}
+	if (fft_execute_inverse_into(plan, iq, result) == NULL) {
+		free_buf(result);
+		return NULL;
+	}
+	return result;
+}
+
+/*
+ * What the batch tasks need to know.
+ */
+struct batch_job {
+	fft_plan_t		*plan;
+	sample_buf_t	*in;		/* samples */
+	int				frames;		/* number of frames */
+	int				stride;		/* samples from one frame to the next */
+	int				lanes;		/* frames interleaved per task */
+	complex double	*scratch;	/* lanes * n per worker */
+	complex double	*out;		/* frames * n bins */
+};
+
+/*
+ * One frame on its own, using the regular single transform code on
+ * a copy of the buffer header that points at the frame.
+ */
+static void
+batch_frame(struct batch_job *job, int f)
+{
+	fft_plan_t *plan = job->plan;
+	sample_buf_t frame = *(job->in);
+	long long off = (long long) f * job->stride;
+
+	frame.data = job->in->data + off * job->in->stride;
+	frame.flags = BUF_VIEW;
+	frame.n = (off >= job->in->n) ? 0 :
+			(job->in->n - off < plan->n) ? (int) (job->in->n - off) : plan->n;
+	if ((frame.type == SAMPLE_REAL_SIGNAL) && (plan->n > 1) &&
+		(plan->algorithm == FFT_RADIX_2)) {
+		fft_real(plan, &frame, job->out + (long long) f * plan->n);
+	} else {
+		fft_complex(plan, &frame, job->out + (long long) f * plan->n);
+	}
+}
+
+/*
+ * A group of 'lanes' frames. With lanes > 1 the frames are loaded
+ * interleaved, sample i of frame l at [i * lanes + l], so that every
+ * butterfly stage, even the first ones with only one or two
+ * butterflies per group, fills a whole vector register with the same
+ * butterfly from different frames.
+ */
+static void
+batch_task(void *arg, int task, int worker)
+{
+	struct batch_job *job = arg;
+	fft_plan_t *plan = job->plan;
+	int n = plan->n;
+	int lanes = job->lanes;
+	int f0 = task * lanes;
+	complex double *w;
+
+	if ((lanes == 1) || (f0 + lanes > job->frames)) {
+		for (int f = f0; (f < f0 + lanes) && (f < job->frames); f++) {
+			batch_frame(job, f);
+		}
+		return;
+	}
+
+	w = job->scratch + (long long) worker * lanes * n;
+	for (int i = 0; i < n; i++) {
+		int k = plan->rev[i];
+		for (int l = 0; l < lanes; l++) {
+			long long ndx = (long long) (f0 + l) * job->stride + k;
+			w[i * lanes + l] = (ndx < job->in->n) ?
+							plan->win[k] * buf_sample(job->in, ndx) : 0;
+		}
+	}
+	/* the first two stages the same way fft_complex() does them */
+	if (n >= 4) {
+		for (int i = 0; i < n; i += 4) {
+			for (int l = 0; l < lanes; l++) {
+				complex double *x = w + i * lanes + l;
+				complex double out[4];
+
+				fft_radix4(out, x[0], x[lanes], x[2 * lanes], x[3 * lanes], 0);
+				for (int j = 0; j < 4; j++) {
+					x[j * lanes] = out[j];
+				}
+			}
+		}
+	}
+	simd_fft_butterflies_x(w, n, lanes, (n >= 4) ? 4 : 1, plan->stage_tw);
+	for (int l = 0; l < lanes; l++) {
+		complex double *out = job->out + (long long) (f0 + l) * n;
+		for (int i = 0; i < n; i++) {
+			out[i] = w[i * lanes + l];
+		}
+	}
+}
+
+/*
+ * fft_execute_batch_into( ... )
+ *
+ * Transform 'frames' frames of plan->n samples each. Frame f starts
+ * 'stride' samples after frame f - 1 (so stride == plan->n is back
+ * to back frames, smaller strides overlap), and any part of a frame
+ * past the end of the samples is zero. The bins of frame f go to
+ * result->data[f * plan->n] onward, so the result must hold exactly
+ * frames * plan->n samples.
+ *
+ * The plan is shared by every frame. Complex radix 2 frames are
+ * done several at a time, interleaved, when the CPU has wide
+ * vectors, and radix 2 frames are spread over the plan's threads
+ * (see fft_plan_threads()).
+ */
+sample_buf_t *
+fft_execute_batch_into(fft_plan_t *plan, sample_buf_t *iq, int frames,
+					   int stride, sample_buf_t *result, double center)
+{
+	struct batch_job job;
+	double half_span = (double) iq->r / 2.0;
+	int parallel = (plan->algorithm == FFT_RADIX_2);
+	int workers = (parallel) ? thread_pool_size(plan->pool) : 1;
+	int n_tasks;
+
+	if ((frames < 1) || (stride < 1) ||
+		((long long) result->n != (long long) frames * plan->n)) {
+		fprintf(stderr, "fft_execute_batch_into: needs %d frames of %d "
+				"bins in the result\n", frames, plan->n);
+		return NULL;
+	}
+	if ((result->data == iq->data) || (result->stride != 1)) {
+		fprintf(stderr, "fft_execute_batch_into: can't work in place\n");
+		return NULL;
+	}
+
+	job.plan = plan;
+	job.in = iq;
+	job.frames = frames;
+	job.stride = stride;
+	job.out = result->data;
+	job.scratch = NULL;
+	job.lanes = 1;
+	if (parallel && (iq->type != SAMPLE_REAL_SIGNAL)) {
+		job.lanes = simd_batch_lanes();
+	}
+	if ((job.lanes > 1) && (frames >= job.lanes)) {
+		job.scratch = simd_alloc(sizeof(complex double) * workers *
+							 job.lanes * plan->n);
+	}
+	if (job.scratch == NULL) {
+		job.lanes = 1;
+	}
+	n_tasks = (frames + job.lanes - 1) / job.lanes;
+	thread_pool_run((parallel) ? plan->pool : NULL, n_tasks, batch_task, &job);
+	free(job.scratch);
+
+	result->r = iq->r;
+	result->center_freq = center;
+	result->min_freq = (center == 0) ? 0 : center - half_span;
+	result->max_freq = (center == 0) ? half_span * 2 : center + half_span;
+	result->type = (center == 0) ? SAMPLE_REAL_FFT : SAMPLE_FFT;
+	reset_minmax(result);
+	for (int i = 0; i < result->n; i++) {
+		set_minmax(result, i);
+	}
+	return result;
+}
+
+/*
+ * fft_execute_batch( ... )
+ *
+ * As fft_execute_batch_into() with a newly allocated result.
+ */
+sample_buf_t *
+fft_execute_batch(fft_plan_t *plan, sample_buf_t *iq, int frames, int stride,
+				  double center)
+{
+	sample_buf_t *result;
+	int64_t size = (int64_t) frames * plan->n;
+
+	if ((frames < 1) || (size > (int64_t) (SIZE_MAX / sizeof(sample_t)))) {
+		fprintf(stderr, "fft_execute_batch: can't hold %d frames of %d "
+				"bins\n", frames, plan->n);
+		return NULL;
+	}
+	result = alloc_buf_noclear(size, iq->r);
+	if (result == NULL) {
+		return NULL;
+	}
+	if (fft_execute_batch_into(plan, iq, frames, stride, result,
+							   center) == NULL) {
+		free_buf(result);
+		return NULL;
+	}
+	return result;
+}
+
+/*
+ * fft_plan_f( ... )
+ *
+ * Build a plan for single precision transforms. This is a regular
+ * plan with float copies of the window and unit roots added. Single
+ * precision is meant for the real time paths, which are powers of 2,
+ * so only radix 2 sizes are supported.
+ */
+fft_plan_t *
+fft_plan_f(int bins, window_function window)
+{
+	fft_plan_t *plan = plan_build(bins, window, 0);
+
+	if (plan == NULL) {
+		return NULL;
+	}
+	if (plan->algorithm != FFT_RADIX_2) {
+		fprintf(stderr, "fft_plan_f: %d is not a power of 2\n", bins);
+		free_fft_plan(plan);
+		return NULL;
+	}
+	plan->winf = window_table_f(window, bins);
+	plan->stage_twf = simd_alloc(sizeof(complex float) * bins);
+	if ((plan->winf == NULL) || (plan->stage_twf == NULL)) {
+		fprintf(stderr, "fft_plan_f: out of memory\n");
+		free_fft_plan(plan);
+		return NULL;
+	}
+	/* round from the double tables, so both precisions agree */
+	for (int i = 0; i < bins; i++) {
+		plan->stage_twf[i] = (complex float) plan->stage_tw[i];
+	}
+	return plan;
+}
+
+/*
+ * fft_execute_f_into( ... )
+ *
+ * Single precision version of fft_execute_into(). Real signals
+ * are done with the complex transform.
+ */
+sample_buf_f_t *
+fft_execute_f_into(fft_plan_t *plan, sample_buf_f_t *iq,
+				   sample_buf_f_t *result, double center)
+{
+	int bins = plan->n;
+	double half_span = (double) iq->r / 2.0;
+	complex float *fft_result = result->data;
+
+	if ((plan->winf == NULL) || (result->n != bins)) {
+		fprintf(stderr, "fft_execute_f_into: needs a single precision "
+				"plan and a %d sample result\n", bins);
+		return NULL;
+	}
+
+	/* windowed reflection sort, as in fft_complex() */
+	if (fft_result == iq->data) {
+		for (int i = 0; i < bins; i++) {
+			fft_result[i] *= plan->winf[i];
+		}
+		for (int i = 0; i < bins; i++) {
+			int k = plan->rev[i];
+			if (i < k) {
+				complex float tmp = fft_result[i];
+				fft_result[i] = fft_result[k];
+				fft_result[k] = tmp;
+			}
+		}
+	} else for (int i = 0; i < bins; i++) {
+		int k = plan->rev[i];
+		fft_result[i] = (k < iq->n) ? plan->winf[k] * iq->data[k] : 0;
+	}
+	simd_fft_butterflies_f(fft_result, bins, plan->stage_twf);
+
+	result->r = iq->r;
+	result->center_freq = center;
+	result->min_freq = (center == 0) ? 0 : center - half_span;
+	result->max_freq = (center == 0) ? half_span * 2 : center + half_span;
+	result->type = (center == 0) ? SAMPLE_REAL_FFT : SAMPLE_FFT;
+	reset_minmax(result);
+	for (int i = 0; i < result->n; i++) {
+		set_minmax(result, i);
+	}
+	return result;
+}
+
+/*
+ * fft_execute_f( ... )
+ *
+ * Single precision version of fft_execute().
+ */
+sample_buf_f_t *
+fft_execute_f(fft_plan_t *plan, sample_buf_f_t *iq, double center)
+{
+	sample_buf_f_t *result;
+
+	result = alloc_buf_f(plan->n, iq->r);
+	if (result == NULL) {
+		return NULL;
+	}
+	if (fft_execute_f_into(plan, iq, result, center) == NULL) {
+		free_buf_f(result);
+		return NULL;
+	}
+	return result;
+}
+
+/*
+ * compute_fft_f( ... )
+ *
+ * Single precision version of compute_fft(), with its own cached
+ * plan (and so also not re-entrant).
+ */
+sample_buf_f_t *
+compute_fft_f(sample_buf_f_t *iq, int bins, window_function window,
+			  double center)
+{
+	fft_plan_t *plan = cached_plan(PLAN_FLOAT, bins, window);
+
+	return (plan == NULL) ? NULL : fft_execute_f(plan, iq, center);
+}
+
+/*
+ * fft_plan_split( ... )
+ *
+ * Build a plan for split complex transforms, a regular radix 2 plan
+ * with the stage roots split into real and imaginary tables.
+ */
+fft_plan_t *
+fft_plan_split(int bins, window_function window)
+{
+	fft_plan_t *plan = plan_build(bins, window, 0);
+
+	if (plan == NULL) {
+		return NULL;
+	}
+	if (plan->algorithm != FFT_RADIX_2) {
+		fprintf(stderr, "fft_plan_split: %d is not a power of 2\n", bins);
+		free_fft_plan(plan);
+		return NULL;
+	}
+	plan->stage_re = simd_alloc(sizeof(double) * bins);
+	plan->stage_im = simd_alloc(sizeof(double) * bins);
+	if ((plan->stage_re == NULL) || (plan->stage_im == NULL)) {
+		fprintf(stderr, "fft_plan_split: out of memory\n");
+		free_fft_plan(plan);
+		return NULL;
+	}
+	for (int i = 0; i < bins; i++) {
+		plan->stage_re[i] = creal(plan->stage_tw[i]);
+		plan->stage_im[i] = cimag(plan->stage_tw[i]);
+	}
+	return plan;
+}
+
+/*
+ * fft_radix4() on split values, x[] are the real parts and y[] the
+ * imaginary parts of the four inputs.
+ */
+static inline void
+fft_radix4_split(double *re, double *im, const double *x, const double *y)
+{
+	double a0r = x[0] + x[1], a0i = y[0] + y[1];
+	double a1r = x[0] - x[1], a1i = y[0] - y[1];
+	double a2r = x[2] + x[3], a2i = y[2] + y[3];
+	double a3r = x[2] - x[3], a3i = y[2] - y[3];
+
+	re[0] = a0r + a2r;
+	im[0] = a0i + a2i;
+	re[2] = a0r - a2r;
+	im[2] = a0i - a2i;
+	/* times -i */
+	re[1] = a1r + a3i;
+	im[1] = a1i - a3r;
+	re[3] = a1r - a3i;
+	im[3] = a1i + a3r;
+}
+
+/*
+ * fft_execute_split_into( ... )
+ *
+ * Split complex version of fft_execute_into(), the same bins as
+ * the interleaved transform, in re[] and im[]. Real signals are done
+ * with the complex transform.
+ */
+sample_buf_split_t *
+fft_execute_split_into(fft_plan_t *plan, sample_buf_split_t *iq,
+					   sample_buf_split_t *result, double center)
+{
+	int bins = plan->n;
+	double half_span = (double) iq->r / 2.0;
+	double *re = result->re, *im = result->im;
+
+	if ((plan->stage_re == NULL) || (result->n != bins)) {
+		fprintf(stderr, "fft_execute_split_into: needs a split plan "
+				"and a %d sample result\n", bins);
+		return NULL;
+	}
+
+	if (re == iq->re) {
+		/* windowed swap in place, as fft_complex() does */
+		for (int i = 0; i < bins; i++) {
+			int k = plan->rev[i];
+			if (i < k) {
+				double tr = plan->win[i] * re[i], ti = plan->win[i] * im[i];
+				re[i] = plan->win[k] * re[k];
+				im[i] = plan->win[k] * im[k];
+				re[k] = tr;
+				im[k] = ti;
+			} else if (i == k) {
+				re[i] *= plan->win[i];
+				im[i] *= plan->win[i];
+			}
+		}
+		for (int i = 0; i + 4 <= bins; i += 4) {
+			double x[4] = { re[i], re[i + 1], re[i + 2], re[i + 3] };
+			double y[4] = { im[i], im[i + 1], im[i + 2], im[i + 3] };
+			fft_radix4_split(re + i, im + i, x, y);
+		}
+	} else for (int i = 0; i < bins; i += 4) {
+		double x[4], y[4];
+
+		/* load, window, and the first two stages in one go */
+		for (int j = 0; (j < 4) && (i + j < bins); j++) {
+			int k = plan->rev[i + j];
+			x[j] = (k < iq->n) ? plan->win[k] * iq->re[k] : 0;
+			y[j] = (k < iq->n) ? plan->win[k] * iq->im[k] : 0;
+		}
+		if (bins < 4) {
+			for (int j = 0; j < bins; j++) {
+				re[j] = x[j];
+				im[j] = y[j];
+			}
+		} else {
+			fft_radix4_split(re + i, im + i, x, y);
+		}
+	}
+	simd_fft_stages_split(re, im, bins, (bins >= 4) ? 4 : 1, plan->stage_re,
+						  plan->stage_im);
+
+	result->r = iq->r;
+	result->center_freq = center;
+	result->min_freq = (center == 0) ? 0 : center - half_span;
+	result->max_freq = (center == 0) ? half_span * 2 : center + half_span;
+	result->type = (center == 0) ? SAMPLE_REAL_FFT : SAMPLE_FFT;
+	reset_minmax(result);
+	for (int i = 0; i < bins; i++) {
+		double m = sqrt(re[i] * re[i] + im[i] * im[i]);
+		result->sample_min = (m < result->sample_min) ? m : result->sample_min;
+		result->sample_max = (m > result->sample_max) ? m : result->sample_max;
+	}
+	return result;
+}
+
+/*
+ * fft_execute_split( ... )
+ *
+ * Split complex version of fft_execute().
+ */
+sample_buf_split_t *
+fft_execute_split(fft_plan_t *plan, sample_buf_split_t *iq, double center)
+{
+	sample_buf_split_t *result;
+
+	result = alloc_buf_split(plan->n, iq->r);
+	if (result == NULL) {
+		return NULL;
+	}
+	if (fft_execute_split_into(plan, iq, result, center) == NULL) {
+		free_buf_split(result);
+		return NULL;
+	}
+	return result;
+}
+
+/*
+ * compute_fft_split( ... )
+ *
+ * Split complex version of compute_fft(), with its own cached plan
+ * (and so also not re-entrant).
+ */
+sample_buf_split_t *
+compute_fft_split(sample_buf_split_t *iq, int bins, window_function window,
+				  double center)
+{
+	fft_plan_t *plan = cached_plan(PLAN_SPLIT, bins, window);
+
+	return (plan == NULL) ? NULL : fft_execute_split(plan, iq, center);
+}
+
+/*
+ * fft_execute_i_into( ... )
+ *
+ * The FFT of an integer sample buffer. The first plan->n samples are
+ * converted straight into the result buffer (zero padded if there
+ * are fewer) and transformed there in place, so there is never a
+ * double precision copy of the input. The result is exactly what
+ * fft_execute_into() gives for buf_from_int() of the buffer.
+ */
+sample_buf_t *
+fft_execute_i_into(fft_plan_t *plan, sample_buf_i_t *iq, sample_buf_t *result,
+				   double center)
+{
+	sample_buf_t frame;
+	int bins = plan->n;
+	int len = (iq->n < bins) ? (int) iq->n : bins;
+
+	if (result->n != bins) {
+		fprintf(stderr, "fft_execute_i_into: result holds %lld samples, "
+				"not %d\n", (long long) result->n, bins);
+		return NULL;
+	}
+	if (result->stride != 1) {
+		fprintf(stderr, "fft_execute_i_into: result can't be a strided view\n");
+		return NULL;
+	}
+	buf_int_samples(iq, 0, len, result->data);
+	memset(result->data + len, 0, sizeof(complex double) * (bins - len));
+
+	/* a header over the converted samples, for the in place transform */
+	frame = *result;
+	frame.r = iq->r;
+	frame.type = iq->type;
+	frame.pool = NULL;
+	frame.nxt = NULL;
+	return fft_execute_into(plan, &frame, result, center);
+}
+
+/*
+ * fft_execute_i( ... )
+ *
+ * As above, into a newly allocated buffer of plan->n bins.
+ */
+sample_buf_t *
+fft_execute_i(fft_plan_t *plan, sample_buf_i_t *iq, double center)
+{
+	sample_buf_t *result;
+
+	result = alloc_buf_noclear(plan->n, iq->r);
+	if (result == NULL) {
+		return NULL;
+	}
+	if (fft_execute_i_into(plan, iq, result, center) == NULL) {
+		free_buf(result);
+		return NULL;
+	}
+	return result;
+}
+
+/*
+ * compute_fft_i( ... )
+ *
+ * compute_fft() for an integer sample buffer, using the same
+ * cached plan.
+ */
+sample_buf_t *
+compute_fft_i(sample_buf_i_t *iq, int bins, window_function window,
+			  double center)
+{
+	fft_plan_t *plan = cached_plan(PLAN_FORWARD, bins, window);
+
+	return (plan == NULL) ? NULL : fft_execute_i(plan, iq, center);
+}
+
+/*
+ * compute_ifft(...)
+ *
+ * Computes the inverse FFT (the time domain signal) from the given
+ * FFT. This used to be done with the forward FFT, following Rick
+ * Lyons' note "Four Ways to Compute and Inverse FFT USing the Forward
+ * FFT Algorithm", and then a pass to swap the bins around and divide
+ * by N. Now it is a transform in its own right, see fft_inverse().
+ */
+sample_buf_t *
+compute_ifft(sample_buf_t *fft)
+{
+	fft_plan_t *plan = cached_plan(PLAN_INVERSE, fft->n, W_RECT);
+
+	return (plan == NULL) ? NULL : fft_execute_inverse(plan, fft);
+}
+
+/*
+ * compute_ifft_inplace(...)
+ *
+ * As compute_ifft() but the bins are replaced with the signal.
+ */
+sample_buf_t *
+compute_ifft_inplace(sample_buf_t *fft)
+{
+	fft_plan_t *plan = cached_plan(PLAN_INVERSE, fft->n, W_RECT);
+
+	return (plan == NULL) ? NULL : fft_execute_inverse_inplace(plan, fft);
 }
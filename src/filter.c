@@ -29,6 +29,7 @@
 #include <dsp/signal.h>
 #include <dsp/windows.h>
 #include <dsp/dft.h>
+#include <dsp/simd.h>
 
 /* Internal prototypes */
 static char *fetch_line(FILE *, char *, int);
@@ -259,11 +260,11 @@ fir_filter(sample_buf_t *signal, struct fir_filter_t *fir)
 	}
 
 	printf("Filtering signal with %d tap filter\n", fir->n_taps);
-	for (int i = 0; i < res->n; i++) {
+	for (int64_t i = 0; i < res->n; i++) {
 		for (int k = 0; k < fir->n_taps; k++)  {
 			complex double sig;
 			/* fill zeros (transient response) at start */
-			sig = ((i-k) >= 0) ? signal->data[i - k] : 0;
+			sig = ((i-k) >= 0) ? buf_sample(signal, i - k) : 0;
 			res->data[i] += creal(sig) * fir->taps[k] +
 							cimag(sig) * fir->taps[k] * I;
 		}
@@ -271,6 +272,146 @@ fir_filter(sample_buf_t *signal, struct fir_filter_t *fir)
 	return res;
 }
 
+/*
+ * fir_filter_f(...)
+ *
+ * Single precision version of fir_filter(). The taps are rounded
+ * to float once, up front, so the inner loop is all float math.
+ */
+sample_buf_f_t *
+fir_filter_f(sample_buf_f_t *signal, struct fir_filter_t *fir)
+{
+	sample_buf_f_t *res;
+	float	*taps;
+
+	res = alloc_buf_f(signal->n, signal->r);
+	if (res == NULL) {
+		fprintf(stderr, "filter: Failed to allocate result buffer\n");
+		return NULL;
+	}
+	taps = malloc(sizeof(float) * fir->n_taps);
+	if (taps == NULL) {
+		fprintf(stderr, "filter: Failed to allocate taps\n");
+		free_buf_f(res);
+		return NULL;
+	}
+	for (int k = 0; k < fir->n_taps; k++) {
+		taps[k] = (float) fir->taps[k];
+	}
+
+	printf("Filtering signal with %d tap filter\n", fir->n_taps);
+	for (int64_t i = 0; i < res->n; i++) {
+		samplef_t acc = 0;
+		/* fill zeros (transient response) at start */
+		int last = (i < fir->n_taps) ? (int) i + 1 : fir->n_taps;
+		for (int k = 0; k < last; k++)  {
+			acc += signal->data[i - k] * taps[k];
+		}
+		res->data[i] = acc;
+	}
+	free(taps);
+	return res;
+}
+
+/*
+ * fir_filter_split(...)
+ *
+ * Split complex version of fir_filter(). The taps are real so the
+ * real and imaginary parts are each just filtered on their own, which
+ * the vector kernel does a few outputs at a time.
+ */
+sample_buf_split_t *
+fir_filter_split(sample_buf_split_t *signal, struct fir_filter_t *fir)
+{
+	sample_buf_split_t *res;
+
+	res = alloc_buf_split(signal->n, signal->r);
+	if (res == NULL) {
+		fprintf(stderr, "filter: Failed to allocate result buffer\n");
+		return NULL;
+	}
+	if (res->n != signal->n) {
+		fprintf(stderr, "filter: Failed to allocate result buffer\n");
+		free_buf_split(res);
+		return NULL;
+	}
+
+	printf("Filtering signal with %d tap filter\n", fir->n_taps);
+	simd_fir_real(signal->re, signal->n, fir->taps, fir->n_taps, res->re);
+	simd_fir_real(signal->im, signal->n, fir->taps, fir->n_taps, res->im);
+	return res;
+}
+
+/*
+ * Samples of an integer buffer are converted this many at a time by
+ * fir_filter_i().
+ */
+#define FIR_BLOCK	4096
+
+/*
+ * fir_filter_i(...)
+ *
+ * fir_filter() for an integer buffer, without converting all of it
+ * up front. Each block of samples is converted along with the taps'
+ * worth of samples before it, split into real and imaginary parts,
+ * and filtered with the same kernel as fir_filter_split(). The
+ * outputs for the samples before the block are thrown away, they
+ * were done by the block before.
+ */
+sample_buf_t *
+fir_filter_i(sample_buf_i_t *signal, struct fir_filter_t *fir)
+{
+	sample_buf_t *res;
+	complex double	*x;
+	double	*re, *im, *yre, *yim;
+	int		hist = fir->n_taps - 1;
+	int		len = FIR_BLOCK + hist;
+	int		is_real = (signal->type == SAMPLE_REAL_SIGNAL);
+
+	res = alloc_buf_noclear(signal->n, signal->r);
+	if (res == NULL) {
+		fprintf(stderr, "filter: Failed to allocate result buffer\n");
+		return NULL;
+	}
+	if (res->n != signal->n) {
+		fprintf(stderr, "filter: Failed to allocate result buffer\n");
+		free_buf(res);
+		return NULL;
+	}
+	x = simd_alloc(sizeof(complex double) * len + 4 * sizeof(double) * len);
+	if (x == NULL) {
+		fprintf(stderr, "filter: Failed to allocate scratch space\n");
+		free_buf(res);
+		return NULL;
+	}
+	re = (double *) (x + len);
+	im = re + len;
+	yre = im + len;
+	yim = yre + len;
+	res->type = signal->type;
+
+	printf("Filtering signal with %d tap filter\n", fir->n_taps);
+	for (int64_t b = 0; b < signal->n; b += FIR_BLOCK) {
+		int h = (b < hist) ? (int) b : hist;
+		int n = (int) ((signal->n - b < FIR_BLOCK) ? signal->n - b : FIR_BLOCK) + h;
+
+		buf_int_samples(signal, b - h, n, x);
+		for (int i = 0; i < n; i++) {
+			re[i] = creal(x[i]);
+			im[i] = cimag(x[i]);
+		}
+		simd_fir_real(re, n, fir->taps, fir->n_taps, yre);
+		if (! is_real) {
+			simd_fir_real(im, n, fir->taps, fir->n_taps, yim);
+		}
+		for (int i = h; i < n; i++) {
+			res->data[b + i - h] = yre[i] + ((is_real) ? 0 : yim[i]) * I;
+		}
+	}
+	free(x);
+	return res;
+}
+
 /*
  * filter_real(...)
  *
@@ -289,7 +430,7 @@ fir_filter(sample_buf_t *signal, struct fir_filter_t *fir)
  * out of the FIR filter.
  */
 double *
-filter_real(double signal[], int n, struct fir_filter_t *fir)
+filter_real(double signal[], int64_t n, struct fir_filter_t *fir)
 {
 	double *res;
 
@@ -299,7 +440,7 @@ filter_real(double signal[], int n, struct fir_filter_t *fir)
 		return NULL;
 	}
 
-	for (int i = 0; i < n; i++) {
+	for (int64_t i = 0; i < n; i++) {
 		for (int k = 0; k < fir->n_taps; k++)  {
 			double sig;
 			/* fill zeros (transient response) at start */
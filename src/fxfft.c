@@ -0,0 +1,399 @@
+/*
+ * fxfft.c - a fixed point FFT
+ *
+ * I hereby grant permission for anyone to use this software for any
+ * purpose that they choose, I do not warrant the software to be
+ * functional or even correct. It was written as part of an educational
+ * exercise and is not "product grade" as far as the author is concerned.
+ *
+ * NO WARRANTY, EXPRESS OR IMPLIED ACCOMPANIES THIS SOFTWARE. USE IT AT
+ * YOUR OWN RISK.
+ *
+ * This is the same radix 2 FFT as fft.c but in Q15 or Q31 arithmetic,
+ * the way an FPGA or a DSP without floating point would do it. Every
+ * product is rounded and every sum saturates, exactly as described in
+ * simd.c, so the bins here are bit for bit what such hardware would
+ * compute (given the same rounding).
+ *
+ * A butterfly can make its outputs up to 1 + sqrt(2) times bigger
+ * than its inputs, so something has to give. With block floating
+ * point all of the values share one exponent, and before each stage
+ * they are shifted right just enough to leave two guard bits. This
+ * keeps as much precision as possible without ever overflowing. The
+ * alternatives are the classic shift by one every stage (which can
+ * still overflow a little, and loses precision on quiet signals) or
+ * no shifting at all, which is only good for small inputs or small
+ * transforms, and overflows are counted so you know when it wasn't.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <complex.h>
+#include <dsp/signal.h>
+#include <dsp/windows.h>
+#include <dsp/fxfft.h>
+#include <dsp/simd.h>
+
+/* block floating point keeps values below these before a stage */
+#define FX_Q15_GUARD	(1 << 13)
+#define FX_Q31_GUARD	(1 << 29)
+
+/*
+ * Round a value in [-1, 1] to fixed point, 1.0 can't be represented
+ * so it becomes the largest value there is. The smallest (-32768) is
+ * avoided too, its product with itself overflows.
+ */
+static int16_t
+q15(double v)
+{
+	double q = round(v * 32768.0);
+
+	return (int16_t) ((q > INT16_MAX) ? INT16_MAX :
+					  (q < -INT16_MAX) ? -INT16_MAX : q);
+}
+
+static int32_t
+q31(double v)
+{
+	double q = round(v * 2147483648.0);
+
+	return (int32_t) ((q > INT32_MAX) ? INT32_MAX :
+					  (q < -INT32_MAX) ? -INT32_MAX : q);
+}
+
+/*
+ * free_fx_fft_plan( ... )
+ *
+ * Release a plan built by fx_fft_plan().
+ */
+void
+free_fx_fft_plan(fx_fft_plan_t *plan)
+{
+	if (plan == NULL) {
+		return;
+	}
+	free(plan->rev);
+	free(plan->win15);
+	free(plan->win31);
+	free(plan->tw15re);
+	free(plan->tw15im);
+	free(plan->tw31re);
+	free(plan->tw31im);
+	free(plan);
+}
+
+/*
+ * fx_fft_plan( ... )
+ *
+ * Build the fixed point window, roots, and reflection tables for a
+ * 'bins' point transform, which must be a power of 2.
+ */
+fx_fft_plan_t *
+fx_fft_plan(int bins, window_function window, fx_scaling scaling)
+{
+	fx_fft_plan_t *plan;
+	int bits;
+
+	for (bits = 0; (1 << bits) < bins; bits++) ;
+	if ((bins < 1) || ((1 << bits) != bins)) {
+		fprintf(stderr, "fx_fft_plan: %d bins is not a power of 2\n", bins);
+		return NULL;
+	}
+
+	plan = calloc(1, sizeof(fx_fft_plan_t));
+	if (plan == NULL) {
+		return NULL;
+	}
+	plan->n = bins;
+	plan->bits = bits;
+	plan->window = window;
+	plan->scaling = scaling;
+	plan->rev = malloc(sizeof(int) * bins);
+	plan->tw15re = malloc(sizeof(int16_t) * 2 * bins);
+	plan->tw15im = malloc(sizeof(int16_t) * 2 * bins);
+	plan->tw31re = malloc(sizeof(int32_t) * 2 * bins);
+	plan->tw31im = malloc(sizeof(int32_t) * 2 * bins);
+	if ((plan->rev == NULL) || (plan->tw15re == NULL) ||
+		(plan->tw15im == NULL) || (plan->tw31re == NULL) ||
+		(plan->tw31im == NULL)) {
+		fprintf(stderr, "fx_fft_plan: out of memory\n");
+		free_fx_fft_plan(plan);
+		return NULL;
+	}
+
+	if (window != W_RECT) {
+		const double *win = window_table(window, bins);
+
+		plan->win15 = malloc(sizeof(int16_t) * bins);
+		plan->win31 = malloc(sizeof(int32_t) * bins);
+		if ((win == NULL) || (plan->win15 == NULL) || (plan->win31 == NULL)) {
+			fprintf(stderr, "fx_fft_plan: out of memory\n");
+			free_fx_fft_plan(plan);
+			return NULL;
+		}
+		for (int i = 0; i < bins; i++) {
+			plan->win15[i] = q15(win[i]);
+			plan->win31[i] = q31(win[i]);
+		}
+	}
+
+	plan->rev[0] = 0;
+	for (int i = 1; i < bins; i++) {
+		plan->rev[i] = (plan->rev[i >> 1] >> 1) | ((i & 1) << (bits - 1));
+	}
+
+	/*
+	 * Roots by stage, as in fft.c, but with each one stored twice over
+	 * in the form the butterflies use it (see simd_fx_stage_q15()).
+	 */
+	for (int half = 1; half < bins; half <<= 1) {
+		for (int j = 0; j < half; j++) {
+			double angle = M_PI * (double) j / (double) half;
+			int ndx = 2 * (half - 1 + j);
+
+			plan->tw15re[ndx] = plan->tw15re[ndx + 1] = q15(cos(angle));
+			plan->tw15im[ndx] = q15(sin(angle));
+			plan->tw15im[ndx + 1] = -plan->tw15im[ndx];
+			plan->tw31re[ndx] = plan->tw31re[ndx + 1] = q31(cos(angle));
+			plan->tw31im[ndx] = q31(sin(angle));
+			plan->tw31im[ndx + 1] = -plan->tw31im[ndx];
+		}
+	}
+	return plan;
+}
+
+/*
+ * The shift before a stage, given the largest magnitude going in.
+ */
+static int
+fx_shift(fx_fft_plan_t *plan, int64_t peak, int64_t guard)
+{
+	int shift = 0;
+
+	switch (plan->scaling) {
+		case FX_SCALE_BLOCK:
+			while ((peak >> shift) >= guard) {
+				shift++;
+			}
+			return shift;
+		case FX_SCALE_STAGE:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+/*
+ * fx_fft_q15( ... )
+ *
+ * Window, reflection sort, then the stages, each one preceded by
+ * whatever shift the scaling calls for.
+ */
+int
+fx_fft_q15(fx_fft_plan_t *plan, cq15_t *data, int *overflows)
+{
+	int16_t *v = (int16_t *) data;
+	int peak = 0;
+	int exponent = 0;
+	int ov = 0;
+
+	for (int i = 0; i < plan->n; i++) {
+		if (plan->win15 != NULL) {
+			data[i].re = ((int32_t) data[i].re * plan->win15[i] + 0x4000) >> 15;
+			data[i].im = ((int32_t) data[i].im * plan->win15[i] + 0x4000) >> 15;
+		}
+		peak = (abs(data[i].re) > peak) ? abs(data[i].re) : peak;
+		peak = (abs(data[i].im) > peak) ? abs(data[i].im) : peak;
+	}
+	for (int i = 0; i < plan->n; i++) {
+		int k = plan->rev[i];
+		if (i < k) {
+			cq15_t t = data[i];
+			data[i] = data[k];
+			data[k] = t;
+		}
+	}
+	for (int s = 0, half = 1; half < plan->n; s++, half <<= 1) {
+		int shift = fx_shift(plan, peak, FX_Q15_GUARD);
+
+		plan->shifts[s] = shift;
+		exponent += shift;
+		ov += simd_fx_stage_q15(v, plan->n, half,
+				plan->tw15re + 2 * (half - 1),
+				plan->tw15im + 2 * (half - 1), shift, &peak);
+	}
+	if (overflows != NULL) {
+		*overflows = ov;
+	}
+	return exponent;
+}
+
+/*
+ * fx_fft_q31( ... )
+ *
+ * The same, 32 bits at a time.
+ */
+int
+fx_fft_q31(fx_fft_plan_t *plan, cq31_t *data, int *overflows)
+{
+	int32_t *v = (int32_t *) data;
+	int64_t peak = 0;
+	int exponent = 0;
+	int ov = 0;
+
+	for (int i = 0; i < plan->n; i++) {
+		if (plan->win31 != NULL) {
+			data[i].re = ((int64_t) data[i].re * plan->win31[i] +
+						  0x40000000) >> 31;
+			data[i].im = ((int64_t) data[i].im * plan->win31[i] +
+						  0x40000000) >> 31;
+		}
+		peak = (llabs(data[i].re) > peak) ? llabs(data[i].re) : peak;
+		peak = (llabs(data[i].im) > peak) ? llabs(data[i].im) : peak;
+	}
+	for (int i = 0; i < plan->n; i++) {
+		int k = plan->rev[i];
+		if (i < k) {
+			cq31_t t = data[i];
+			data[i] = data[k];
+			data[k] = t;
+		}
+	}
+	for (int s = 0, half = 1; half < plan->n; s++, half <<= 1) {
+		int shift = fx_shift(plan, peak, FX_Q31_GUARD);
+
+		plan->shifts[s] = shift;
+		exponent += shift;
+		ov += simd_fx_stage_q31(v, plan->n, half,
+				plan->tw31re + 2 * (half - 1),
+				plan->tw31im + 2 * (half - 1), shift, &peak);
+	}
+	if (overflows != NULL) {
+		*overflows = ov;
+	}
+	return exponent;
+}
+
+/*
+ * fx_fft_execute( ... )
+ *
+ * Scale the samples so the largest real or imaginary part is full
+ * scale, quantize them, run the fixed point transform, and then undo
+ * both the input scaling and the block exponent so the bins can be
+ * compared one for one with compute_fft().
+ */
+sample_buf_t *
+fx_fft_execute(fx_fft_plan_t *plan, sample_buf_t *iq, int width, double center,
+			   int *overflows)
+{
+	sample_buf_t *result;
+	double half_span = (double) iq->r / 2.0;
+	double peak = 0;
+	double scale;
+	int exponent;
+	int bins = plan->n;
+	void *data;
+
+	if ((width != 16) && (width != 32)) {
+		fprintf(stderr, "fx_fft_execute: %d bit values aren't supported\n",
+				width);
+		return NULL;
+	}
+	for (int i = 0; (i < iq->n) && (i < bins); i++) {
+		peak = fmax(peak, fabs(creal(iq->data[i])));
+		peak = fmax(peak, fabs(cimag(iq->data[i])));
+	}
+	if (peak == 0) {
+		peak = 1.0;
+	}
+	result = alloc_buf_noclear(bins, iq->r);
+	data = (width == 16) ? malloc(sizeof(cq15_t) * bins) :
+						   malloc(sizeof(cq31_t) * bins);
+	if ((result == NULL) || (data == NULL)) {
+		fprintf(stderr, "fx_fft_execute: out of memory\n");
+		free_buf(result);
+		free(data);
+		return NULL;
+	}
+
+	if (width == 16) {
+		cq15_t *q = data;
+		for (int i = 0; i < bins; i++) {
+			complex double v = (i < iq->n) ? iq->data[i] / peak : 0;
+			q[i].re = q15(creal(v));
+			q[i].im = q15(cimag(v));
+		}
+		exponent = fx_fft_q15(plan, q, overflows);
+		scale = ldexp(peak, exponent - 15);
+		for (int i = 0; i < bins; i++) {
+			result->data[i] = scale * (q[i].re + q[i].im * I);
+		}
+	} else {
+		cq31_t *q = data;
+		for (int i = 0; i < bins; i++) {
+			complex double v = (i < iq->n) ? iq->data[i] / peak : 0;
+			q[i].re = q31(creal(v));
+			q[i].im = q31(cimag(v));
+		}
+		exponent = fx_fft_q31(plan, q, overflows);
+		scale = ldexp(peak, exponent - 31);
+		for (int i = 0; i < bins; i++) {
+			result->data[i] = scale * ((double) q[i].re + q[i].im * I);
+		}
+	}
+	free(data);
+
+	/* the same metadata fft_execute_into() sets */
+	result->center_freq = center;
+	result->min_freq = (center == 0) ? 0 : center - half_span;
+	result->max_freq = (center == 0) ? half_span * 2 : center + half_span;
+	result->type = (center == 0) ? SAMPLE_REAL_FFT : SAMPLE_FFT;
+	reset_minmax(result);
+	for (int i = 0; i < result->n; i++) {
+		set_minmax(result, i);
+	}
+	return result;
+}
+
+/*
+ * The compute_fft() style wrappers keep one plan around, like
+ * compute_fft() does, and complain if anything overflowed.
+ */
+static sample_buf_t *
+compute_fx(sample_buf_t *iq, int bins, window_function window, double center,
+		   int width)
+{
+	static fx_fft_plan_t *plan = NULL;
+	int overflows = 0;
+	sample_buf_t *res;
+
+	if ((plan == NULL) || (plan->n != bins) || (plan->window != window)) {
+		free_fx_fft_plan(plan);
+		plan = fx_fft_plan(bins, window, FX_SCALE_BLOCK);
+		if (plan == NULL) {
+			return NULL;
+		}
+	}
+	res = fx_fft_execute(plan, iq, width, center, &overflows);
+	if (overflows) {
+		fprintf(stderr, "compute_fft_q%d: %d values saturated\n",
+				width - 1, overflows);
+	}
+	return res;
+}
+
+sample_buf_t *
+compute_fft_q15(sample_buf_t *iq, int bins, window_function window,
+				double center)
+{
+	return compute_fx(iq, bins, window, center, 16);
+}
+
+sample_buf_t *
+compute_fft_q31(sample_buf_t *iq, int bins, window_function window,
+				double center)
+{
+	return compute_fx(iq, bins, window, center, 32);
+}
@@ -0,0 +1,150 @@
+/*
+ * goertzel.c - a bank of Goertzel filters
+ *
+ * I hereby grant permission for anyone to use this software for any
+ * purpose that they choose, I do not warrant the software to be
+ * functional or even correct. It was written as part of an educational
+ * exercise and is not "product grade" as far as the author is concerned.
+ *
+ * NO WARRANTY, EXPRESS OR IMPLIED ACCOMPANIES THIS SOFTWARE. USE IT AT
+ * YOUR OWN RISK.
+ *
+ * When you only care about a few frequencies a whole FFT is wasted
+ * effort. The Goertzel algorithm computes one DFT bin, at any
+ * frequency, with a two pole resonator
+ *
+ *     s[n] = x[n] + 2 cos(w) s[n - 1] - s[n - 2]
+ *
+ * that costs one real multiply per sample (two for complex samples),
+ * and at the end
+ *
+ *     X(w) = e^(-i w (N - 1)) * (s[N - 1] - e^(-i w) s[N - 2])
+ *
+ * which is sum( x[n] e^(-i w n) ), the same value the DFT would have
+ * for a bin at that frequency (with no window). Samples can be fed in
+ * any sized pieces, the bins can be read at any time, and they cover
+ * everything fed since the last reset.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include <dsp/signal.h>
+#include <dsp/simd.h>
+#include <dsp/goertzel.h>
+
+/*
+ * free_goertzel_bank( ... )
+ *
+ * Release a bank built by goertzel_bank().
+ */
+void
+free_goertzel_bank(goertzel_t *g)
+{
+	if (g == NULL) {
+		return;
+	}
+	free(g->freq);
+	free(g->coef);
+	free(g->s1r);
+	free(g->s1i);
+	free(g->s2r);
+	free(g->s2i);
+	free(g);
+}
+
+/*
+ * goertzel_bank( ... )
+ *
+ * Build a bank of 'k' filters at the frequencies in 'freqs', for
+ * samples at 'sample_rate'.
+ */
+goertzel_t *
+goertzel_bank(int k, const double *freqs, int sample_rate)
+{
+	goertzel_t *g;
+
+	if (k < 1) {
+		fprintf(stderr, "goertzel_bank: need at least one frequency\n");
+		return NULL;
+	}
+	g = calloc(1, sizeof(goertzel_t));
+	if (g == NULL) {
+		return NULL;
+	}
+	g->k = k;
+	g->r = sample_rate;
+	g->freq = malloc(sizeof(double) * k);
+	g->coef = malloc(sizeof(double) * k);
+	g->s1r = calloc(k, sizeof(double));
+	g->s1i = calloc(k, sizeof(double));
+	g->s2r = calloc(k, sizeof(double));
+	g->s2i = calloc(k, sizeof(double));
+	if ((g->freq == NULL) || (g->coef == NULL) || (g->s1r == NULL) ||
+		(g->s1i == NULL) || (g->s2r == NULL) || (g->s2i == NULL)) {
+		fprintf(stderr, "goertzel_bank: out of memory\n");
+		free_goertzel_bank(g);
+		return NULL;
+	}
+	for (int i = 0; i < k; i++) {
+		g->freq[i] = freqs[i];
+		g->coef[i] = 2.0 * cos(2.0 * M_PI * freqs[i] / (double) sample_rate);
+	}
+	return g;
+}
+
+/*
+ * goertzel_reset( ... )
+ *
+ * Start over, forgetting all of the samples fed so far.
+ */
+void
+goertzel_reset(goertzel_t *g)
+{
+	memset(g->s1r, 0, sizeof(double) * g->k);
+	memset(g->s1i, 0, sizeof(double) * g->k);
+	memset(g->s2r, 0, sizeof(double) * g->k);
+	memset(g->s2i, 0, sizeof(double) * g->k);
+	g->count = 0;
+}
+
+/*
+ * goertzel_feed( ... )
+ *
+ * Run every filter over the samples in 's'.
+ */
+void
+goertzel_feed(goertzel_t *g, sample_buf_t *s)
+{
+	simd_goertzel(g->coef, g->s1r, g->s1i, g->s2r, g->s2i, g->k,
+				  s->data, s->n);
+	g->count += s->n;
+}
+
+/*
+ * goertzel_bins( ... )
+ *
+ * Put each filter's bin value, for all of the samples fed since the
+ * reset, in 'bins' (which holds g->k values). The phase is relative
+ * to the first sample, as it is for the DFT.
+ */
+void
+goertzel_bins(goertzel_t *g, complex double *bins)
+{
+	for (int i = 0; i < g->k; i++) {
+		double w = 2.0 * M_PI * g->freq[i] / (double) g->r;
+		complex double s1 = g->s1r[i] + g->s1i[i] * I;
+		complex double s2 = g->s2r[i] + g->s2i[i] * I;
+		/* e^(-i w (N - 1)), with the turns reduced before they get big */
+		double turns = (double) fmodl((long double) g->freq[i] *
+							(g->count - 1) / g->r, 1.0L);
+
+		if (g->count == 0) {
+			bins[i] = 0;
+			continue;
+		}
+		bins[i] = cexp(-2.0 * M_PI * turns * I) * (s1 - cexp(-w * I) * s2);
+	}
+}
@@ -233,9 +233,9 @@ __plot_fft_data(FILE *of, sample_buf_t *fft, char *name)
 
 	mag_min = 0; mag_max = 0;
 	db_min = 350; db_max = -350;
-	for (int k = 0; k < fft->n; k++) {
+	for (int64_t k = 0; k < fft->n; k++) {
 		double db, mag; 
-		mag = cmag(fft->data[k]) / fft->n;
+		mag = cmag(buf_sample(fft, k)) / fft->n;
 		mag_min = (mag_min > mag) ? mag : mag_min;
 		mag_max = (mag_max < mag) ? mag : mag_max;
 		db = (mag != 0) ? 20 * log10(mag) : -350;
@@ -277,7 +277,7 @@ __plot_fft_data(FILE *of, sample_buf_t *fft, char *name)
 	fprintf(of, "%s_center_freq = %f\n", name, fcent);
 	fprintf(of, "%s_max_freq = %f\n", name, fmax);
 	fprintf(of, "%s_nyquist = %f\n", name, half_span);
-	fprintf(of, "%s_bins = %d\n", name, fft->n);
+	fprintf(of, "%s_bins = %lld\n", name, (long long) fft->n);
 	fprintf(of, "%s_rbw = %f\n", name, (fmax - fmin) / (double) fft->n);
 	fprintf(of, "%s_mag_min = %f\n", name, mag_min);
 	fprintf(of, "%s_mag_max = %f\n", name, mag_max);
@@ -399,12 +399,12 @@ __plot_fft_data(FILE *of, sample_buf_t *fft, char *name)
 
 		if (fft->type == SAMPLE_FFT) {
 			/* Write out the FFT values */
-			for (int k = fft->n / 2; k < fft->n; k++) {
+			for (int64_t k = fft->n / 2; k < fft->n; k++) {
 
 				xnorm = -0.5 + (double) (k - (fft->n / 2))/ (double) fft->n;
 				freq = xnorm * fmax;
 				freq_k = freq / 1000.0;
-				mag = cmag(fft->data[k]) / fft->n;
+				mag = cmag(buf_sample(fft, k)) / fft->n;
 				mag_norm  = (mag - mag_min) * mag_scale;
 				db = (mag != 0) ? 20 * log10(mag) : db_min;
 				db_norm = (db_max - db) * db_scale;
@@ -413,11 +413,11 @@ __plot_fft_data(FILE *of, sample_buf_t *fft, char *name)
 			}
 		}
 
-		for (int k = 0; k < fft->n; k++) {
+		for (int64_t k = 0; k < fft->n; k++) {
 			xnorm = (double) (k)/ (double) fft->n;
 			freq = xnorm * fmax;
 			freq_k = freq / 1000.0;
-			mag = cmag(fft->data[k]) / fft->n;
+			mag = cmag(buf_sample(fft, k)) / fft->n;
 			mag_norm  = (mag - mag_min) * mag_scale;
 			db = (mag != 0) ? 20 * log10(mag) : -300;
 			db_norm = (db_max - db) * db_scale;
@@ -439,7 +439,8 @@ __plot_fft_data(FILE *of, sample_buf_t *fft, char *name)
 static int
 __plot_signal_data(FILE *of, sample_buf_t *sig, char *name)
 {
-	int	end, per;
+	int64_t	end;
+	int		per;
 	double min_q, min_i;
 	double max_q, max_i;
 	double q_norm, i_norm;
@@ -462,8 +463,8 @@ __plot_signal_data(FILE *of, sample_buf_t *sig, char *name)
 	/* compute the min/max for the inphase and quadrature components */
 	for (int k = 0; k < end; k++) {
 		double q, i;
-		i = creal(sig->data[k]);
-		q = cimag(sig->data[k]);
+		i = creal(buf_sample(sig, k));
+		q = cimag(buf_sample(sig, k));
 		min_q = (q <= min_q) ? q : min_q;
 		min_i = (i <= min_i) ? i : min_i;
 		max_q = (q >= max_q) ? q : max_q;
@@ -483,7 +484,7 @@ __plot_signal_data(FILE *of, sample_buf_t *sig, char *name)
 	fprintf(of, "%s_i_max = %f\n", name, max_i * 1.1);
 	fprintf(of, "%s_q_min = %f\n", name, min_q * 1.1);
 	fprintf(of, "%s_q_max = %f\n", name, max_q * 1.1);
-	fprintf(of, "%s_end = %d\n", name, end);
+	fprintf(of, "%s_end = %lld\n", name, (long long) end);
 	fprintf(of, "%s_end_s = %f\n", name, end_s);
 	fprintf(of, "%s_end_ms = %f\n", name, end_ms);
 	/*
@@ -545,8 +546,8 @@ __plot_signal_data(FILE *of, sample_buf_t *sig, char *name)
 		double	dt;
 		double	sig_i, sig_q;
 		
-		sig_i = creal(sig->data[k]);
-		sig_q = cimag(sig->data[k]);
+		sig_i = creal(buf_sample(sig, k));
+		sig_q = cimag(buf_sample(sig, k));
 		dt = (double) (k) / (double) sig->r;
 		/* prints real part, imaginary part, and magnitude */
 		fprintf(of, "%f %f %f %f %f %f\n", 
@@ -576,10 +577,10 @@ __plot_custom_data(FILE *of, sample_buf_t *sig, char *name)
 	
 	min_q = min_i = max_q = max_i = 0;
 	/* compute the min/max for the inphase and quadrature components */
-	for (int k = 0; k < sig->n; k++) {
+	for (int64_t k = 0; k < sig->n; k++) {
 		double q, i;
-		i = creal(sig->data[k]);
-		q = cimag(sig->data[k]);
+		i = creal(buf_sample(sig, k));
+		q = cimag(buf_sample(sig, k));
 		min_q = (q <= min_q) ? q : min_q;
 		min_i = (i <= min_i) ? i : min_i;
 		max_q = (q >= max_q) ? q : max_q;
@@ -655,12 +656,12 @@ __plot_custom_data(FILE *of, sample_buf_t *sig, char *name)
 	fprintf(of, "# 6. Quadrature (imaginary) value normalized (-0.5 - 0.5)\n");
 	fprintf(of, "# 1        2        3        4         5         6\n");
 
-	for (int k = 0; k < sig->n; k++) {
+	for (int64_t k = 0; k < sig->n; k++) {
 		double	dt;
 		double	sig_i, sig_q;
 		
-		sig_i = creal(sig->data[k]);
-		sig_q = cimag(sig->data[k]);
+		sig_i = creal(buf_sample(sig, k));
+		sig_q = cimag(buf_sample(sig, k));
 		dt = (double) (k) / (double) sig->r;
 		/* prints real part, imaginary part, and magnitude */
 		fprintf(of, "%f %f %f %f %f %f\n", 
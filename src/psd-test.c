@@ -0,0 +1,212 @@
+/*
+ * psd-test.c - check Welch's power spectral density estimate
+ *
+ * I hereby grant permission for anyone to use this software for any
+ * purpose that they choose, I do not warrant the software to be
+ * functional or even correct. It was written as part of an educational
+ * exercise and is not "product grade" as far as the author is concerned.
+ *
+ * NO WARRANTY, EXPRESS OR IMPLIED ACCOMPANIES THIS SOFTWARE. USE IT AT
+ * YOUR OWN RISK.
+ *
+ * A density is only useful if the level is right, so this puts in
+ * signals whose power is known and checks the estimate finds it. A
+ * real tone of amplitude A has a power of A^2 / 2, all of it in the
+ * tone's two bins (and the window's skirts around them). Uniform noise
+ * from -1/2 to 1/2 has a power of 1/12, spread evenly over every bin.
+ * The threaded and reused plan versions have to agree with the plain
+ * one.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <complex.h>
+#include <dsp/signal.h>
+#include <dsp/windows.h>
+#include <dsp/fft.h>
+#include <dsp/threads.h>
+#include <dsp/psd.h>
+
+#define SAMPLE_RATE	12000
+#define SAMPLES		65536
+
+/*
+ * total_power( ... )
+ *
+ * The sum over all of the bins times the bin width.
+ */
+static double
+total_power(sample_buf_t *psd)
+{
+	double sum = 0;
+
+	for (int i = 0; i < psd->n; i++) {
+		sum += creal(psd->data[i]);
+	}
+	return sum * psd->r / psd->n;
+}
+
+/*
+ * check_tone( ... )
+ *
+ * A tone of amplitude 2 in the middle of bin bins / 10, the peak has
+ * to be in that bin (and its mirror) and the total power 2.
+ */
+static int
+check_tone(int bins, window_function w)
+{
+	sample_buf_t *s, *psd;
+	int k = bins / 10;
+	int peak = 0;
+	double power;
+	int bad;
+
+	s = alloc_buf(SAMPLES, SAMPLE_RATE);
+	if (s == NULL) {
+		return 1;
+	}
+	add_cos_real(s, (double) k * SAMPLE_RATE / bins, 2.0, 0);
+	psd = welch_psd(s, bins, bins / 2, w, 0, NULL);
+	if (psd == NULL) {
+		free_buf(s);
+		return 1;
+	}
+	for (int i = 1; i < bins / 2; i++) {
+		peak = (creal(psd->data[i]) > creal(psd->data[peak])) ? i : peak;
+	}
+	power = total_power(psd);
+	bad = (peak != k) ||
+		  (fabs(creal(psd->data[bins - k]) - creal(psd->data[k])) >
+		   1e-9 * creal(psd->data[k])) ||
+		  (fabs(power - 2.0) > 1e-6);
+	printf("  tone in bin %4d of %4d: peak in bin %4d, power %.9f  %s\n",
+			k, bins, peak, power, (bad) ? "FAIL" : "ok");
+	free_buf(psd);
+	free_buf(s);
+	return bad;
+}
+
+/*
+ * check_noise( ... )
+ *
+ * Uniform noise, the total has to be close to 1/12 and every bin
+ * close to the average. With five hundred or more segments averaged
+ * each bin is off by about 5% (one standard deviation), so the worst
+ * of a thousand bins is 15 or 20% off and 30% leaves some margin.
+ */
+static int
+check_noise(int bins)
+{
+	sample_buf_t *s, *psd;
+	double power, level;
+	int worst = 0;
+	int bad;
+
+	s = alloc_buf(4 * SAMPLES, SAMPLE_RATE);
+	if (s == NULL) {
+		return 1;
+	}
+	srand(bins);
+	for (int i = 0; i < s->n; i++) {
+		s->data[i] = rand() / (double) RAND_MAX - 0.5;
+	}
+	psd = welch_psd(s, bins, bins / 2, W_HANN, 0, NULL);
+	if (psd == NULL) {
+		free_buf(s);
+		return 1;
+	}
+	power = total_power(psd);
+	level = power / SAMPLE_RATE;
+	for (int i = 0; i < bins; i++) {
+		if (fabs(creal(psd->data[i]) - level) >
+			fabs(creal(psd->data[worst]) - level)) {
+			worst = i;
+		}
+	}
+	bad = (fabs(power * 12.0 - 1.0) > 0.02) ||
+		  (fabs(creal(psd->data[worst]) / level - 1.0) > 0.3);
+	printf("  noise in %4d bins: power %.6f (1/12 is %.6f), worst bin %+.1f%%  %s\n",
+			bins, power, 1.0 / 12, 100 * (creal(psd->data[worst]) / level - 1.0),
+			(bad) ? "FAIL" : "ok");
+	free_buf(psd);
+	free_buf(s);
+	return bad;
+}
+
+/*
+ * check_threads( ... )
+ *
+ * Spreading the segments over a thread pool, and reusing one plan for
+ * more than one signal, only changes the order the segments are added
+ * up in.
+ */
+static int
+check_threads(int bins)
+{
+	struct thread_pool_t *pool;
+	sample_buf_t *s, *one, *many, *into;
+	fft_plan_t *plan;
+	double err = 0;
+	int bad;
+
+	pool = thread_pool(4);
+	plan = fft_plan(bins, W_HANN);
+	s = alloc_buf(SAMPLES, SAMPLE_RATE);
+	into = alloc_buf(bins, SAMPLE_RATE);
+	if ((pool == NULL) || (plan == NULL) || (s == NULL) || (into == NULL) ||
+		(fft_plan_threads(plan, pool) != 0)) {
+		return 1;
+	}
+	srand(bins);
+	for (int i = 0; i < s->n; i++) {
+		s->data[i] = (rand() / (double) RAND_MAX - 0.5) +
+					 (rand() / (double) RAND_MAX - 0.5) * I;
+	}
+	for (int pass = 0; pass < 2; pass++) {
+		one = welch_psd(s, bins, bins / 4, W_HANN, 1e6, NULL);
+		many = welch_psd(s, bins, bins / 4, W_HANN, 1e6, pool);
+		if ((one == NULL) || (many == NULL) ||
+			(welch_psd_into(plan, s, into, bins / 4, 1e6) == NULL)) {
+			return 1;
+		}
+		for (int i = 0; i < bins; i++) {
+			double e1 = cabs(many->data[i] - one->data[i]) / cabs(one->data[i]);
+			double e2 = cabs(into->data[i] - one->data[i]) / cabs(one->data[i]);
+			err = (e1 > err) ? e1 : err;
+			err = (e2 > err) ? e2 : err;
+		}
+		free_buf(one);
+		free_buf(many);
+		/* a different signal through the same plan */
+		add_cos(s, 1000.0, 1.0, 0);
+	}
+	bad = (err > 1e-12);
+	printf("  %4d bins, with a pool and a reused plan: error %.3g  %s\n",
+			bins, err, (bad) ? "FAIL" : "ok");
+	free_buf(into);
+	free_buf(s);
+	free_fft_plan(plan);
+	free_thread_pool(pool);
+	return bad;
+}
+
+int
+main(int argc, char *argv[])
+{
+	int bad = 0;
+
+	printf("Checking Welch's PSD estimate\n");
+	bad += check_tone(256, W_HANN);
+	bad += check_tone(1000, W_BH);
+	bad += check_tone(1024, W_RECT);
+	bad += check_noise(256);
+	bad += check_noise(1000);
+	bad += check_threads(1024);
+	bad += check_threads(1000);
+	if (bad) {
+		fprintf(stderr, "%d PSD checks failed\n", bad);
+		exit(1);
+	}
+	printf("Done.\n");
+}
@@ -0,0 +1,201 @@
+/*
+ * psd.c - Welch's method of estimating power spectral density
+ *
+ * I hereby grant permission for anyone to use this software for any
+ * purpose that they choose, I do not warrant the software to be
+ * functional or even correct. It was written as part of an educational
+ * exercise and is not "product grade" as far as the author is concerned.
+ *
+ * NO WARRANTY, EXPRESS OR IMPLIED ACCOMPANIES THIS SOFTWARE. USE IT AT
+ * YOUR OWN RISK.
+ *
+ * A single FFT of noise is itself noisy, each bin is a random value
+ * with a standard deviation as big as its mean. To see the actual
+ * noise floor (or a spur sitting just above it) you have to average.
+ * Welch's method cuts the recording into segments, which overlap so
+ * that the samples the window squashes at the ends of one segment are
+ * in the middle of another, and averages |X[k]|^2 over all of them.
+ *
+ * Dividing by the sample rate and by the sum of the squared window
+ * values makes it a density, so the result doesn't depend on the
+ * window or FFT size. It is two sided (all N bins, like compute_fft())
+ * and in units of (sample units)^2 / Hz, so for a real signal the
+ * total power is the sum over all of the bins times the bin width.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include <dsp/signal.h>
+#include <dsp/windows.h>
+#include <dsp/fft.h>
+#include <dsp/threads.h>
+#include <dsp/psd.h>
+
+/*
+ * What each task needs, the segments are split into 'n_tasks' runs
+ * of consecutive segments and each run is summed into its own row of
+ * 'acc'. The rows are added up in order at the end, so the result
+ * doesn't depend on which thread happened to run which task.
+ */
+struct welch_job {
+	fft_plan_t		*plan;
+	sample_buf_t	*in;
+	int				step;		/* samples from one segment to the next */
+	int64_t			segments;	/* how many in all */
+	int				n_tasks;
+	complex double	*work;		/* n_tasks * bins */
+	double			*acc;		/* n_tasks * bins, after 'work' */
+};
+
+static void
+welch_task(void *arg, int task, int worker)
+{
+	struct welch_job *job = arg;
+	int bins = job->plan->n;
+	int64_t first = job->segments * task / job->n_tasks;
+	int64_t last = job->segments * (task + 1) / job->n_tasks;
+	complex double *w = job->work + (long long) task * bins;
+	double *acc = job->acc + (long long) task * bins;
+
+	(void) worker;
+	memset(acc, 0, sizeof(double) * bins);
+	for (int64_t seg = first; seg < last; seg++) {
+		complex double *x = job->in->data + seg * job->step;
+
+		for (int i = 0; i < bins; i++) {
+			w[i] = job->plan->win[i] * x[i];
+		}
+		fft_transform(job->plan, w);
+		for (int i = 0; i < bins; i++) {
+			double re = creal(w[i]);
+			double im = cimag(w[i]);
+			acc[i] += re * re + im * im;
+		}
+	}
+}
+
+/*
+ * welch_psd_into( ... )
+ *
+ * Estimate the PSD of the samples in 's' from segments the size of
+ * 'plan', windowed with its window, that overlap by 'overlap' samples
+ * (half of plan->n is the usual choice), into 'result' which must hold
+ * plan->n samples. The density is in the real part of each result
+ * sample. The plan can be kept and used over and over, with a radix 2
+ * plan the segments are spread over its threads (see
+ * fft_plan_threads()).
+ */
+sample_buf_t *
+welch_psd_into(fft_plan_t *plan, sample_buf_t *s, sample_buf_t *result,
+			   int overlap, double center)
+{
+	struct welch_job job;
+	struct thread_pool_t *pool = plan->pool;
+	int bins = plan->n;
+	double half_span = (double) s->r / 2.0;
+	double u = 0;
+	double scale;
+
+	if ((overlap < 0) || (overlap >= bins)) {
+		fprintf(stderr, "welch_psd: can't overlap %d bin segments by %d\n",
+				bins, overlap);
+		return NULL;
+	}
+	if (s->n < bins) {
+		fprintf(stderr, "welch_psd: %lld samples is less than one segment\n",
+				(long long) s->n);
+		return NULL;
+	}
+	if (result->n != bins) {
+		fprintf(stderr, "welch_psd: result holds %lld samples, not %d\n",
+				(long long) result->n, bins);
+		return NULL;
+	}
+
+	job.plan = plan;
+	job.in = s;
+	job.step = bins - overlap;
+	job.segments = (s->n - bins) / job.step + 1;
+	/* only radix 2 plans can be shared between threads */
+	if (plan->algorithm != FFT_RADIX_2) {
+		pool = NULL;
+	}
+	job.n_tasks = thread_pool_size(pool);
+	if (job.n_tasks > job.segments) {
+		job.n_tasks = (int) job.segments;
+	}
+	/* one allocation for both, the sums go after the transforms */
+	job.work = malloc((sizeof(complex double) + sizeof(double)) *
+					  job.n_tasks * bins);
+	if (job.work == NULL) {
+		fprintf(stderr, "welch_psd: out of memory\n");
+		return NULL;
+	}
+	job.acc = (double *) (job.work + (long long) job.n_tasks * bins);
+	thread_pool_run(pool, job.n_tasks, welch_task, &job);
+
+	/* window power, so the window doesn't change the level */
+	for (int i = 0; i < bins; i++) {
+		u += plan->win[i] * plan->win[i];
+	}
+	scale = 1.0 / ((double) s->r * u * job.segments);
+	for (int i = 0; i < bins; i++) {
+		double p = 0;
+		for (int t = 0; t < job.n_tasks; t++) {
+			p += job.acc[(long long) t * bins + i];
+		}
+		result->data[i] = p * scale;
+	}
+	free(job.work);
+
+	result->r = s->r;
+	result->center_freq = center;
+	result->min_freq = (center == 0) ? 0 : center - half_span;
+	result->max_freq = (center == 0) ? half_span * 2 : center + half_span;
+	result->type = (center == 0) ? SAMPLE_REAL_FFT : SAMPLE_FFT;
+	reset_minmax(result);
+	for (int i = 0; i < result->n; i++) {
+		set_minmax(result, i);
+	}
+	return result;
+}
+
+/*
+ * welch_psd( ... )
+ *
+ * As welch_psd_into() with a newly allocated result and a plan of
+ * 'bins' bins and 'window' that uses the threads in 'pool' (which may
+ * be NULL) and is thrown away afterwards.
+ */
+sample_buf_t *
+welch_psd(sample_buf_t *s, int bins, int overlap, window_function window,
+		  double center, struct thread_pool_t *pool)
+{
+	fft_plan_t *plan;
+	sample_buf_t *result;
+
+	if (bins < 1) {
+		fprintf(stderr, "welch_psd: can't make %d bin segments\n", bins);
+		return NULL;
+	}
+	plan = fft_plan(bins, window);
+	if (plan == NULL) {
+		return NULL;
+	}
+	result = alloc_buf_noclear(bins, s->r);
+	if (result == NULL) {
+		free_fft_plan(plan);
+		return NULL;
+	}
+	if ((fft_plan_threads(plan, pool) != 0) ||
+		(welch_psd_into(plan, s, result, overlap, center) == NULL)) {
+		free_buf(result);
+		free_fft_plan(plan);
+		return NULL;
+	}
+	free_fft_plan(plan);
+	return result;
+}
@@ -0,0 +1,659 @@
+/*
+ * sample-test.c - check the sample buffer variations
+ *
+ * I hereby grant permission for anyone to use this software for any
+ * purpose that they choose, I do not warrant the software to be
+ * functional or even correct. It was written as part of an educational
+ * exercise and is not "product grade" as far as the author is concerned.
+ *
+ * NO WARRANTY, EXPRESS OR IMPLIED ACCOMPANIES THIS SOFTWARE. USE IT AT
+ * YOUR OWN RISK.
+ *
+ * Besides the plain buffer of complex doubles there are views into
+ * other buffers. Anything that takes a buffer has to give the same
+ * answer for a view as for a copy of the samples the view covers.
+ *
+ * Split complex buffers keep the real and imaginary parts in arrays
+ * of their own. Converting one has to be exact both ways, and the FFT,
+ * filter, and magnitude of one have to match those of the interleaved
+ * buffer it came from.
+ *
+ * With a pool selected alloc_buf() hands out buffers that have been
+ * freed (or, for an arena, everything after a reset) rather than
+ * allocating new ones. Those have to look just like new ones.
+ *
+ * Integer buffers keep samples as 8, 16, or 32 bit values. Going to
+ * integers each value is clamped to the range and rounded to the
+ * nearest (ties to even, NaN to the smallest value), at every SIMD
+ * level, and coming back they are exact.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <complex.h>
+#include <pthread.h>
+#include <dsp/signal.h>
+#include <dsp/fft.h>
+#include <dsp/filter.h>
+#include <dsp/simd.h>
+
+#define SAMPLE_RATE	12000
+
+/*
+ * fill_noise( ... )
+ *
+ * Random samples from -1/2 to 1/2, the same ones for the same seed.
+ */
+static void
+fill_noise(sample_buf_t *s, int seed)
+{
+	srand(seed);
+	for (int64_t i = 0; i < s->n; i++) {
+		s->data[i] = (rand() / (double) RAND_MAX - 0.5) +
+					 (rand() / (double) RAND_MAX - 0.5) * I;
+	}
+}
+
+/*
+ * copy_of( ... )
+ *
+ * A plain buffer with the same samples as 's' (a view, say).
+ */
+static sample_buf_t *
+copy_of(sample_buf_t *s)
+{
+	sample_buf_t *res = alloc_buf(s->n, s->r);
+
+	if (res == NULL) {
+		return NULL;
+	}
+	for (int64_t i = 0; i < s->n; i++) {
+		res->data[i] = buf_sample(s, i);
+	}
+	res->type = s->type;
+	return res;
+}
+
+/*
+ * same_samples( ... )
+ *
+ * Returns 1 if 'a' and 'b' hold exactly the same samples.
+ */
+static int
+same_samples(sample_buf_t *a, sample_buf_t *b)
+{
+	if ((a == NULL) || (b == NULL) || (a->n != b->n)) {
+		return 0;
+	}
+	for (int64_t i = 0; i < a->n; i++) {
+		if (buf_sample(a, i) != buf_sample(b, i)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/*
+ * check_view_fft( ... )
+ *
+ * The FFT of every 'stride'th sample from sample 3 on, through a view
+ * and through a copy, has to be the same (the loaders read the same
+ * values in the same order either way).
+ */
+static int
+check_view_fft(sample_buf_t *parent, int bins, int stride, double center)
+{
+	sample_buf_t *view, *copy, *a, *b;
+	int bad;
+
+	view = buf_view(parent, 3, bins, stride);
+	copy = (view == NULL) ? NULL : copy_of(view);
+	if (copy == NULL) {
+		return 1;
+	}
+	a = compute_fft(view, bins, W_HANN, center);
+	b = compute_fft(copy, bins, W_HANN, center);
+	bad = ! same_samples(a, b);
+	printf("  %7d bin %s FFT of a stride %d view  %s\n", bins,
+			(center == 0) ? "real" : "complex", stride, (bad) ? "FAIL" : "ok");
+	if (a != NULL) {
+		free_buf(a);
+	}
+	if (b != NULL) {
+		free_buf(b);
+	}
+	free_buf(copy);
+	free_buf(view);
+	return bad;
+}
+
+/*
+ * check_views( ... )
+ *
+ * What a view covers, views of views, and the things that take them.
+ */
+static int
+check_views(void)
+{
+	double taps[] = { 0.1, -0.2, 0.4, 1.0, 0.4, -0.2, 0.1 };
+	struct fir_filter_t fir = { "view test", 7, taps };
+	sample_buf_t *parent, *v, *vv, *copy, *a, *b;
+	fft_plan_t *plan;
+	int bad = 0;
+	int ok;
+
+	parent = alloc_buf(3 * (1 << 18) + 10, SAMPLE_RATE);
+	if (parent == NULL) {
+		return 1;
+	}
+	fill_noise(parent, 1);
+
+	/* clipped to the end of the parent, rate divided by the stride */
+	v = buf_view(parent, 100, parent->n, 3);
+	vv = (v == NULL) ? NULL : buf_view(v, 5, 10, 2);
+	if ((v == NULL) || (vv == NULL)) {
+		return 1;
+	}
+	bad += (v->n != (parent->n - 100 + 2) / 3) ||
+		   (v->r != SAMPLE_RATE / 3) || (v->stride != 3) ||
+		   (! (v->flags & BUF_VIEW));
+	bad += (vv->n != 10) || (vv->stride != 6) || (vv->r != SAMPLE_RATE / 6);
+	for (int i = 0; i < vv->n; i++) {
+		bad += (buf_sample(vv, i) != parent->data[100 + 3 * (5 + 2 * i)]);
+	}
+	bad += (buf_view(parent, parent->n + 1, 1, 1) != NULL);
+	bad += (buf_view(parent, 0, 1, 0) != NULL);
+	printf("  view bounds, strides and rates  %s\n", (bad) ? "FAIL" : "ok");
+
+	/* radix 2, mixed radix, Bluestein and four step, real and complex */
+	bad += check_view_fft(parent, 256, 3, 1e6);
+	bad += check_view_fft(parent, 256, 2, 0);
+	bad += check_view_fft(parent, 240, 3, 1e6);
+	bad += check_view_fft(parent, 251, 3, 0);
+	bad += check_view_fft(parent, 1 << 18, 3, 1e6);
+
+	/* results can't be strided, so no FFT in place on a view */
+	plan = fft_plan(256, W_RECT);
+	a = buf_view(parent, 0, 256, 2);
+	if ((plan == NULL) || (a == NULL)) {
+		return 1;
+	}
+	ok = (fft_execute_inplace(plan, a, 1e6) == NULL);
+	free_fft_plan(plan);
+	free_buf(a);
+
+	/* the filter reads through the stride too */
+	copy = copy_of(v);
+	if (copy == NULL) {
+		return 1;
+	}
+	a = fir_filter(v, &fir);
+	b = fir_filter(copy, &fir);
+	ok = ok && same_samples(a, b);
+	bad += ! ok;
+	printf("  filtered view, and no FFT in place on a view  %s\n",
+			(ok) ? "ok" : "FAIL");
+	if (a != NULL) {
+		free_buf(a);
+	}
+	if (b != NULL) {
+		free_buf(b);
+	}
+
+	/* freeing the views leaves the parent alone */
+	free_buf(vv);
+	free_buf(v);
+	for (int64_t i = 0; i < copy->n; i++) {
+		bad += (copy->data[i] != parent->data[100 + 3 * i]);
+	}
+	free_buf(copy);
+	free_buf(parent);
+	return bad;
+}
+
+/*
+ * max_error( ... )
+ *
+ * The largest difference between the samples of 'a' and those of the
+ * split buffer 'b', relative to the largest sample of 'a'.
+ */
+static double
+max_error(sample_buf_t *a, sample_buf_split_t *b)
+{
+	double err = 0, big = 0;
+
+	if ((a == NULL) || (b == NULL) || (a->n != b->n)) {
+		return INFINITY;
+	}
+	for (int64_t i = 0; i < a->n; i++) {
+		double e = cabs(a->data[i] - (b->re[i] + b->im[i] * I));
+		err = (e > err) ? e : err;
+		big = (cabs(a->data[i]) > big) ? cabs(a->data[i]) : big;
+	}
+	return (big > 0) ? err / big : err;
+}
+
+/*
+ * check_split_fft( ... )
+ *
+ * A split complex FFT against the interleaved one (split plans are
+ * only radix 2).
+ */
+static int
+check_split_fft(sample_buf_t *s, sample_buf_split_t *sp, int bins,
+				double center)
+{
+	sample_buf_t *a = compute_fft(s, bins, W_HANN, center);
+	sample_buf_split_t *b = compute_fft_split(sp, bins, W_HANN, center);
+	double err = max_error(a, b);
+	int bad = (err > 1e-12);
+
+	printf("  %4d bin %s split FFT, error %.3g  %s\n", bins,
+			(center == 0) ? "real" : "complex", err, (bad) ? "FAIL" : "ok");
+	if (a != NULL) {
+		free_buf(a);
+	}
+	if (b != NULL) {
+		free_buf_split(b);
+	}
+	return bad;
+}
+
+/*
+ * check_split( ... )
+ *
+ * Conversions, magnitudes (at every SIMD level), FFTs and filtering
+ * of split complex buffers.
+ */
+static int
+check_split(void)
+{
+	double taps[] = { 0.1, -0.2, 0.4, 1.0, 0.4, -0.2, 0.1 };
+	struct fir_filter_t fir = { "split test", 7, taps };
+	sample_buf_t *s, *back, *a;
+	sample_buf_split_t *sp, *b;
+	simd_level level = simd_get_level();
+	double *mag;
+	double err;
+	int bad = 0;
+
+	/* an odd length, so the vector loops leave some over */
+	s = alloc_buf(1001, SAMPLE_RATE);
+	mag = malloc(sizeof(double) * 1001);
+	if ((s == NULL) || (mag == NULL)) {
+		return 1;
+	}
+	fill_noise(s, 2);
+	s->type = SAMPLE_SIGNAL;
+	s->center_freq = 1e6;
+	sp = buf_to_split(s);
+	back = (sp == NULL) ? NULL : buf_from_split(sp);
+	if (back == NULL) {
+		return 1;
+	}
+	bad += (! simd_aligned(sp->re, SAMPLE_ALIGN)) ||
+		   (! simd_aligned(sp->im, SAMPLE_ALIGN));
+	bad += (sp->type != s->type) || (sp->center_freq != s->center_freq) ||
+		   (back->type != s->type) || (back->r != s->r);
+	bad += ! same_samples(s, back);
+	printf("  split conversions both ways  %s\n", (bad) ? "FAIL" : "ok");
+
+	for (int l = SIMD_NONE; l <= SIMD_AVX512; l++) {
+		int wrong = 0;
+
+		if (simd_set_level(l) != l) {
+			continue;
+		}
+		buf_magnitude_split(sp, mag);
+		for (int i = 0; i < s->n; i++) {
+			wrong += (mag[i] != cmag(s->data[i]));
+		}
+		printf("  %s split magnitudes  %s\n", simd_level_name(l),
+				(wrong) ? "FAIL" : "ok");
+		bad += (wrong != 0);
+	}
+	simd_set_level(level);
+
+	bad += check_split_fft(s, sp, 256, 1e6);
+	bad += check_split_fft(s, sp, 256, 0);
+	bad += check_split_fft(s, sp, 64, 0);
+	/* more bins than samples, zero padded */
+	bad += check_split_fft(s, sp, 2048, 1e6);
+
+	a = fir_filter(s, &fir);
+	b = fir_filter_split(sp, &fir);
+	err = max_error(a, b);
+	bad += (err > 1e-15);
+	printf("  split filter, error %.3g  %s\n", err,
+			(err > 1e-15) ? "FAIL" : "ok");
+	if (a != NULL) {
+		free_buf(a);
+	}
+	if (b != NULL) {
+		free_buf_split(b);
+	}
+	free(mag);
+	free_buf(back);
+	free_buf_split(sp);
+	free_buf(s);
+	return bad;
+}
+
+/*
+ * The pool a buffer allocated on another thread comes from, none
+ * should be selected there.
+ */
+static void *
+other_thread(void *arg)
+{
+	sample_buf_t *s = alloc_buf(100, SAMPLE_RATE);
+
+	*(buf_pool_t **) arg = (s == NULL) ? (buf_pool_t *) arg : s->pool;
+	if (s != NULL) {
+		free_buf(s);
+	}
+	return NULL;
+}
+
+/*
+ * check_pools( ... )
+ *
+ * Reuse in each mode, that reused buffers come back zeroed, and that
+ * a pool is only used on the thread that selected it.
+ */
+static int
+check_pools(void)
+{
+	buf_pool_t *pool, *arena, *seen = NULL;
+	sample_buf_t *a, *b, *c, *x, *fft, *want;
+	pthread_t tid;
+	int bad = 0;
+
+	pool = buf_pool(BUF_POOL);
+	arena = buf_pool(BUF_ARENA);
+	x = alloc_buf(1000, SAMPLE_RATE);
+	if ((pool == NULL) || (arena == NULL) || (x == NULL)) {
+		return 1;
+	}
+	fill_noise(x, 3);
+	want = compute_fft(x, 1024, W_HANN, 0);
+	if (want == NULL) {
+		return 1;
+	}
+
+	/* a pool takes freed buffers back, any size in the same class */
+	bad += (buf_pool_select(pool) != NULL);
+	a = alloc_buf(1000, SAMPLE_RATE);
+	b = alloc_buf(1000, SAMPLE_RATE);
+	if ((a == NULL) || (b == NULL)) {
+		return 1;
+	}
+	bad += (a == b) || (a->pool != pool) ||
+		   (! simd_aligned(a->data, SAMPLE_ALIGN));
+	fill_noise(a, 4);
+	free_buf(a);
+	c = alloc_buf(600, SAMPLE_RATE);
+	if (c == NULL) {
+		return 1;
+	}
+	bad += (c != a) || (c->n != 600) || (c->stride != 1);
+	for (int i = 0; i < buf_padded_n(c); i++) {
+		bad += (c->data[i] != 0);
+	}
+	free_buf(b);
+	free_buf(c);
+
+	/* the FFT's result comes out of the pool, and is the same */
+	fft = compute_fft(x, 1024, W_HANN, 0);
+	bad += (fft == NULL) || (fft->pool != pool) || (! same_samples(fft, want));
+	if (fft != NULL) {
+		free_buf(fft);
+	}
+
+	/* only on this thread */
+	if (pthread_create(&tid, NULL, other_thread, &seen) != 0) {
+		return 1;
+	}
+	pthread_join(tid, NULL);
+	bad += (seen != NULL);
+	printf("  buffer pool reuse  %s\n", (bad) ? "FAIL" : "ok");
+
+	/* an arena keeps them until it is reset */
+	bad += (buf_pool_select(arena) != pool);
+	a = alloc_buf(1000, SAMPLE_RATE);
+	if (a == NULL) {
+		return 1;
+	}
+	free_buf(a);
+	b = alloc_buf(1000, SAMPLE_RATE);
+	if (b == NULL) {
+		return 1;
+	}
+	bad += (b == a) || (b->pool != arena);
+	buf_pool_reset(arena);
+	c = alloc_buf(1000, SAMPLE_RATE);
+	bad += (c == NULL) || ((c != a) && (c != b));
+	printf("  buffer arena reuse after a reset  %s\n", (bad) ? "FAIL" : "ok");
+
+	/* and back to malloc() */
+	bad += (buf_pool_select(NULL) != arena);
+	a = alloc_buf(1000, SAMPLE_RATE);
+	bad += (a == NULL) || (a->pool != NULL);
+	if (a != NULL) {
+		free_buf(a);
+	}
+	free_buf_pool(arena);
+	free_buf_pool(pool);
+	free_buf(want);
+	free_buf(x);
+	return bad;
+}
+
+/*
+ * expected_int( ... )
+ *
+ * What converting 'v' to a 'bits' bit integer should give, clamped
+ * to 'hi' at the top (2^31 - 1 isn't a float, so 32 bit values from
+ * floats stop at the float just below it).
+ */
+static double
+expected_int(double v, int bits, double hi)
+{
+	double lo = -ldexp(1.0, bits - 1);
+
+	if (isnan(v) || (v <= lo)) {
+		return lo;
+	}
+	return (v >= hi) ? hi : nearbyint(v);
+}
+
+/*
+ * check_int_bits( ... )
+ *
+ * Convert 'v' ('n' values) to 'bits' bit integers and back, as IQ
+ * pairs, as real samples, through a strided view, and from single
+ * precision. Returns the number of values that are wrong.
+ */
+static int
+check_int_bits(const double *v, int n, int bits)
+{
+	double hi = ldexp(1.0, bits - 1) - 1;
+	double hi_f = (bits == 32) ? 2147483520.0 : hi;
+	sample_buf_t *iq, *re, *view, *back;
+	sample_buf_f_t *iq_f, *back_f;
+	sample_buf_i_t *ib;
+	complex double part[100];
+	int bad = 0;
+
+	iq = alloc_buf(n / 2, SAMPLE_RATE);
+	re = alloc_buf(n, SAMPLE_RATE);
+	iq_f = alloc_buf_f(n / 2, SAMPLE_RATE);
+	if ((iq == NULL) || (re == NULL) || (iq_f == NULL)) {
+		return 1;
+	}
+	iq->type = SAMPLE_SIGNAL;
+	re->type = SAMPLE_REAL_SIGNAL;
+	iq_f->type = SAMPLE_SIGNAL;
+	for (int i = 0; i < n / 2; i++) {
+		iq->data[i] = CMPLX(v[2 * i], v[2 * i + 1]);
+		iq_f->data[i] = CMPLXF((float) v[2 * i], (float) v[2 * i + 1]);
+	}
+	for (int i = 0; i < n; i++) {
+		re->data[i] = v[i];
+	}
+
+	/* IQ pairs, and part of them back without a whole buffer */
+	ib = buf_to_int(iq, bits);
+	back = (ib == NULL) ? NULL : buf_from_int(ib);
+	if (back == NULL) {
+		return 1;
+	}
+	bad += (ib->bits != bits) || (ib->type != SAMPLE_SIGNAL);
+	for (int i = 0; i < n / 2; i++) {
+		bad += (creal(back->data[i]) != expected_int(v[2 * i], bits, hi)) ||
+			   (cimag(back->data[i]) != expected_int(v[2 * i + 1], bits, hi));
+	}
+	buf_int_samples(ib, 37, 100, part);
+	for (int i = 0; i < 100; i++) {
+		bad += (part[i] != back->data[37 + i]);
+	}
+	free_buf(back);
+	free_buf_i(ib);
+
+	/* real samples, all of them and every third through a view */
+	for (int stride = 1; stride <= 3; stride += 2) {
+		view = buf_view(re, 1, n, stride);
+		ib = (view == NULL) ? NULL : buf_to_int(view, bits);
+		back = (ib == NULL) ? NULL : buf_from_int(ib);
+		if (back == NULL) {
+			return 1;
+		}
+		bad += (ib->type != SAMPLE_REAL_SIGNAL) || (back->n != view->n);
+		for (int i = 0; i < back->n; i++) {
+			bad += (back->data[i] !=
+					expected_int(v[1 + i * stride], bits, hi));
+		}
+		buf_int_samples(ib, 37, 100, part);
+		for (int i = 0; i < 100; i++) {
+			bad += (part[i] != back->data[37 + i]);
+		}
+		free_buf(back);
+		free_buf_i(ib);
+		free_buf(view);
+	}
+
+	/* single precision */
+	ib = buf_to_int_f(iq_f, bits);
+	back_f = (ib == NULL) ? NULL : buf_from_int_f(ib);
+	if (back_f == NULL) {
+		return 1;
+	}
+	for (int i = 0; i < n / 2; i++) {
+		double want_re = expected_int(crealf(iq_f->data[i]), bits, hi_f);
+		double want_im = expected_int(cimagf(iq_f->data[i]), bits, hi_f);
+
+		bad += (crealf(back_f->data[i]) != (float) want_re) ||
+			   (cimagf(back_f->data[i]) != (float) want_im);
+	}
+	free_buf_f(back_f);
+	free_buf_i(ib);
+	free_buf_f(iq_f);
+	free_buf(re);
+	free_buf(iq);
+	return bad;
+}
+
+/*
+ * check_int( ... )
+ *
+ * Integer conversions at every width and SIMD level, and the FFT of
+ * an integer buffer against that of the same samples as doubles.
+ */
+static int
+check_int(void)
+{
+	simd_level level = simd_get_level();
+	sample_buf_t *s, *d, *a, *b;
+	sample_buf_i_t *ib;
+	double v[2002];
+	int bad = 0;
+
+	for (int bits = 8; bits <= 32; bits *= 2) {
+		double range = ldexp(1.0, bits - 1);
+
+		/* past both ends, exact halves, NaN and infinities */
+		srand(bits);
+		for (int i = 0; i < 2002; i++) {
+			v[i] = (rand() / (double) RAND_MAX - 0.5) * 3 * range;
+		}
+		for (int i = 0; i < 40; i++) {
+			v[7 * i] = floor(v[7 * i]) + 0.5;
+		}
+		v[5] = NAN;
+		v[6] = INFINITY;
+		v[8] = -INFINITY;
+		v[9] = range - 0.5;
+		v[10] = -range - 0.5;
+		for (int l = SIMD_NONE; l <= SIMD_AVX512; l++) {
+			int wrong;
+
+			if (simd_set_level(l) != l) {
+				continue;
+			}
+			wrong = check_int_bits(v, 2002, bits);
+			printf("  %s %2d bit integer conversions  %s\n",
+					simd_level_name(l), bits, (wrong) ? "FAIL" : "ok");
+			bad += (wrong != 0);
+		}
+		simd_set_level(level);
+	}
+
+	/* the integer FFT loads the same numbers */
+	s = alloc_buf(1000, SAMPLE_RATE);
+	if (s == NULL) {
+		return 1;
+	}
+	fill_noise(s, 5);
+	for (int i = 0; i < s->n; i++) {
+		s->data[i] *= 60000;
+	}
+	s->type = SAMPLE_SIGNAL;
+	ib = buf_to_int(s, 16);
+	d = (ib == NULL) ? NULL : buf_from_int(ib);
+	if (d == NULL) {
+		return 1;
+	}
+	a = compute_fft_i(ib, 1024, W_HANN, 1e6);
+	b = compute_fft(d, 1024, W_HANN, 1e6);
+	bad += ! same_samples(a, b);
+	printf("  FFT of a 16 bit integer buffer  %s\n",
+			same_samples(a, b) ? "ok" : "FAIL");
+	if (a != NULL) {
+		free_buf(a);
+	}
+	if (b != NULL) {
+		free_buf(b);
+	}
+	free_buf(d);
+	free_buf_i(ib);
+	free_buf(s);
+	return bad;
+}
+
+int
+main(int argc, char *argv[])
+{
+	int bad = 0;
+
+	printf("Checking sample buffers\n");
+	bad += check_views();
+	bad += check_split();
+	bad += check_pools();
+	bad += check_int();
+	if (bad) {
+		fprintf(stderr, "%d sample buffer checks failed\n", bad);
+		exit(1);
+	}
+	printf("Done.\n");
+}
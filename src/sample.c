@@ -22,30 +22,234 @@
 #include <string.h>
 #include <math.h>
 #include <complex.h>
+#include <pthread.h>
 #include <arpa/inet.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/unistd.h>
 #include <dsp/sample.h>
 #include <dsp/signal.h>
+#include <dsp/simd.h>
 
 /*
- * alloc_buf( ... )
+ * Sample storage, aligned to SAMPLE_ALIGN and rounded up to a
+ * multiple of it (at least one).
+ */
+static void *
+sample_alloc(size_t bytes)
+{
+	size_t len = (bytes + SAMPLE_ALIGN - 1) & ~((size_t) SAMPLE_ALIGN - 1);
+
+	return aligned_alloc(SAMPLE_ALIGN, (len == 0) ? SAMPLE_ALIGN : len);
+}
+
+/* zero the samples between n and the end of the padding */
+#define clear_padding(s)	memset((s)->data + (s)->n, 0, \
+			sizeof((s)->data[0]) * (buf_padded_n(s) - (s)->n))
+
+/*
+ * Size classes, class c holds buffers of up to 1 << c samples.
+ */
+#define BUF_POOL_CLASSES	48
+
+/*
+ * A buffer that belongs to a pool, the sample buffer is first so
+ * that a pointer to one is a pointer to the other.
+ */
+struct __pooled_buf {
+	sample_buf_t		buf;
+	sample_t			*mem;		/* its storage, 1 << cls samples */
+	int					cls;		/* size class */
+	int					out;		/* handed out (not on a free list) */
+	struct __pooled_buf	*next;		/* next on the free list */
+	struct __pooled_buf	*all;		/* next of all the pool's buffers */
+};
+
+struct __buf_pool {
+	buf_pool_mode		mode;
+	pthread_mutex_t		lock;
+	struct __pooled_buf	*free[BUF_POOL_CLASSES];
+	struct __pooled_buf	*all;		/* every buffer, for reset and free */
+};
+
+/* the pool alloc_buf() uses on this thread, if any */
+static _Thread_local buf_pool_t *current_pool;
+
+/*
+ * buf_pool( ... )
  *
- * Allocate a sample buffer.
+ * Create an empty buffer pool.
  */
-sample_buf_t *
-alloc_buf(int size, int sample_rate) {
+buf_pool_t *
+buf_pool(buf_pool_mode mode)
+{
+	buf_pool_t *pool = calloc(1, sizeof(buf_pool_t));
+
+	if (pool == NULL) {
+		fprintf(stderr, "buf_pool(): malloc fail\n");
+		return NULL;
+	}
+	pool->mode = mode;
+	pthread_mutex_init(&pool->lock, NULL);
+	return pool;
+}
+
+/*
+ * free_buf_pool( ... )
+ *
+ * Release the pool and every buffer it has ever handed out, so none
+ * of them can be used after this.
+ */
+void
+free_buf_pool(buf_pool_t *pool)
+{
+	struct __pooled_buf *pb, *nxt;
+
+	if (pool == NULL) {
+		return;
+	}
+	if (current_pool == pool) {
+		current_pool = NULL;
+	}
+	for (pb = pool->all; pb != NULL; pb = nxt) {
+		nxt = pb->all;
+		free(pb->mem);
+		free(pb);
+	}
+	pthread_mutex_destroy(&pool->lock);
+	free(pool);
+}
+
+/*
+ * buf_pool_select( ... )
+ *
+ * Make alloc_buf() on the calling thread use 'pool' (NULL goes back
+ * to malloc()). Returns the pool that was selected before.
+ */
+buf_pool_t *
+buf_pool_select(buf_pool_t *pool)
+{
+	buf_pool_t *prev = current_pool;
+
+	current_pool = pool;
+	return prev;
+}
+
+/*
+ * buf_pool_reset( ... )
+ *
+ * The end of a frame, every buffer handed out goes back on its free
+ * list whether it was freed or not.
+ */
+void
+buf_pool_reset(buf_pool_t *pool)
+{
+	pthread_mutex_lock(&pool->lock);
+	for (struct __pooled_buf *pb = pool->all; pb != NULL; pb = pb->all) {
+		if (pb->out) {
+			pb->out = 0;
+			pb->next = pool->free[pb->cls];
+			pool->free[pb->cls] = pb;
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/*
+ * Take a buffer big enough for 'size' samples from the pool, or
+ * make a new one if its class's free list is empty.
+ */
+static sample_buf_t *
+pool_get(buf_pool_t *pool, int64_t size)
+{
+	struct __pooled_buf *pb;
+	int cls = 0;
+
+	while ((cls < BUF_POOL_CLASSES - 1) && ((1LL << cls) < size)) {
+		cls++;
+	}
+	pthread_mutex_lock(&pool->lock);
+	pb = pool->free[cls];
+	if (pb != NULL) {
+		pool->free[cls] = pb->next;
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	if (pb == NULL) {
+		pb = malloc(sizeof(struct __pooled_buf));
+		if (pb == NULL) {
+			return NULL;
+		}
+		pb->mem = sample_alloc(sizeof(sample_t) * (1LL << cls));
+		if (pb->mem == NULL) {
+			free(pb);
+			return NULL;
+		}
+		pb->cls = cls;
+		pthread_mutex_lock(&pool->lock);
+		pb->all = pool->all;
+		pool->all = pb;
+		pthread_mutex_unlock(&pool->lock);
+	}
+	pb->out = 1;
+	pb->next = NULL;
+	pb->buf.data = pb->mem;
+	pb->buf.pool = pool;
+	return &pb->buf;
+}
+
+/*
+ * Give a pooled buffer back (unless the pool is an arena, then it
+ * waits for buf_pool_reset()).
+ */
+static void
+pool_put(sample_buf_t *sb)
+{
+	struct __pooled_buf *pb = (struct __pooled_buf *) sb;
+	buf_pool_t *pool = sb->pool;
+
+	if (pool->mode == BUF_ARENA) {
+		return;
+	}
+	pthread_mutex_lock(&pool->lock);
+	if (pb->out) {
+		pb->out = 0;
+		pb->next = pool->free[pb->cls];
+		pool->free[pb->cls] = pb;
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/*
+ * Allocate a sample buffer, from the selected pool if there is one.
+ * The samples are only zeroed if 'clear' is set.
+ */
+static sample_buf_t *
+new_buf(int64_t size, int sample_rate, int clear)
+{
 	sample_buf_t *res;
 
-	res = malloc(sizeof(sample_buf_t));
-	res->data = malloc(sizeof(sample_t) * size);
-	if (res->data == NULL) {
-		fprintf(stderr, "alloc_buf(): malloc fail\n");
-		res->n = 0;
-		return res;
+	if (current_pool != NULL) {
+		res = pool_get(current_pool, size);
+		if (res == NULL) {
+			fprintf(stderr, "alloc_buf(): malloc fail\n");
+			return NULL;
+		}
 	} else {
-		res->n = size;
+		res = malloc(sizeof(sample_buf_t));
+		if (res == NULL) {
+			fprintf(stderr, "alloc_buf(): malloc fail\n");
+			return NULL;
+		}
+		res->pool = NULL;
+		res->stride = 1;
+		res->data = sample_alloc(sizeof(sample_t) * size);
+		if (res->data == NULL) {
+			fprintf(stderr, "alloc_buf(): malloc fail\n");
+			res->n = 0;
+			res->flags = 0;
+			return res;
+		}
 	}
 	res->n = size;
 	res->r = sample_rate;
@@ -55,16 +259,43 @@ alloc_buf(int size, int sample_rate) {
 	 */
 	res->max_freq = 0;
 	res->min_freq = (double)(sample_rate);
+	res->center_freq = 0;
 	res->type = SAMPLE_UNKNOWN;
 	res->nxt = NULL;
-	/* clear it to zeros */
+	res->flags = BUF_ALIGNED | BUF_PADDED;
+	res->stride = 1;
 	reset_minmax(res);
-	clear_samples(res);
+	/* clear it to zeros, or at least the padding */
+	if (clear) {
+		clear_samples(res);
+	}
+	clear_padding(res);
 
 	/* return, data and 'n' are initialized */
 	return res;
 }
 
+/*
+ * alloc_buf( ... )
+ *
+ * Allocate a sample buffer.
+ */
+sample_buf_t *
+alloc_buf(int64_t size, int sample_rate) {
+	return new_buf(size, sample_rate, 1);
+}
+
+/*
+ * alloc_buf_noclear( ... )
+ *
+ * Allocate a sample buffer without zeroing it, for results that are
+ * about to have every sample written.
+ */
+sample_buf_t *
+alloc_buf_noclear(int64_t size, int sample_rate) {
+	return new_buf(size, sample_rate, 0);
+}
+
 /*
  * free_buf(...)
  *
@@ -75,6 +306,112 @@ sample_buf_t *
 free_buf(sample_buf_t *sb)
 {
 	sample_buf_t *nxt = (sample_buf_t *) sb->nxt;
+	if (sb->flags & BUF_VIEW) {
+		/* the samples belong to someone else */
+		free(sb);
+		return (nxt);
+	}
+	if (sb->pool != NULL) {
+		sb->nxt = NULL;
+		pool_put(sb);
+		return (nxt);
+	}
+	if (sb->data != NULL) {
+		free(sb->data);
+	}
+	sb->data = 0x0;
+	sb->n = 0;
+	sb->nxt = NULL;
+	free(sb);
+	return (nxt);
+}
+
+/*
+ * buf_view( ... )
+ *
+ * Make a view of 'len' samples of 'parent', starting at sample
+ * 'offset' and taking every 'stride'th one. The view is clipped to
+ * the end of the parent. Its sample rate is the parent's divided by
+ * the stride (the rate its samples are really at), everything else
+ * is the parent's.
+ */
+sample_buf_t *
+buf_view(sample_buf_t *parent, int64_t offset, int64_t len, int stride)
+{
+	sample_buf_t *res;
+	int64_t avail;
+
+	if ((offset < 0) || (offset > parent->n) || (len < 0) || (stride < 1)) {
+		fprintf(stderr, "buf_view(): bad view %lld + %lld * %d of %lld samples\n",
+				(long long) offset, (long long) len, stride,
+				(long long) parent->n);
+		return NULL;
+	}
+	res = malloc(sizeof(sample_buf_t));
+	if (res == NULL) {
+		fprintf(stderr, "buf_view(): malloc fail\n");
+		return NULL;
+	}
+	*res = *parent;
+	avail = (parent->n - offset + stride - 1) / stride;
+	res->n = (len < avail) ? len : avail;
+	res->r = parent->r / stride;
+	res->stride = parent->stride * stride;
+	res->data = parent->data + offset * parent->stride;
+	res->nxt = NULL;
+	res->pool = NULL;
+	res->flags = BUF_VIEW;
+	if ((res->stride == 1) && simd_aligned(res->data, SAMPLE_ALIGN)) {
+		res->flags |= BUF_ALIGNED;
+	}
+	return res;
+}
+
+/*
+ * alloc_buf_f( ... )
+ *
+ * Allocate a single precision sample buffer.
+ */
+sample_buf_f_t *
+alloc_buf_f(int64_t size, int sample_rate) {
+	sample_buf_f_t *res;
+
+	res = malloc(sizeof(sample_buf_f_t));
+	if (res == NULL) {
+		fprintf(stderr, "alloc_buf_f(): malloc fail\n");
+		return NULL;
+	}
+	res->data = sample_alloc(sizeof(samplef_t) * size);
+	if (res->data == NULL) {
+		fprintf(stderr, "alloc_buf_f(): malloc fail\n");
+		res->n = 0;
+		res->flags = 0;
+		return res;
+	}
+	res->n = size;
+	res->r = sample_rate;
+	res->max_freq = 0;
+	res->min_freq = (double)(sample_rate);
+	res->center_freq = 0;
+	res->type = SAMPLE_UNKNOWN;
+	res->nxt = NULL;
+	res->flags = BUF_ALIGNED | BUF_PADDED;
+	reset_minmax(res);
+	clear_samples(res);
+	clear_padding(res);
+	return res;
+}
+
+/*
+ * free_buf_f(...)
+ *
+ * Free a buffer allocated with alloc_buf_f(), returning the
+ * chained buffer if there is one.
+ */
+sample_buf_f_t *
+free_buf_f(sample_buf_f_t *sb)
+{
+	sample_buf_f_t *nxt = sb->nxt;
 	if (sb->data != NULL) {
 		free(sb->data);
 	}
@@ -84,3 +421,467 @@ free_buf(sample_buf_t *sb)
 	free(sb);
 	return (nxt);
 }
+
+/*
+ * buf_to_float( ... )
+ *
+ * Make a single precision copy of a sample buffer.
+ */
+sample_buf_f_t *
+buf_to_float(sample_buf_t *buf)
+{
+	sample_buf_f_t *res = alloc_buf_f(buf->n, buf->r);
+
+	if (res == NULL) {
+		return NULL;
+	}
+	if (res->n != buf->n) {
+		free_buf_f(res);
+		return NULL;
+	}
+	res->sample_min = buf->sample_min;
+	res->sample_max = buf->sample_max;
+	res->max_freq = buf->max_freq;
+	res->center_freq = buf->center_freq;
+	res->min_freq = buf->min_freq;
+	res->type = buf->type;
+	for (int64_t i = 0; i < buf->n; i++) {
+		res->data[i] = (samplef_t) buf->data[i];
+	}
+	return res;
+}
+
+/*
+ * buf_from_float( ... )
+ *
+ * Make a double precision copy of a single precision buffer.
+ */
+sample_buf_t *
+buf_from_float(sample_buf_f_t *buf)
+{
+	sample_buf_t *res = alloc_buf(buf->n, buf->r);
+
+	if (res == NULL) {
+		return NULL;
+	}
+	if (res->n != buf->n) {
+		free_buf(res);
+		return NULL;
+	}
+	res->sample_min = buf->sample_min;
+	res->sample_max = buf->sample_max;
+	res->max_freq = buf->max_freq;
+	res->center_freq = buf->center_freq;
+	res->min_freq = buf->min_freq;
+	res->type = buf->type;
+	for (int64_t i = 0; i < buf->n; i++) {
+		res->data[i] = (sample_t) buf->data[i];
+	}
+	return res;
+}
+
+/*
+ * alloc_buf_split( ... )
+ *
+ * Allocate a split complex sample buffer. Each of re[] and im[] is
+ * aligned and padded like the data of alloc_buf().
+ */
+sample_buf_split_t *
+alloc_buf_split(int64_t size, int sample_rate) {
+	sample_buf_split_t *res;
+	size_t	len;
+
+	res = malloc(sizeof(sample_buf_split_t));
+	if (res == NULL) {
+		fprintf(stderr, "alloc_buf_split(): malloc fail\n");
+		return NULL;
+	}
+	/* both arrays in one allocation, im[] starts after re[]'s padding */
+	len = ((sizeof(double) * size) + SAMPLE_ALIGN - 1) &
+			~((size_t) SAMPLE_ALIGN - 1);
+	res->re = sample_alloc(2 * len);
+	if (res->re == NULL) {
+		fprintf(stderr, "alloc_buf_split(): malloc fail\n");
+		res->im = NULL;
+		res->n = 0;
+		res->flags = 0;
+		return res;
+	}
+	res->im = res->re + (len / sizeof(double));
+	memset(res->re, 0, 2 * len);
+	res->n = size;
+	res->r = sample_rate;
+	res->max_freq = 0;
+	res->min_freq = (double)(sample_rate);
+	res->center_freq = 0;
+	res->type = SAMPLE_UNKNOWN;
+	res->nxt = NULL;
+	res->flags = BUF_ALIGNED | BUF_PADDED;
+	reset_minmax(res);
+	return res;
+}
+
+/*
+ * free_buf_split(...)
+ *
+ * Free a buffer allocated with alloc_buf_split(), returning the
+ * chained buffer if there is one.
+ */
+sample_buf_split_t *
+free_buf_split(sample_buf_split_t *sb)
+{
+	sample_buf_split_t *nxt = sb->nxt;
+
+	/* im[] is part of the same allocation */
+	free(sb->re);
+	sb->re = sb->im = NULL;
+	sb->n = 0;
+	sb->nxt = NULL;
+	free(sb);
+	return (nxt);
+}
+
+/*
+ * buf_to_split( ... )
+ *
+ * Make a split complex copy of a sample buffer.
+ */
+sample_buf_split_t *
+buf_to_split(sample_buf_t *buf)
+{
+	sample_buf_split_t *res = alloc_buf_split(buf->n, buf->r);
+
+	if (res == NULL) {
+		return NULL;
+	}
+	if (res->n != buf->n) {
+		free_buf_split(res);
+		return NULL;
+	}
+	res->sample_min = buf->sample_min;
+	res->sample_max = buf->sample_max;
+	res->max_freq = buf->max_freq;
+	res->center_freq = buf->center_freq;
+	res->min_freq = buf->min_freq;
+	res->type = buf->type;
+	for (int64_t i = 0; i < buf->n; i++) {
+		res->re[i] = creal(buf->data[i]);
+		res->im[i] = cimag(buf->data[i]);
+	}
+	return res;
+}
+
+/*
+ * buf_from_split( ... )
+ *
+ * Make an interleaved copy of a split complex buffer.
+ */
+sample_buf_t *
+buf_from_split(sample_buf_split_t *buf)
+{
+	sample_buf_t *res = alloc_buf_noclear(buf->n, buf->r);
+
+	if (res == NULL) {
+		return NULL;
+	}
+	if (res->n != buf->n) {
+		free_buf(res);
+		return NULL;
+	}
+	res->sample_min = buf->sample_min;
+	res->sample_max = buf->sample_max;
+	res->max_freq = buf->max_freq;
+	res->center_freq = buf->center_freq;
+	res->min_freq = buf->min_freq;
+	res->type = buf->type;
+	for (int64_t i = 0; i < buf->n; i++) {
+		res->data[i] = buf->re[i] + buf->im[i] * I;
+	}
+	return res;
+}
+
+/*
+ * buf_magnitude_split( ... )
+ *
+ * The magnitude of every sample into 'mag' (buf->n of them). These
+ * are the same values cmag() gives for the interleaved samples.
+ */
+void
+buf_magnitude_split(sample_buf_split_t *buf, double *mag)
+{
+	simd_magnitude_split(buf->re, buf->im, buf->n, mag);
+}
+
+/*
+ * alloc_buf_i( ... )
+ *
+ * Allocate an integer sample buffer of 'size' samples of 'bits' bit
+ * values, I, Q pairs if 'has_q' is set. The storage is aligned and
+ * padded like that of alloc_buf().
+ */
+sample_buf_i_t *
+alloc_buf_i(int64_t size, int bits, int has_q, int sample_rate) {
+	sample_buf_i_t *res;
+	size_t	len;
+
+	if ((bits != 8) && (bits != 16) && (bits != 32)) {
+		fprintf(stderr, "alloc_buf_i(): %d bit samples?\n", bits);
+		return NULL;
+	}
+	res = malloc(sizeof(sample_buf_i_t));
+	if (res == NULL) {
+		fprintf(stderr, "alloc_buf_i(): malloc fail\n");
+		return NULL;
+	}
+	len = ((size_t) size * (has_q ? 2 : 1) * (bits / 8) + SAMPLE_ALIGN - 1) &
+			~((size_t) SAMPLE_ALIGN - 1);
+	res->data = sample_alloc(len);
+	if (res->data == NULL) {
+		fprintf(stderr, "alloc_buf_i(): malloc fail\n");
+		res->n = 0;
+		res->flags = 0;
+		return res;
+	}
+	memset(res->data, 0, len);
+	res->n = size;
+	res->r = sample_rate;
+	res->bits = bits;
+	res->max_freq = 0;
+	res->min_freq = (double)(sample_rate);
+	res->center_freq = 0;
+	res->type = (has_q) ? SAMPLE_SIGNAL : SAMPLE_REAL_SIGNAL;
+	res->nxt = NULL;
+	res->flags = BUF_ALIGNED | BUF_PADDED;
+	reset_minmax(res);
+	return res;
+}
+
+/*
+ * free_buf_i(...)
+ *
+ * Free a buffer allocated with alloc_buf_i(), returning the
+ * chained buffer if there is one.
+ */
+sample_buf_i_t *
+free_buf_i(sample_buf_i_t *sb)
+{
+	sample_buf_i_t *nxt = sb->nxt;
+
+	free(sb->data);
+	sb->data = NULL;
+	sb->n = 0;
+	sb->nxt = NULL;
+	free(sb);
+	return (nxt);
+}
+
+/*
+ * Values are converted this many at a time when they have to be
+ * gathered (real parts only, or a strided view) first.
+ */
+#define CONVERT_BLOCK	512
+
+/*
+ * buf_to_int( ... )
+ *
+ * Make an integer copy of a sample buffer. A SAMPLE_REAL_SIGNAL
+ * buffer keeps just the real parts.
+ */
+sample_buf_i_t *
+buf_to_int(sample_buf_t *buf, int bits)
+{
+	int has_q = (buf->type != SAMPLE_REAL_SIGNAL);
+	sample_buf_i_t *res = alloc_buf_i(buf->n, bits, has_q, buf->r);
+	double	tmp[CONVERT_BLOCK];
+	int		step = (has_q) ? CONVERT_BLOCK / 2 : CONVERT_BLOCK;
+
+	if (res == NULL) {
+		return NULL;
+	}
+	if (res->n != buf->n) {
+		free_buf_i(res);
+		return NULL;
+	}
+	res->sample_min = buf->sample_min;
+	res->sample_max = buf->sample_max;
+	res->max_freq = buf->max_freq;
+	res->center_freq = buf->center_freq;
+	res->min_freq = buf->min_freq;
+	res->type = buf->type;
+	if (has_q && (buf->stride == 1)) {
+		/* already interleaved I, Q pairs */
+		simd_double_to_int((const double *) buf->data, 2 * buf->n, bits,
+						   res->data);
+		return res;
+	}
+	for (int64_t i = 0; i < buf->n; i += step) {
+		int len = (int) ((buf->n - i < step) ? buf->n - i : step);
+
+		for (int k = 0; k < len; k++) {
+			if (has_q) {
+				tmp[2 * k] = creal(buf_sample(buf, i + k));
+				tmp[2 * k + 1] = cimag(buf_sample(buf, i + k));
+			} else {
+				tmp[k] = creal(buf_sample(buf, i + k));
+			}
+		}
+		simd_double_to_int(tmp, (has_q) ? 2 * len : len, bits,
+						   (int8_t *) res->data + (size_t) i * (has_q ? 2 : 1) *
+						   (bits / 8));
+	}
+	return res;
+}
+
+/*
+ * buf_to_int_f( ... )
+ *
+ * The same, from a single precision buffer.
+ */
+sample_buf_i_t *
+buf_to_int_f(sample_buf_f_t *buf, int bits)
+{
+	int has_q = (buf->type != SAMPLE_REAL_SIGNAL);
+	sample_buf_i_t *res = alloc_buf_i(buf->n, bits, has_q, buf->r);
+	float	tmp[CONVERT_BLOCK];
+
+	if (res == NULL) {
+		return NULL;
+	}
+	if (res->n != buf->n) {
+		free_buf_i(res);
+		return NULL;
+	}
+	res->sample_min = buf->sample_min;
+	res->sample_max = buf->sample_max;
+	res->max_freq = buf->max_freq;
+	res->center_freq = buf->center_freq;
+	res->min_freq = buf->min_freq;
+	res->type = buf->type;
+	if (has_q) {
+		simd_float_to_int((const float *) buf->data, 2 * buf->n, bits,
+						  res->data);
+		return res;
+	}
+	for (int64_t i = 0; i < buf->n; i += CONVERT_BLOCK) {
+		int len = (int) ((buf->n - i < CONVERT_BLOCK) ? buf->n - i :
+						 CONVERT_BLOCK);
+
+		for (int k = 0; k < len; k++) {
+			tmp[k] = crealf(buf->data[i + k]);
+		}
+		simd_float_to_int(tmp, len, bits,
+						  (int8_t *) res->data + (size_t) i * (bits / 8));
+	}
+	return res;
+}
+
+/*
+ * buf_int_samples( ... )
+ *
+ * Convert 'len' samples, starting at 'offset', to complex doubles.
+ * Real values are converted into the top half of 'dst' and then
+ * spread out into complex values from the bottom up, sample j is
+ * written to doubles 2j and 2j + 1 which are never above the value
+ * (at len + j) it came from, so no value is overwritten before it
+ * has been read.
+ */
+void
+buf_int_samples(sample_buf_i_t *buf, int64_t offset, int64_t len,
+				complex double *dst)
+{
+	double	*d = (double *) dst;
+	int		width = buf->bits / 8;
+
+	if (buf->type != SAMPLE_REAL_SIGNAL) {
+		simd_int_to_double((const int8_t *) buf->data +
+						   (size_t) offset * 2 * width, buf->bits, 2 * len, d);
+		return;
+	}
+	simd_int_to_double((const int8_t *) buf->data + (size_t) offset * width,
+					   buf->bits, len, d + len);
+	for (int64_t j = 0; j < len; j++) {
+		double v = d[len + j];
+		d[2 * j] = v;
+		d[2 * j + 1] = 0;
+	}
+}
+
+/*
+ * buf_int_samples_f( ... )
+ *
+ * The same, to complex floats.
+ */
+void
+buf_int_samples_f(sample_buf_i_t *buf, int64_t offset, int64_t len,
+				  complex float *dst)
+{
+	float	*d = (float *) dst;
+	int		width = buf->bits / 8;
+
+	if (buf->type != SAMPLE_REAL_SIGNAL) {
+		simd_int_to_float((const int8_t *) buf->data +
+						  (size_t) offset * 2 * width, buf->bits, 2 * len, d);
+		return;
+	}
+	simd_int_to_float((const int8_t *) buf->data + (size_t) offset * width,
+					  buf->bits, len, d + len);
+	for (int64_t j = 0; j < len; j++) {
+		float v = d[len + j];
+		d[2 * j] = v;
+		d[2 * j + 1] = 0;
+	}
+}
+
+/*
+ * buf_from_int( ... )
+ *
+ * Make a double precision copy of an integer buffer.
+ */
+sample_buf_t *
+buf_from_int(sample_buf_i_t *buf)
+{
+	sample_buf_t *res = alloc_buf_noclear(buf->n, buf->r);
+
+	if (res == NULL) {
+		return NULL;
+	}
+	if (res->n != buf->n) {
+		free_buf(res);
+		return NULL;
+	}
+	res->sample_min = buf->sample_min;
+	res->sample_max = buf->sample_max;
+	res->max_freq = buf->max_freq;
+	res->center_freq = buf->center_freq;
+	res->min_freq = buf->min_freq;
+	res->type = buf->type;
+	buf_int_samples(buf, 0, buf->n, res->data);
+	return res;
+}
+
+/*
+ * buf_from_int_f( ... )
+ *
+ * Make a single precision copy of an integer buffer.
+ */
+sample_buf_f_t *
+buf_from_int_f(sample_buf_i_t *buf)
+{
+	sample_buf_f_t *res = alloc_buf_f(buf->n, buf->r);
+
+	if (res == NULL) {
+		return NULL;
+	}
+	if (res->n != buf->n) {
+		free_buf_f(res);
+		return NULL;
+	}
+	res->sample_min = buf->sample_min;
+	res->sample_max = buf->sample_max;
+	res->max_freq = buf->max_freq;
+	res->center_freq = buf->center_freq;
+	res->min_freq = buf->min_freq;
+	res->type = buf->type;
+	buf_int_samples_f(buf, 0, buf->n, res->data);
+	return res;
+}
@@ -0,0 +1,211 @@
+/*
+ * sdft.c - the sliding DFT
+ *
+ * I hereby grant permission for anyone to use this software for any
+ * purpose that they choose, I do not warrant the software to be
+ * functional or even correct. It was written as part of an educational
+ * exercise and is not "product grade" as far as the author is concerned.
+ *
+ * NO WARRANTY, EXPRESS OR IMPLIED ACCOMPANIES THIS SOFTWARE. USE IT AT
+ * YOUR OWN RISK.
+ *
+ * If you want a bin's value after every sample, rather than once every
+ * N samples, you don't need an FFT per sample. When the window slides
+ * along by one sample the DFT of the N samples in it changes by
+ *
+ *     S[k](n) = e^(2 pi i k / N) * (S[k](n - 1) + x(n) - x(n - N))
+ *
+ * so each bin costs one complex multiply per sample. The values are
+ * the same as an FFT of the last N samples, oldest first.
+ *
+ * That recursion has its pole right on the unit circle, so rounding
+ * errors never die out, they just pile up. The usual cure is to pull
+ * the pole in a little, with a damping factor r slightly less than 1,
+ *
+ *     S[k](n) = e^(2 pi i k / N) * (r S[k](n - 1) + x(n) - r^N x(n - N))
+ *
+ * which weights the samples in the window by r^age (so r = 0.9999 is a
+ * good start, 1.0 gives the exact DFT for a while).
+ *
+ * A window can't be applied to the samples (they would all need to be
+ * re-weighted every time the window moves) but the Hann and
+ * Blackman-Harris windows are sums of cosines, so in the frequency
+ * domain they are a short convolution with the neighboring bins. For
+ * Hann, X[k] = 1/2 S[k] - 1/4 (S[k - 1] + S[k + 1]). Those neighbors
+ * are tracked too, and the window is applied when the bins are read.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include <dsp/signal.h>
+#include <dsp/windows.h>
+#include <dsp/sdft.h>
+
+/*
+ * free_sdft( ... )
+ *
+ * Release a sliding DFT built by sdft_create().
+ */
+void
+free_sdft(sdft_t *sd)
+{
+	if (sd == NULL) {
+		return;
+	}
+	free(sd->bins);
+	free(sd->track);
+	free(sd->rot);
+	free(sd->state);
+	free(sd->map);
+	free(sd->hist);
+	free(sd);
+}
+
+/*
+ * sdft_create( ... )
+ *
+ * An 'n' sample sliding DFT that keeps up the 'n_bins' bins listed in
+ * 'bins', windowed with 'w', with a damping factor of 'damping'
+ * (greater than 0, at most 1).
+ */
+sdft_t *
+sdft_create(int n, const int *bins, int n_bins, window_function w,
+			double damping)
+{
+	sdft_t *sd;
+	char *want;
+	int spread;
+
+	if ((n < 1) || (n_bins < 1) || (damping <= 0) || (damping > 1.0)) {
+		fprintf(stderr, "sdft_create: bad length, bins, or damping\n");
+		return NULL;
+	}
+	for (int i = 0; i < n_bins; i++) {
+		if ((bins[i] < 0) || (bins[i] >= n)) {
+			fprintf(stderr, "sdft_create: bin %d isn't between 0 and %d\n",
+					bins[i], n - 1);
+			return NULL;
+		}
+	}
+	sd = calloc(1, sizeof(sdft_t));
+	if (sd == NULL) {
+		return NULL;
+	}
+	sd->n = n;
+	sd->n_bins = n_bins;
+	sd->window = w;
+	sd->n_terms = window_cosine_terms(w, sd->coef);
+	sd->damping = damping;
+	sd->damping_n = pow(damping, n);
+	spread = 2 * sd->n_terms - 1;
+	sd->bins = malloc(sizeof(int) * n_bins);
+	sd->map = malloc(sizeof(int) * n_bins * spread);
+	sd->hist = calloc(n, sizeof(complex double));
+	want = calloc(n, 1);
+	if ((sd->bins == NULL) || (sd->map == NULL) || (sd->hist == NULL) ||
+		(want == NULL)) {
+		fprintf(stderr, "sdft_create: out of memory\n");
+		free(want);
+		free_sdft(sd);
+		return NULL;
+	}
+
+	/* every bin asked for, and the neighbors its window needs */
+	memcpy(sd->bins, bins, sizeof(int) * n_bins);
+	for (int i = 0; i < n_bins; i++) {
+		for (int j = 1 - sd->n_terms; j < sd->n_terms; j++) {
+			want[(bins[i] + j + n) % n] = 1;
+		}
+	}
+	for (int k = 0; k < n; k++) {
+		sd->n_track += want[k];
+	}
+	sd->track = malloc(sizeof(int) * sd->n_track);
+	sd->rot = malloc(sizeof(complex double) * sd->n_track);
+	sd->state = calloc(sd->n_track, sizeof(complex double));
+	if ((sd->track == NULL) || (sd->rot == NULL) || (sd->state == NULL)) {
+		fprintf(stderr, "sdft_create: out of memory\n");
+		free(want);
+		free_sdft(sd);
+		return NULL;
+	}
+	for (int k = 0, t = 0; k < n; k++) {
+		if (want[k]) {
+			sd->track[t] = k;
+			sd->rot[t] = cexp(2.0 * M_PI * I * (double) k / (double) n);
+			/* reuse 'want' to find each bin's place in track[] */
+			want[k] = 0;
+			t++;
+		}
+	}
+	for (int i = 0; i < n_bins; i++) {
+		for (int j = 1 - sd->n_terms; j < sd->n_terms; j++) {
+			int k = (bins[i] + j + n) % n;
+			int t = 0;
+			while (sd->track[t] != k) {
+				t++;
+			}
+			sd->map[i * spread + j + sd->n_terms - 1] = t;
+		}
+	}
+	free(want);
+	return sd;
+}
+
+/*
+ * sdft_update( ... )
+ *
+ * Slide the window along by one sample.
+ */
+void
+sdft_update(sdft_t *sd, sample_t x)
+{
+	complex double delta = x - sd->damping_n * sd->hist[sd->pos];
+
+	sd->hist[sd->pos] = x;
+	sd->pos = (sd->pos + 1 == sd->n) ? 0 : sd->pos + 1;
+	sd->count++;
+	for (int t = 0; t < sd->n_track; t++) {
+		sd->state[t] = sd->rot[t] * (sd->damping * sd->state[t] + delta);
+	}
+}
+
+/*
+ * sdft_feed( ... )
+ *
+ * Slide the window over every sample in 's'. Read the bins in between
+ * calls to sdft_update() instead if you need every one of them.
+ */
+void
+sdft_feed(sdft_t *sd, sample_buf_t *s)
+{
+	for (int64_t i = 0; i < s->n; i++) {
+		sdft_update(sd, s->data[i]);
+	}
+}
+
+/*
+ * sdft_bins( ... )
+ *
+ * The current (windowed) value of each bin asked for, into 'out'
+ * which holds sd->n_bins values.
+ */
+void
+sdft_bins(sdft_t *sd, complex double *out)
+{
+	int spread = 2 * sd->n_terms - 1;
+
+	for (int i = 0; i < sd->n_bins; i++) {
+		int *m = sd->map + i * spread + sd->n_terms - 1;
+		complex double x = sd->coef[0] * sd->state[m[0]];
+
+		for (int j = 1; j < sd->n_terms; j++) {
+			double c = ((j & 1) ? -0.5 : 0.5) * sd->coef[j];
+			x += c * (sd->state[m[-j]] + sd->state[m[j]]);
+		}
+		out[i] = x;
+	}
+}
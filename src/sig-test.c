@@ -11,6 +11,74 @@ void dump_signal(sample_buf_t *sig1, sample_buf_t *sig2, signal_format fmt);
 
 #define SIGNAL_FILE		"./signals/test.signal"
 #define TEST_SIGNAL_FILE		"./signals/re-test.signal"
+#define INT_SIGNAL_FILE		"./signals/int-test.signal"
+
+/*
+ * check_int_signal( ... )
+ *
+ * Store whole numbers that fit in 'bits' bits in integer format 'fmt',
+ * then read them back both as integers with load_signal_i() (and
+ * write those out again with store_signal_i()) and as doubles with
+ * load_signal(). Every way has to give back the same numbers.
+ * Returns the number of samples that don't match.
+ */
+static int
+check_int_signal(signal_format fmt, int bits, int has_q)
+{
+	sample_buf_t	*sig, *back, *plain;
+	sample_buf_i_t	*isig;
+	double	scale = (double) (1LL << (bits - 8));
+	int		bad = 0;
+
+	sig = alloc_buf(1001, 8192);
+	if (sig == NULL) {
+		return 1;
+	}
+	sig->type = (has_q) ? SAMPLE_SIGNAL : SAMPLE_REAL_SIGNAL;
+	for (int i = 0; i < sig->n; i++) {
+		double re = (double) ((i * 37) % 256 - 128) * scale;
+		double im = (double) ((i * 91) % 256 - 128) * scale;
+
+		sig->data[i] = (has_q) ? re + im * I : re;
+	}
+	if (! store_signal(sig, fmt, INT_SIGNAL_FILE)) {
+		return 1;
+	}
+	isig = load_signal_i(INT_SIGNAL_FILE);
+	if ((isig == NULL) || (isig->n != sig->n) || (isig->bits != bits) ||
+		(isig->r != sig->r) || (isig->type != sig->type)) {
+		return 1;
+	}
+	back = buf_from_int(isig);
+	plain = load_signal(INT_SIGNAL_FILE);
+	if ((back == NULL) || (plain == NULL) || (plain->n != sig->n)) {
+		return 1;
+	}
+	for (int i = 0; i < sig->n; i++) {
+		bad += (back->data[i] != sig->data[i]) ||
+			   (plain->data[i] != sig->data[i]);
+	}
+	free_buf(back);
+	free_buf(plain);
+
+	/* and out again as integers */
+	if (! store_signal_i(isig, INT_SIGNAL_FILE)) {
+		return 1;
+	}
+	plain = load_signal(INT_SIGNAL_FILE);
+	if ((plain == NULL) || (plain->n != sig->n)) {
+		return 1;
+	}
+	for (int i = 0; i < sig->n; i++) {
+		bad += (plain->data[i] != sig->data[i]);
+	}
+	printf("%2d bit %s integer signal: %d differences\n", bits,
+			(has_q) ? "IQ" : "real", bad);
+	free_buf(plain);
+	free_buf_i(isig);
+	free_buf(sig);
+	return bad;
+}
 
 int
 main(int argc, char *argv[]) {
@@ -41,8 +109,8 @@ main(int argc, char *argv[]) {
 			fprintf(stderr, "Could not store test signal\n");
 			exit(1);
 		}
-		printf("Signal stats: sample_rate: %d, length %d\n", 
-			test_signal->r, test_signal->n);
+		printf("Signal stats: sample_rate: %d, length %lld\n", 
+			test_signal->r, (long long) test_signal->n);
 		if (test_signal->n != signal->n) {
 			printf("Lengths don't match.\n");
 		}
@@ -60,6 +128,18 @@ main(int argc, char *argv[]) {
 			dump_signal(signal, test_signal, test_fmt);
 		}
 	}
+
+	/* integer formats, as doubles and kept as integers */
+	diff = check_int_signal(FMT_IQ_I8, 8, 1);
+	diff += check_int_signal(FMT_IX_I8, 8, 0);
+	diff += check_int_signal(FMT_IQ_I16, 16, 1);
+	diff += check_int_signal(FMT_IX_I16, 16, 0);
+	diff += check_int_signal(FMT_IQ_I32, 32, 1);
+	diff += check_int_signal(FMT_IX_I32, 32, 0);
+	if (diff > 0) {
+		fprintf(stderr, "Integer signals don't reload the same\n");
+		exit(1);
+	}
 	exit(0);
 }
 
@@ -0,0 +1,1537 @@
+/*
+ * simd.c - vector (SIMD) versions of the inner loops
+ *
+ * I hereby grant permission for anyone to use this software for any
+ * purpose that they choose, I do not warrant the software to be
+ * functional or even correct. It was written as part of an educational
+ * exercise and is not "product grade" as far as the author is concerned.
+ *
+ * NO WARRANTY, EXPRESS OR IMPLIED ACCOMPANIES THIS SOFTWARE. USE IT AT
+ * YOUR OWN RISK.
+ *
+ * The FFT spends nearly all of its time in the butterflies, and each
+ * butterfly in a stage is independent of the others. So on x86 we can
+ * do one (SSE2), two (AVX2), or four (AVX-512) of them per instruction.
+ * Which one is used is decided once, by asking the CPU what it has,
+ * and each kernel is compiled for its own instruction set with a
+ * target attribute so the library itself doesn't need special flags.
+ *
+ * Tolerance: the kernels do exactly the multiplies and adds that the
+ * scalar code does, in the same order, and don't use fused multiply
+ * add. So they give the same bins as the scalar code, bit for bit,
+ * unless the compiler is allowed to contract a multiply and add into
+ * an FMA. Then the difference is rounding, at most an ulp or so of
+ * the largest bin per stage, log2(N) stages in all.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include <dsp/simd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86
+#include <immintrin.h>
+#endif
+
+static int simd_ready = 0;
+static simd_level level_in_use = SIMD_NONE;
+
+/*
+ * simd_detect( ... )
+ *
+ * Ask the CPU (CPUID) for the best instruction set it supports.
+ */
+static simd_level
+simd_detect(void)
+{
+#ifdef SIMD_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) {
+		return SIMD_AVX512;
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		return SIMD_AVX2;
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		return SIMD_SSE2;
+	}
+#endif
+	return SIMD_NONE;
+}
+
+simd_level
+simd_get_level(void)
+{
+	if (! simd_ready) {
+		level_in_use = simd_detect();
+		simd_ready = 1;
+	}
+	return level_in_use;
+}
+
+/*
+ * simd_set_level( ... )
+ *
+ * Mostly for testing, pick a particular level. Asking for more than
+ * the CPU can do gets the best it can do.
+ */
+simd_level
+simd_set_level(simd_level level)
+{
+	simd_level best = simd_detect();
+
+	level_in_use = (level > best) ? best : level;
+	simd_ready = 1;
+	return level_in_use;
+}
+
+const char *
+simd_level_name(simd_level level)
+{
+	switch (level) {
+		case SIMD_SSE2:
+			return "sse2";
+		case SIMD_AVX2:
+			return "avx2";
+		case SIMD_AVX512:
+			return "avx512";
+		case SIMD_NONE:
+		default:
+			return "scalar";
+	}
+}
+
+/*
+ * simd_alloc( ... )
+ *
+ * Memory for the kernels to work on, aligned to SIMD_ALIGN bytes and
+ * rounded up to a multiple of that, so that the widest registers can
+ * load it without splitting a cache line. Release it with free().
+ */
+void *
+simd_alloc(size_t bytes)
+{
+	size_t len = (bytes + SIMD_ALIGN - 1) & ~((size_t) SIMD_ALIGN - 1);
+
+	return aligned_alloc(SIMD_ALIGN, (len == 0) ? SIMD_ALIGN : len);
+}
+
+#ifdef SIMD_X86
+/*
+ * Loads and stores for the kernels below. Each kernel is inlined
+ * twice, once with 'al' set for data and roots that are aligned to
+ * the register width (which sample buffers and plans always are, see
+ * simd_alloc()) and once without, so in each copy 'al' is a constant
+ * and picks one instruction.
+ */
+#define LOAD_pd(al, p)		((al) ? _mm_load_pd(p) : _mm_loadu_pd(p))
+#define LOAD256_pd(al, p)	((al) ? _mm256_load_pd(p) : _mm256_loadu_pd(p))
+#define LOAD512_pd(al, p)	((al) ? _mm512_load_pd(p) : _mm512_loadu_pd(p))
+#define LOAD_ps(al, p)		((al) ? _mm_load_ps(p) : _mm_loadu_ps(p))
+#define LOAD256_ps(al, p)	((al) ? _mm256_load_ps(p) : _mm256_loadu_ps(p))
+#define LOAD512_ps(al, p)	((al) ? _mm512_load_ps(p) : _mm512_loadu_ps(p))
+#define STORE_pd(al, p, v)	((al) ? _mm_store_pd(p, v) : _mm_storeu_pd(p, v))
+#define STORE256_pd(al, p, v)	((al) ? _mm256_store_pd(p, v) : \
+								_mm256_storeu_pd(p, v))
+#define STORE512_pd(al, p, v)	((al) ? _mm512_store_pd(p, v) : \
+								_mm512_storeu_pd(p, v))
+#define STORE_ps(al, p, v)	((al) ? _mm_store_ps(p, v) : _mm_storeu_ps(p, v))
+#define STORE256_ps(al, p, v)	((al) ? _mm256_store_ps(p, v) : \
+								_mm256_storeu_ps(p, v))
+#define STORE512_ps(al, p, v)	((al) ? _mm512_store_ps(p, v) : \
+								_mm512_storeu_ps(p, v))
+
+/*
+ * One butterfly stage, 'half' is half the butterfly length and 'tw'
+ * is this stage's unit roots. Unlike the scalar code, which walks
+ * each unit root across all of the butterflies that use it, these walk
+ * each group of butterflies in order so that the loads are contiguous.
+ *
+ * The complex multiply of b = (br + i bi) by w = (wr + i wi) is
+ *
+ *     (br * wr - bi * wi) + i (br * wi + bi * wr)
+ *
+ * which is done as [br, br] * [wr, wi] +/- [bi, bi] * [wi, wr].
+ */
+__attribute__((target("sse2"), always_inline)) static inline void
+stage_sse2_k(complex double *data, int n, int half, const complex double *tw,
+		int al)
+{
+	const __m128d neg_lo = _mm_set_pd(0.0, -0.0);
+	double *d = (double *) data;
+	const double *w = (const double *) tw;
+
+	for (int g = 0; g < n; g += 2 * half) {
+		for (int j = 0; j < half; j++) {
+			__m128d a = LOAD_pd(al, d + 2 * (g + j));
+			__m128d b = LOAD_pd(al, d + 2 * (g + j + half));
+			__m128d r = LOAD_pd(al, w + 2 * j);
+			__m128d br = _mm_unpacklo_pd(b, b);
+			__m128d bi = _mm_unpackhi_pd(b, b);
+			__m128d rs = _mm_shuffle_pd(r, r, 1);
+			__m128d t = _mm_add_pd(_mm_mul_pd(br, r),
+						_mm_xor_pd(_mm_mul_pd(bi, rs), neg_lo));
+			STORE_pd(al, d + 2 * (g + j + half), _mm_sub_pd(a, t));
+			STORE_pd(al, d + 2 * (g + j), _mm_add_pd(a, t));
+		}
+	}
+}
+
+__attribute__((target("sse2"))) static void
+stage_sse2(complex double *data, int n, int half, const complex double *tw)
+{
+	if (simd_aligned(data, 16) && simd_aligned(tw, 16)) {
+		stage_sse2_k(data, n, half, tw, 1);
+	} else {
+		stage_sse2_k(data, n, half, tw, 0);
+	}
+}
+
+__attribute__((target("avx2"), always_inline)) static inline void
+stage_avx2_k(complex double *data, int n, int half, const complex double *tw,
+		int al)
+{
+	double *d = (double *) data;
+	const double *w = (const double *) tw;
+
+	for (int g = 0; g < n; g += 2 * half) {
+		for (int j = 0; j < half; j += 2) {
+			__m256d a = LOAD256_pd(al, d + 2 * (g + j));
+			__m256d b = LOAD256_pd(al, d + 2 * (g + j + half));
+			__m256d r = LOAD256_pd(al, w + 2 * j);
+			__m256d br = _mm256_movedup_pd(b);
+			__m256d bi = _mm256_permute_pd(b, 0xf);
+			__m256d rs = _mm256_permute_pd(r, 0x5);
+			__m256d t = _mm256_addsub_pd(_mm256_mul_pd(br, r),
+						_mm256_mul_pd(bi, rs));
+			STORE256_pd(al, d + 2 * (g + j + half), _mm256_sub_pd(a, t));
+			STORE256_pd(al, d + 2 * (g + j), _mm256_add_pd(a, t));
+		}
+	}
+}
+
+__attribute__((target("avx2"))) static void
+stage_avx2(complex double *data, int n, int half, const complex double *tw)
+{
+	if (simd_aligned(data, 32) && simd_aligned(tw, 32)) {
+		stage_avx2_k(data, n, half, tw, 1);
+	} else {
+		stage_avx2_k(data, n, half, tw, 0);
+	}
+}
+
+__attribute__((target("avx512f"), always_inline)) static inline void
+stage_avx512_k(complex double *data, int n, int half, const complex double *tw,
+		int al)
+{
+	double *d = (double *) data;
+	const double *w = (const double *) tw;
+
+	for (int g = 0; g < n; g += 2 * half) {
+		for (int j = 0; j < half; j += 4) {
+			__m512d a = LOAD512_pd(al, d + 2 * (g + j));
+			__m512d b = LOAD512_pd(al, d + 2 * (g + j + half));
+			__m512d r = LOAD512_pd(al, w + 2 * j);
+			__m512d br = _mm512_movedup_pd(b);
+			__m512d bi = _mm512_permute_pd(b, 0xff);
+			__m512d rs = _mm512_permute_pd(r, 0x55);
+			__m512d p1 = _mm512_mul_pd(br, r);
+			__m512d p2 = _mm512_mul_pd(bi, rs);
+			/* no addsub at 512 bits, subtract in the real lanes */
+			__m512d t = _mm512_mask_sub_pd(_mm512_add_pd(p1, p2), 0x55,
+						p1, p2);
+			STORE512_pd(al, d + 2 * (g + j + half), _mm512_sub_pd(a, t));
+			STORE512_pd(al, d + 2 * (g + j), _mm512_add_pd(a, t));
+		}
+	}
+}
+
+__attribute__((target("avx512f"))) static void
+stage_avx512(complex double *data, int n, int half, const complex double *tw)
+{
+	if (simd_aligned(data, 64) && simd_aligned(tw, 64)) {
+		stage_avx512_k(data, n, half, tw, 1);
+	} else {
+		stage_avx512_k(data, n, half, tw, 0);
+	}
+}
+
+/*
+ * Single precision versions of the stages above. Twice as many
+ * complex values fit in each register, [r0, i0, r1, i1, ...], so
+ * the same shuffles are done on pairs of floats.
+ */
+__attribute__((target("sse2"), always_inline)) static inline void
+stage_sse2_f_k(complex float *data, int n, int half, const complex float *tw,
+		int al)
+{
+	const __m128 neg_lo = _mm_set_ps(0.0f, -0.0f, 0.0f, -0.0f);
+	float *d = (float *) data;
+	const float *w = (const float *) tw;
+
+	for (int g = 0; g < n; g += 2 * half) {
+		for (int j = 0; j < half; j += 2) {
+			__m128 a = LOAD_ps(al, d + 2 * (g + j));
+			__m128 b = LOAD_ps(al, d + 2 * (g + j + half));
+			__m128 r = LOAD_ps(al, w + 2 * j);
+			__m128 br = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 0, 0));
+			__m128 bi = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 1, 1));
+			__m128 rs = _mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 3, 0, 1));
+			__m128 t = _mm_add_ps(_mm_mul_ps(br, r),
+						_mm_xor_ps(_mm_mul_ps(bi, rs), neg_lo));
+			STORE_ps(al, d + 2 * (g + j + half), _mm_sub_ps(a, t));
+			STORE_ps(al, d + 2 * (g + j), _mm_add_ps(a, t));
+		}
+	}
+}
+
+__attribute__((target("sse2"))) static void
+stage_sse2_f(complex float *data, int n, int half, const complex float *tw)
+{
+	if (simd_aligned(data, 16) && simd_aligned(tw, 16)) {
+		stage_sse2_f_k(data, n, half, tw, 1);
+	} else {
+		stage_sse2_f_k(data, n, half, tw, 0);
+	}
+}
+
+__attribute__((target("avx2"), always_inline)) static inline void
+stage_avx2_f_k(complex float *data, int n, int half, const complex float *tw,
+		int al)
+{
+	float *d = (float *) data;
+	const float *w = (const float *) tw;
+
+	for (int g = 0; g < n; g += 2 * half) {
+		for (int j = 0; j < half; j += 4) {
+			__m256 a = LOAD256_ps(al, d + 2 * (g + j));
+			__m256 b = LOAD256_ps(al, d + 2 * (g + j + half));
+			__m256 r = LOAD256_ps(al, w + 2 * j);
+			__m256 br = _mm256_moveldup_ps(b);
+			__m256 bi = _mm256_movehdup_ps(b);
+			__m256 rs = _mm256_permute_ps(r, 0xb1);
+			__m256 t = _mm256_addsub_ps(_mm256_mul_ps(br, r),
+						_mm256_mul_ps(bi, rs));
+			STORE256_ps(al, d + 2 * (g + j + half), _mm256_sub_ps(a, t));
+			STORE256_ps(al, d + 2 * (g + j), _mm256_add_ps(a, t));
+		}
+	}
+}
+
+__attribute__((target("avx2"))) static void
+stage_avx2_f(complex float *data, int n, int half, const complex float *tw)
+{
+	if (simd_aligned(data, 32) && simd_aligned(tw, 32)) {
+		stage_avx2_f_k(data, n, half, tw, 1);
+	} else {
+		stage_avx2_f_k(data, n, half, tw, 0);
+	}
+}
+
+__attribute__((target("avx512f"), always_inline)) static inline void
+stage_avx512_f_k(complex float *data, int n, int half, const complex float *tw,
+		int al)
+{
+	float *d = (float *) data;
+	const float *w = (const float *) tw;
+
+	for (int g = 0; g < n; g += 2 * half) {
+		for (int j = 0; j < half; j += 8) {
+			__m512 a = LOAD512_ps(al, d + 2 * (g + j));
+			__m512 b = LOAD512_ps(al, d + 2 * (g + j + half));
+			__m512 r = LOAD512_ps(al, w + 2 * j);
+			__m512 br = _mm512_moveldup_ps(b);
+			__m512 bi = _mm512_movehdup_ps(b);
+			__m512 rs = _mm512_permute_ps(r, 0xb1);
+			__m512 p1 = _mm512_mul_ps(br, r);
+			__m512 p2 = _mm512_mul_ps(bi, rs);
+			__m512 t = _mm512_mask_sub_ps(_mm512_add_ps(p1, p2), 0x5555,
+						p1, p2);
+			STORE512_ps(al, d + 2 * (g + j + half), _mm512_sub_ps(a, t));
+			STORE512_ps(al, d + 2 * (g + j), _mm512_add_ps(a, t));
+		}
+	}
+}
+
+__attribute__((target("avx512f"))) static void
+stage_avx512_f(complex float *data, int n, int half, const complex float *tw)
+{
+	if (simd_aligned(data, 64) && simd_aligned(tw, 64)) {
+		stage_avx512_f_k(data, n, half, tw, 1);
+	} else {
+		stage_avx512_f_k(data, n, half, tw, 0);
+	}
+}
+
+/*
+ * Interleaved stages for batches. 'lanes' frames are woven together,
+ * value i of frame l at [i * lanes + l], so a butterfly's 'a' and 'b'
+ * are each 'lanes' adjacent values that all use the same unit root.
+ */
+__attribute__((target("avx2"), always_inline)) static inline void
+stage_avx2_x2_k(complex double *data, int n, int half, const complex double *tw,
+		int al)
+{
+	double *d = (double *) data;
+
+	for (int g = 0; g < n; g += 2 * half) {
+		for (int j = 0; j < half; j++) {
+			__m256d a = LOAD256_pd(al, d + 4 * (g + j));
+			__m256d b = LOAD256_pd(al, d + 4 * (g + j + half));
+			__m256d r = _mm256_broadcast_pd((const __m128d *) (tw + j));
+			__m256d br = _mm256_movedup_pd(b);
+			__m256d bi = _mm256_permute_pd(b, 0xf);
+			__m256d rs = _mm256_permute_pd(r, 0x5);
+			__m256d t = _mm256_addsub_pd(_mm256_mul_pd(br, r),
+						_mm256_mul_pd(bi, rs));
+			STORE256_pd(al, d + 4 * (g + j + half), _mm256_sub_pd(a, t));
+			STORE256_pd(al, d + 4 * (g + j), _mm256_add_pd(a, t));
+		}
+	}
+}
+
+__attribute__((target("avx2"))) static void
+stage_avx2_x2(complex double *data, int n, int half, const complex double *tw)
+{
+	if (simd_aligned(data, 32)) {
+		stage_avx2_x2_k(data, n, half, tw, 1);
+	} else {
+		stage_avx2_x2_k(data, n, half, tw, 0);
+	}
+}
+
+__attribute__((target("avx512f"), always_inline)) static inline void
+stage_avx512_x4_k(complex double *data, int n, int half, const complex double *tw,
+		int al)
+{
+	double *d = (double *) data;
+
+	for (int g = 0; g < n; g += 2 * half) {
+		for (int j = 0; j < half; j++) {
+			__m512d a = LOAD512_pd(al, d + 8 * (g + j));
+			__m512d b = LOAD512_pd(al, d + 8 * (g + j + half));
+			__m512d r = _mm512_castsi512_pd(_mm512_broadcast_i32x4(
+						_mm_loadu_si128((const __m128i *) (tw + j))));
+			__m512d br = _mm512_movedup_pd(b);
+			__m512d bi = _mm512_permute_pd(b, 0xff);
+			__m512d rs = _mm512_permute_pd(r, 0x55);
+			__m512d p1 = _mm512_mul_pd(br, r);
+			__m512d p2 = _mm512_mul_pd(bi, rs);
+			__m512d t = _mm512_mask_sub_pd(_mm512_add_pd(p1, p2), 0x55,
+						p1, p2);
+			STORE512_pd(al, d + 8 * (g + j + half), _mm512_sub_pd(a, t));
+			STORE512_pd(al, d + 8 * (g + j), _mm512_add_pd(a, t));
+		}
+	}
+}
+
+__attribute__((target("avx512f"))) static void
+stage_avx512_x4(complex double *data, int n, int half, const complex double *tw)
+{
+	if (simd_aligned(data, 64)) {
+		stage_avx512_x4_k(data, n, half, tw, 1);
+	} else {
+		stage_avx512_x4_k(data, n, half, tw, 0);
+	}
+}
+#endif
+
+/*
+ * The scalar version, for when there is nothing better.
+ */
+static void
+stage_scalar(complex double *data, int n, int half, const complex double *tw)
+{
+	for (int g = 0; g < n; g += 2 * half) {
+		for (int j = 0; j < half; j++) {
+			complex double t = data[g + j + half] * tw[j];
+			data[g + j + half] = data[g + j] - t;
+			data[g + j] += t;
+		}
+	}
+}
+
+/*
+ * simd_fft_stages( ... )
+ *
+ * Run every stage from the one with 'first' butterflies per group
+ * with the widest kernel that fits. The early stages have fewer
+ * butterflies per group than a wide register holds, so they drop
+ * down to a narrower kernel.
+ */
+void
+simd_fft_stages(complex double *data, int n, int first,
+				const complex double *stage_tw)
+{
+	simd_level level = simd_get_level();
+
+	for (int half = first; half < n; half <<= 1) {
+		/* this stage's roots are at [half, 2 * half) */
+		const complex double *tw = stage_tw + half;
+#ifdef SIMD_X86
+		if ((level >= SIMD_AVX512) && (half >= 4)) {
+			stage_avx512(data, n, half, tw);
+		} else if ((level >= SIMD_AVX2) && (half >= 2)) {
+			stage_avx2(data, n, half, tw);
+		} else if (level >= SIMD_SSE2) {
+			stage_sse2(data, n, half, tw);
+		} else
+#endif
+		{
+			stage_scalar(data, n, half, tw);
+		}
+	}
+}
+
+static void
+stage_scalar_f(complex float *data, int n, int half, const complex float *tw)
+{
+	for (int g = 0; g < n; g += 2 * half) {
+		for (int j = 0; j < half; j++) {
+			complex float t = data[g + j + half] * tw[j];
+			data[g + j + half] = data[g + j] - t;
+			data[g + j] += t;
+		}
+	}
+}
+
+/*
+ * simd_fft_butterflies( ... )
+ *
+ * All of the stages.
+ */
+void
+simd_fft_butterflies(complex double *data, int n,
+					 const complex double *stage_tw)
+{
+	simd_fft_stages(data, n, 1, stage_tw);
+}
+
+/*
+ * simd_fft_butterflies_f( ... )
+ *
+ * Single precision version of simd_fft_butterflies(). With no
+ * vector unit at all this is just the scalar loop.
+ */
+void
+simd_fft_butterflies_f(complex float *data, int n,
+					   const complex float *stage_tw)
+{
+	simd_level level = simd_get_level();
+
+	for (int half = 1; half < n; half <<= 1) {
+		const complex float *tw = stage_tw + half;
+#ifdef SIMD_X86
+		if ((level >= SIMD_AVX512) && (half >= 8)) {
+			stage_avx512_f(data, n, half, tw);
+		} else if ((level >= SIMD_AVX2) && (half >= 4)) {
+			stage_avx2_f(data, n, half, tw);
+		} else if ((level >= SIMD_SSE2) && (half >= 2)) {
+			stage_sse2_f(data, n, half, tw);
+		} else
+#endif
+		{
+			stage_scalar_f(data, n, half, tw);
+		}
+	}
+}
+
+/*
+ * simd_batch_lanes( ... )
+ *
+ * How many frames a batch should interleave, one vector register's
+ * worth of complex doubles, or 1 if interleaving won't help.
+ */
+int
+simd_batch_lanes(void)
+{
+	switch (simd_get_level()) {
+		case SIMD_AVX512:
+			return 4;
+		case SIMD_AVX2:
+			return 2;
+		default:
+			return 1;
+	}
+}
+
+/*
+ * simd_fft_butterflies_x( ... )
+ *
+ * Butterflies for 'lanes' interleaved frames of 'n' values each.
+ * 'lanes' should be what simd_batch_lanes() said, anything else is
+ * done with plain C.
+ */
+void
+simd_fft_butterflies_x(complex double *data, int n, int lanes, int first,
+					   const complex double *stage_tw)
+{
+	simd_level level = simd_get_level();
+
+	for (int half = first; half < n; half <<= 1) {
+		const complex double *tw = stage_tw + half;
+#ifdef SIMD_X86
+		if ((level >= SIMD_AVX512) && (lanes == 4)) {
+			stage_avx512_x4(data, n, half, tw);
+			continue;
+		} else if ((level >= SIMD_AVX2) && (lanes == 2)) {
+			stage_avx2_x2(data, n, half, tw);
+			continue;
+		}
+#endif
+		for (int g = 0; g < n; g += 2 * half) {
+			for (int j = 0; j < half; j++) {
+				complex double *a = data + (g + j) * lanes;
+				complex double *b = data + (g + j + half) * lanes;
+				for (int l = 0; l < lanes; l++) {
+					complex double t = b[l] * tw[j];
+					b[l] = a[l] - t;
+					a[l] += t;
+				}
+			}
+		}
+	}
+}
+
+/*
+ * Fixed point butterflies. These define the arithmetic: a product of
+ * two Q15 (Q31) values is rounded to nearest, ties up, just as the
+ * PMULHRSW instruction does, and every sum saturates rather than
+ * wrapping. The vector kernels do the same operations so they are
+ * bit for bit the same as the plain C.
+ */
+static inline int16_t
+fx_mul15(int16_t a, int16_t b)
+{
+	return (int16_t) (((int32_t) a * b + 0x4000) >> 15);
+}
+
+static inline int16_t
+fx_sat15(int32_t v, int *ov)
+{
+	if (v > INT16_MAX) {
+		(*ov)++;
+		return INT16_MAX;
+	} else if (v < INT16_MIN) {
+		(*ov)++;
+		return INT16_MIN;
+	}
+	return (int16_t) v;
+}
+
+static inline int32_t
+fx_mul31(int32_t a, int32_t b)
+{
+	return (int32_t) (((int64_t) a * b + 0x40000000) >> 31);
+}
+
+static inline int32_t
+fx_sat31(int64_t v, int *ov)
+{
+	if (v > INT32_MAX) {
+		(*ov)++;
+		return INT32_MAX;
+	} else if (v < INT32_MIN) {
+		(*ov)++;
+		return INT32_MIN;
+	}
+	return (int32_t) v;
+}
+
+static int
+fx_stage_scalar_q15(int16_t *data, int n, int half, const int16_t *wre,
+					const int16_t *wim, int shift, int *peak)
+{
+	int ov = 0;
+	int hi = 0;
+
+	for (int g = 0; g < n; g += 2 * half) {
+		for (int j = 0; j < half; j++) {
+			int16_t *a = data + 2 * (g + j);
+			int16_t *b = data + 2 * (g + j + half);
+			int16_t ar = a[0] >> shift, ai = a[1] >> shift;
+			int16_t br = b[0] >> shift, bi = b[1] >> shift;
+			int16_t tr = fx_sat15(fx_mul15(br, wre[2 * j]) +
+								  fx_mul15(bi, wim[2 * j]), &ov);
+			int16_t ti = fx_sat15(fx_mul15(bi, wre[2 * j + 1]) +
+								  fx_mul15(br, wim[2 * j + 1]), &ov);
+
+			a[0] = fx_sat15(ar + tr, &ov);
+			a[1] = fx_sat15(ai + ti, &ov);
+			b[0] = fx_sat15(ar - tr, &ov);
+			b[1] = fx_sat15(ai - ti, &ov);
+			for (int k = 0; k < 2; k++) {
+				hi = (abs(a[k]) > hi) ? abs(a[k]) : hi;
+				hi = (abs(b[k]) > hi) ? abs(b[k]) : hi;
+			}
+		}
+	}
+	*peak = hi;
+	return ov;
+}
+
+static int
+fx_stage_scalar_q31(int32_t *data, int n, int half, const int32_t *wre,
+					const int32_t *wim, int shift, int64_t *peak)
+{
+	int ov = 0;
+	int64_t hi = 0;
+
+	for (int g = 0; g < n; g += 2 * half) {
+		for (int j = 0; j < half; j++) {
+			int32_t *a = data + 2 * (g + j);
+			int32_t *b = data + 2 * (g + j + half);
+			int32_t ar = a[0] >> shift, ai = a[1] >> shift;
+			int32_t br = b[0] >> shift, bi = b[1] >> shift;
+			int32_t tr = fx_sat31((int64_t) fx_mul31(br, wre[2 * j]) +
+								  fx_mul31(bi, wim[2 * j]), &ov);
+			int32_t ti = fx_sat31((int64_t) fx_mul31(bi, wre[2 * j + 1]) +
+								  fx_mul31(br, wim[2 * j + 1]), &ov);
+
+			a[0] = fx_sat31((int64_t) ar + tr, &ov);
+			a[1] = fx_sat31((int64_t) ai + ti, &ov);
+			b[0] = fx_sat31((int64_t) ar - tr, &ov);
+			b[1] = fx_sat31((int64_t) ai - ti, &ov);
+			for (int k = 0; k < 2; k++) {
+				hi = (llabs(a[k]) > hi) ? llabs(a[k]) : hi;
+				hi = (llabs(b[k]) > hi) ? llabs(b[k]) : hi;
+			}
+		}
+	}
+	*peak = hi;
+	return ov;
+}
+
+#ifdef SIMD_X86
+/* the number of 16 bit lanes where the saturated and wrapped sums differ */
+__attribute__((target("avx2"))) static inline int
+fx_clipped16(__m256i sat, __m256i wrap)
+{
+	unsigned int same = _mm256_movemask_epi8(_mm256_cmpeq_epi16(sat, wrap));
+
+	return __builtin_popcount(~same) / 2;
+}
+
+/*
+ * Eight Q15 butterflies at a time, the 'b' values have their real and
+ * imaginary parts swapped with a byte shuffle so that the two products
+ * of each part line up with the (re, re) and (-im, im) roots.
+ */
+__attribute__((target("avx2"))) static int
+fx_stage_avx2_q15(int16_t *data, int n, int half, const int16_t *wre,
+				  const int16_t *wim, int shift, int *peak)
+{
+	const __m256i swap = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5,
+					10, 11, 8, 9, 14, 15, 12, 13, 2, 3, 0, 1, 6, 7, 4, 5,
+					10, 11, 8, 9, 14, 15, 12, 13);
+	__m128i sh = _mm_cvtsi32_si128(shift);
+	__m256i hi = _mm256_set1_epi16(INT16_MIN);
+	__m256i lo = _mm256_set1_epi16(INT16_MAX);
+	int16_t h[16], l[16];
+	int ov = 0;
+	int top = 0;
+
+	for (int g = 0; g < n; g += 2 * half) {
+		for (int j = 0; j < half; j += 8) {
+			__m256i *pa = (__m256i *) (data + 2 * (g + j));
+			__m256i *pb = (__m256i *) (data + 2 * (g + j + half));
+			__m256i a = _mm256_sra_epi16(_mm256_loadu_si256(pa), sh);
+			__m256i b = _mm256_sra_epi16(_mm256_loadu_si256(pb), sh);
+			__m256i wr = _mm256_loadu_si256((const __m256i *) (wre + 2 * j));
+			__m256i wi = _mm256_loadu_si256((const __m256i *) (wim + 2 * j));
+			__m256i p1 = _mm256_mulhrs_epi16(b, wr);
+			__m256i p2 = _mm256_mulhrs_epi16(_mm256_shuffle_epi8(b, swap), wi);
+			__m256i t = _mm256_adds_epi16(p1, p2);
+			__m256i x = _mm256_adds_epi16(a, t);
+			__m256i y = _mm256_subs_epi16(a, t);
+
+			ov += fx_clipped16(t, _mm256_add_epi16(p1, p2));
+			ov += fx_clipped16(x, _mm256_add_epi16(a, t));
+			ov += fx_clipped16(y, _mm256_sub_epi16(a, t));
+			_mm256_storeu_si256(pa, x);
+			_mm256_storeu_si256(pb, y);
+			hi = _mm256_max_epi16(hi, _mm256_max_epi16(x, y));
+			lo = _mm256_min_epi16(lo, _mm256_min_epi16(x, y));
+		}
+	}
+	_mm256_storeu_si256((__m256i *) h, hi);
+	_mm256_storeu_si256((__m256i *) l, lo);
+	for (int k = 0; k < 16; k++) {
+		top = (abs(h[k]) > top) ? abs(h[k]) : top;
+		top = (abs(l[k]) > top) ? abs(l[k]) : top;
+	}
+	*peak = top;
+	return ov;
+}
+
+/*
+ * Q31 products in the even and odd 32 bit lanes, each done as a 64
+ * bit multiply, rounded and shifted down. Only the low 32 bits of the
+ * shifted product are kept so a logical shift does as well as an
+ * arithmetic one (which AVX2 doesn't have for 64 bit lanes).
+ */
+__attribute__((target("avx2"))) static inline __m256i
+fx_mul31_avx2(__m256i a, __m256i b)
+{
+	const __m256i rnd = _mm256_set1_epi64x(0x40000000);
+	__m256i even = _mm256_add_epi64(_mm256_mul_epi32(a, b), rnd);
+	__m256i odd = _mm256_add_epi64(_mm256_mul_epi32(_mm256_srli_epi64(a, 32),
+							_mm256_srli_epi64(b, 32)), rnd);
+
+	even = _mm256_srli_epi64(even, 31);
+	odd = _mm256_slli_epi64(_mm256_srli_epi64(odd, 31), 32);
+	return _mm256_blend_epi32(even, odd, 0xaa);
+}
+
+/*
+ * There is no saturating 32 bit add, so find the lanes where the sign
+ * of the sum is wrong (the operands agree in sign and the sum doesn't)
+ * and put the largest value of the right sign in them instead.
+ */
+__attribute__((target("avx2"))) static inline __m256i
+fx_sat31_avx2(__m256i a, __m256i sum, __m256i bad, int *ov)
+{
+	__m256i sat = _mm256_xor_si256(_mm256_srai_epi32(a, 31),
+					_mm256_set1_epi32(INT32_MAX));
+
+	*ov += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(bad)));
+	return _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(sum),
+					_mm256_castsi256_ps(sat), _mm256_castsi256_ps(bad)));
+}
+
+__attribute__((target("avx2"))) static inline __m256i
+fx_adds31_avx2(__m256i a, __m256i b, int *ov)
+{
+	__m256i s = _mm256_add_epi32(a, b);
+	__m256i bad = _mm256_and_si256(_mm256_xor_si256(s, a),
+					_mm256_xor_si256(s, b));
+
+	return fx_sat31_avx2(a, s, bad, ov);
+}
+
+__attribute__((target("avx2"))) static inline __m256i
+fx_subs31_avx2(__m256i a, __m256i b, int *ov)
+{
+	__m256i d = _mm256_sub_epi32(a, b);
+	__m256i bad = _mm256_and_si256(_mm256_xor_si256(a, b),
+					_mm256_xor_si256(a, d));
+
+	return fx_sat31_avx2(a, d, bad, ov);
+}
+
+/*
+ * Four Q31 butterflies at a time.
+ */
+__attribute__((target("avx2"))) static int
+fx_stage_avx2_q31(int32_t *data, int n, int half, const int32_t *wre,
+				  const int32_t *wim, int shift, int64_t *peak)
+{
+	__m128i sh = _mm_cvtsi32_si128(shift);
+	__m256i hi = _mm256_set1_epi32(INT32_MIN);
+	__m256i lo = _mm256_set1_epi32(INT32_MAX);
+	int32_t h[8], l[8];
+	int ov = 0;
+	int64_t top = 0;
+
+	for (int g = 0; g < n; g += 2 * half) {
+		for (int j = 0; j < half; j += 4) {
+			__m256i *pa = (__m256i *) (data + 2 * (g + j));
+			__m256i *pb = (__m256i *) (data + 2 * (g + j + half));
+			__m256i a = _mm256_sra_epi32(_mm256_loadu_si256(pa), sh);
+			__m256i b = _mm256_sra_epi32(_mm256_loadu_si256(pb), sh);
+			__m256i wr = _mm256_loadu_si256((const __m256i *) (wre + 2 * j));
+			__m256i wi = _mm256_loadu_si256((const __m256i *) (wim + 2 * j));
+			__m256i p1 = fx_mul31_avx2(b, wr);
+			__m256i p2 = fx_mul31_avx2(_mm256_shuffle_epi32(b, 0xb1), wi);
+			__m256i t = fx_adds31_avx2(p1, p2, &ov);
+			__m256i x = fx_adds31_avx2(a, t, &ov);
+			__m256i y = fx_subs31_avx2(a, t, &ov);
+
+			_mm256_storeu_si256(pa, x);
+			_mm256_storeu_si256(pb, y);
+			hi = _mm256_max_epi32(hi, _mm256_max_epi32(x, y));
+			lo = _mm256_min_epi32(lo, _mm256_min_epi32(x, y));
+		}
+	}
+	_mm256_storeu_si256((__m256i *) h, hi);
+	_mm256_storeu_si256((__m256i *) l, lo);
+	for (int k = 0; k < 8; k++) {
+		top = (llabs(h[k]) > top) ? llabs(h[k]) : top;
+		top = (llabs(l[k]) > top) ? llabs(l[k]) : top;
+	}
+	*peak = top;
+	return ov;
+}
+#endif
+
+/*
+ * simd_fx_stage_q15( ... )
+ *
+ * One stage of Q15 butterflies, AVX2 once there are at least eight
+ * butterflies in a group (there are no 16 bit complex kernels for
+ * the other levels, SSE2 has no rounding multiply).
+ */
+int
+simd_fx_stage_q15(int16_t *data, int n, int half, const int16_t *wre,
+				  const int16_t *wim, int shift, int *peak)
+{
+#ifdef SIMD_X86
+	if ((simd_get_level() >= SIMD_AVX2) && (half >= 8)) {
+		return fx_stage_avx2_q15(data, n, half, wre, wim, shift, peak);
+	}
+#endif
+	return fx_stage_scalar_q15(data, n, half, wre, wim, shift, peak);
+}
+
+/*
+ * simd_fx_stage_q31( ... )
+ *
+ * One stage of Q31 butterflies, AVX2 once there are at least four
+ * butterflies in a group.
+ */
+int
+simd_fx_stage_q31(int32_t *data, int n, int half, const int32_t *wre,
+				  const int32_t *wim, int shift, int64_t *peak)
+{
+#ifdef SIMD_X86
+	if ((simd_get_level() >= SIMD_AVX2) && (half >= 4)) {
+		return fx_stage_avx2_q31(data, n, half, wre, wim, shift, peak);
+	}
+#endif
+	return fx_stage_scalar_q31(data, n, half, wre, wim, shift, peak);
+}
+
+/*
+ * Goertzel filters, one per lane. Each filter's state stays in a
+ * register for the whole block of samples, and each sample is
+ * broadcast to every lane, so K filters cost K / lanes operations per
+ * sample. The states are kept as separate real and imaginary arrays so
+ * a register holds the same part of several filters.
+ */
+static void
+goertzel_scalar(const double *coef, double *s1r, double *s1i, double *s2r,
+				double *s2i, int first, int k, const complex double *x, int64_t n)
+{
+	for (int f = first; f < k; f++) {
+		double ar = s1r[f], ai = s1i[f];
+		double br = s2r[f], bi = s2i[f];
+		double c = coef[f];
+
+		for (int64_t t = 0; t < n; t++) {
+			double r = (creal(x[t]) + c * ar) - br;
+			double i = (cimag(x[t]) + c * ai) - bi;
+			br = ar;
+			bi = ai;
+			ar = r;
+			ai = i;
+		}
+		s1r[f] = ar;
+		s1i[f] = ai;
+		s2r[f] = br;
+		s2i[f] = bi;
+	}
+}
+
+#ifdef SIMD_X86
+__attribute__((target("avx2"))) static int
+goertzel_avx2(const double *coef, double *s1r, double *s1i, double *s2r,
+			  double *s2i, int k, const complex double *x, int64_t n)
+{
+	const double *xd = (const double *) x;
+	int f;
+
+	for (f = 0; f + 4 <= k; f += 4) {
+		__m256d c = _mm256_loadu_pd(coef + f);
+		__m256d ar = _mm256_loadu_pd(s1r + f);
+		__m256d ai = _mm256_loadu_pd(s1i + f);
+		__m256d br = _mm256_loadu_pd(s2r + f);
+		__m256d bi = _mm256_loadu_pd(s2i + f);
+
+		for (int64_t t = 0; t < n; t++) {
+			__m256d xr = _mm256_broadcast_sd(xd + 2 * t);
+			__m256d xi = _mm256_broadcast_sd(xd + 2 * t + 1);
+			__m256d r = _mm256_sub_pd(_mm256_add_pd(xr, _mm256_mul_pd(c, ar)), br);
+			__m256d i = _mm256_sub_pd(_mm256_add_pd(xi, _mm256_mul_pd(c, ai)), bi);
+			br = ar;
+			bi = ai;
+			ar = r;
+			ai = i;
+		}
+		_mm256_storeu_pd(s1r + f, ar);
+		_mm256_storeu_pd(s1i + f, ai);
+		_mm256_storeu_pd(s2r + f, br);
+		_mm256_storeu_pd(s2i + f, bi);
+	}
+	return f;
+}
+
+__attribute__((target("avx512f"))) static int
+goertzel_avx512(const double *coef, double *s1r, double *s1i, double *s2r,
+				double *s2i, int k, const complex double *x, int64_t n)
+{
+	const double *xd = (const double *) x;
+	int f;
+
+	for (f = 0; f + 8 <= k; f += 8) {
+		__m512d c = _mm512_loadu_pd(coef + f);
+		__m512d ar = _mm512_loadu_pd(s1r + f);
+		__m512d ai = _mm512_loadu_pd(s1i + f);
+		__m512d br = _mm512_loadu_pd(s2r + f);
+		__m512d bi = _mm512_loadu_pd(s2i + f);
+
+		for (int64_t t = 0; t < n; t++) {
+			__m512d xr = _mm512_set1_pd(xd[2 * t]);
+			__m512d xi = _mm512_set1_pd(xd[2 * t + 1]);
+			__m512d r = _mm512_sub_pd(_mm512_add_pd(xr, _mm512_mul_pd(c, ar)), br);
+			__m512d i = _mm512_sub_pd(_mm512_add_pd(xi, _mm512_mul_pd(c, ai)), bi);
+			br = ar;
+			bi = ai;
+			ar = r;
+			ai = i;
+		}
+		_mm512_storeu_pd(s1r + f, ar);
+		_mm512_storeu_pd(s1i + f, ai);
+		_mm512_storeu_pd(s2r + f, br);
+		_mm512_storeu_pd(s2i + f, bi);
+	}
+	return f;
+}
+#endif
+
+/*
+ * simd_goertzel( ... )
+ *
+ * Run 'k' Goertzel filters over 'n' samples. 'coef' holds each one's
+ * 2 cos(w), s1 and s2 are the last two states (real and imaginary
+ * parts), updated in place. The filters that don't fill a register
+ * are done with plain C.
+ */
+void
+simd_goertzel(const double *coef, double *s1r, double *s1i, double *s2r,
+			  double *s2i, int k, const complex double *x, int64_t n)
+{
+	int done = 0;
+#ifdef SIMD_X86
+	simd_level level = simd_get_level();
+
+	if (level >= SIMD_AVX512) {
+		done = goertzel_avx512(coef, s1r, s1i, s2r, s2i, k, x, n);
+	} else if (level >= SIMD_AVX2) {
+		done = goertzel_avx2(coef, s1r, s1i, s2r, s2i, k, x, n);
+	}
+#endif
+	goertzel_scalar(coef, s1r, s1i, s2r, s2i, done, k, x, n);
+}
+
+/*
+ * Split complex butterflies. With the real and imaginary parts in
+ * their own arrays, a register holds the real parts of four (AVX2)
+ * or eight (AVX-512) butterflies and the complex multiply is just
+ *
+ *     tr = br * wr - bi * wi,  ti = br * wi + bi * wr
+ *
+ * with no shuffles at all. These are the same multiplies and adds
+ * as the interleaved kernels so the bins come out the same.
+ */
+static void
+stage_split_scalar(double *re, double *im, int n, int half,
+				   const double *wr, const double *wi)
+{
+	for (int g = 0; g < n; g += 2 * half) {
+		for (int j = 0; j < half; j++) {
+			int a = g + j, b = g + j + half;
+			double tr = re[b] * wr[j] - im[b] * wi[j];
+			double ti = re[b] * wi[j] + im[b] * wr[j];
+			re[b] = re[a] - tr;
+			im[b] = im[a] - ti;
+			re[a] = re[a] + tr;
+			im[a] = im[a] + ti;
+		}
+	}
+}
+
+#ifdef SIMD_X86
+__attribute__((target("avx2"), always_inline)) static inline void
+stage_split_avx2_k(double *re, double *im, int n, int half,
+				   const double *wr, const double *wi, int al)
+{
+	for (int g = 0; g < n; g += 2 * half) {
+		for (int j = 0; j < half; j += 4) {
+			double *ra = re + g + j, *ia = im + g + j;
+			double *rb = ra + half, *ib = ia + half;
+			__m256d ar = LOAD256_pd(al, ra), ai = LOAD256_pd(al, ia);
+			__m256d br = LOAD256_pd(al, rb), bi = LOAD256_pd(al, ib);
+			__m256d c = LOAD256_pd(al, wr + j), s = LOAD256_pd(al, wi + j);
+			__m256d tr = _mm256_sub_pd(_mm256_mul_pd(br, c),
+									   _mm256_mul_pd(bi, s));
+			__m256d ti = _mm256_add_pd(_mm256_mul_pd(br, s),
+									   _mm256_mul_pd(bi, c));
+			STORE256_pd(al, rb, _mm256_sub_pd(ar, tr));
+			STORE256_pd(al, ib, _mm256_sub_pd(ai, ti));
+			STORE256_pd(al, ra, _mm256_add_pd(ar, tr));
+			STORE256_pd(al, ia, _mm256_add_pd(ai, ti));
+		}
+	}
+}
+
+__attribute__((target("avx2"))) static void
+stage_split_avx2(double *re, double *im, int n, int half,
+				 const double *wr, const double *wi)
+{
+	if (simd_aligned(re, 32) && simd_aligned(im, 32) &&
+		simd_aligned(wr, 32) && simd_aligned(wi, 32)) {
+		stage_split_avx2_k(re, im, n, half, wr, wi, 1);
+	} else {
+		stage_split_avx2_k(re, im, n, half, wr, wi, 0);
+	}
+}
+
+__attribute__((target("avx512f"), always_inline)) static inline void
+stage_split_avx512_k(double *re, double *im, int n, int half,
+					 const double *wr, const double *wi, int al)
+{
+	for (int g = 0; g < n; g += 2 * half) {
+		for (int j = 0; j < half; j += 8) {
+			double *ra = re + g + j, *ia = im + g + j;
+			double *rb = ra + half, *ib = ia + half;
+			__m512d ar = LOAD512_pd(al, ra), ai = LOAD512_pd(al, ia);
+			__m512d br = LOAD512_pd(al, rb), bi = LOAD512_pd(al, ib);
+			__m512d c = LOAD512_pd(al, wr + j), s = LOAD512_pd(al, wi + j);
+			__m512d tr = _mm512_sub_pd(_mm512_mul_pd(br, c),
+									   _mm512_mul_pd(bi, s));
+			__m512d ti = _mm512_add_pd(_mm512_mul_pd(br, s),
+									   _mm512_mul_pd(bi, c));
+			STORE512_pd(al, rb, _mm512_sub_pd(ar, tr));
+			STORE512_pd(al, ib, _mm512_sub_pd(ai, ti));
+			STORE512_pd(al, ra, _mm512_add_pd(ar, tr));
+			STORE512_pd(al, ia, _mm512_add_pd(ai, ti));
+		}
+	}
+}
+
+__attribute__((target("avx512f"))) static void
+stage_split_avx512(double *re, double *im, int n, int half,
+				   const double *wr, const double *wi)
+{
+	if (simd_aligned(re, 64) && simd_aligned(im, 64) &&
+		simd_aligned(wr, 64) && simd_aligned(wi, 64)) {
+		stage_split_avx512_k(re, im, n, half, wr, wi, 1);
+	} else {
+		stage_split_avx512_k(re, im, n, half, wr, wi, 0);
+	}
+}
+#endif
+
+/*
+ * simd_fft_stages_split( ... )
+ *
+ * simd_fft_stages() for split complex data, 'stage_re' and
+ * 'stage_im' are the parts of the stage roots, laid out the same way.
+ * Stages with fewer butterflies per group than a register holds are
+ * done with plain C (SSE2 would be no better).
+ */
+void
+simd_fft_stages_split(double *re, double *im, int n, int first,
+					  const double *stage_re, const double *stage_im)
+{
+	simd_level level = simd_get_level();
+
+	for (int half = first; half < n; half <<= 1) {
+		const double *wr = stage_re + half;
+		const double *wi = stage_im + half;
+#ifdef SIMD_X86
+		if ((level >= SIMD_AVX512) && (half >= 8)) {
+			stage_split_avx512(re, im, n, half, wr, wi);
+		} else if ((level >= SIMD_AVX2) && (half >= 4)) {
+			stage_split_avx2(re, im, n, half, wr, wi);
+		} else
+#endif
+		{
+			stage_split_scalar(re, im, n, half, wr, wi);
+		}
+	}
+}
+
+/*
+ * FIR filter on one real array, y[i] = sum of taps[k] * x[i - k],
+ * with x zero before the start. The vector version does four outputs
+ * at a time, once there are enough samples behind them to cover all
+ * of the taps, and adds the products in the same order as the plain
+ * C so the results are the same.
+ */
+static void
+fir_real_scalar(const double *x, const double *taps, int n_taps, double *y,
+				int64_t from, int64_t to)
+{
+	for (int64_t i = from; i < to; i++) {
+		double acc = 0;
+		int last = (i < n_taps) ? (int) i + 1 : n_taps;
+		for (int k = 0; k < last; k++) {
+			acc += x[i - k] * taps[k];
+		}
+		y[i] = acc;
+	}
+}
+
+#ifdef SIMD_X86
+__attribute__((target("avx2"))) static int64_t
+fir_real_avx2(const double *x, int64_t n, const double *taps, int n_taps,
+			  double *y, int64_t from)
+{
+	int64_t i;
+
+	for (i = from; i + 4 <= n; i += 4) {
+		__m256d acc = _mm256_setzero_pd();
+		for (int k = 0; k < n_taps; k++) {
+			acc = _mm256_add_pd(acc, _mm256_mul_pd(
+					_mm256_loadu_pd(x + i - k), _mm256_set1_pd(taps[k])));
+		}
+		_mm256_storeu_pd(y + i, acc);
+	}
+	return i;
+}
+
+/* x *= w, four at a time, returns how many were done */
+__attribute__((target("avx2"))) static int64_t
+mul_real_avx2(double *x, const double *w, int64_t n)
+{
+	int64_t i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		_mm256_storeu_pd(x + i, _mm256_mul_pd(_mm256_loadu_pd(x + i),
+											  _mm256_loadu_pd(w + i)));
+	}
+	return i;
+}
+
+/* magnitudes, four at a time */
+__attribute__((target("avx2"))) static int64_t
+magnitude_avx2(const double *re, const double *im, int64_t n, double *mag)
+{
+	int64_t i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		__m256d r = _mm256_loadu_pd(re + i);
+		__m256d q = _mm256_loadu_pd(im + i);
+		_mm256_storeu_pd(mag + i, _mm256_sqrt_pd(_mm256_add_pd(
+						_mm256_mul_pd(r, r), _mm256_mul_pd(q, q))));
+	}
+	return i;
+}
+#endif
+
+/*
+ * simd_fir_real( ... )
+ *
+ * Filter 'n' real samples 'x' into 'y'.
+ */
+void
+simd_fir_real(const double *x, int64_t n, const double *taps, int n_taps,
+			  double *y)
+{
+	int64_t warm = (n_taps - 1 < n) ? n_taps - 1 : n;
+	int64_t done = warm;
+
+	/* the first few outputs only see some of the taps */
+	fir_real_scalar(x, taps, n_taps, y, 0, warm);
+#ifdef SIMD_X86
+	if (simd_get_level() >= SIMD_AVX2) {
+		done = fir_real_avx2(x, n, taps, n_taps, y, warm);
+	}
+#endif
+	fir_real_scalar(x, taps, n_taps, y, done, n);
+}
+
+/*
+ * simd_mul_real( ... )
+ *
+ * x[i] *= w[i], for windowing one part of a split complex buffer.
+ */
+void
+simd_mul_real(double *x, const double *w, int64_t n)
+{
+	int64_t i = 0;
+#ifdef SIMD_X86
+	if (simd_get_level() >= SIMD_AVX2) {
+		i = mul_real_avx2(x, w, n);
+	}
+#endif
+	for (; i < n; i++) {
+		x[i] *= w[i];
+	}
+}
+
+/*
+ * simd_magnitude_split( ... )
+ *
+ * mag[i] = sqrt(re[i]^2 + im[i]^2). The square root instructions are
+ * correctly rounded, as sqrt() is, so this is the same as the C.
+ */
+void
+simd_magnitude_split(const double *re, const double *im, int64_t n, double *mag)
+{
+	int64_t i = 0;
+#ifdef SIMD_X86
+	if (simd_get_level() >= SIMD_AVX2) {
+		i = magnitude_avx2(re, im, n, mag);
+	}
+#endif
+	for (; i < n; i++) {
+		mag[i] = sqrt(re[i] * re[i] + im[i] * im[i]);
+	}
+}
+
+/*
+ * Conversions between integer samples (8, 16, or 32 bit) and floating
+ * point ones. Integers to floating point are exact, except 32 bit
+ * values to float which round the same way the cast does. The other
+ * way values are clamped to the integer's range and then rounded to
+ * the nearest integer (ties to even), which is what both lrint() and
+ * the vector instructions do. The clamps are written the way the
+ * min and max instructions work so a NaN comes out as the smallest
+ * value either way.
+ */
+#define INT_LO(bits)	(-(double) (1LL << ((bits) - 1)))
+#define INT_HI(bits)	((double) ((1LL << ((bits) - 1)) - 1))
+/* 2^31 - 1 isn't a float, this is the largest one below it */
+#define INT_HI_F(bits)	(((bits) == 32) ? 2147483520.0f : (float) INT_HI(bits))
+
+#ifdef SIMD_X86
+/* integers to doubles, four at a time */
+__attribute__((target("avx2"))) static int64_t
+int_to_double_avx2(const void *x, int bits, int64_t n, double *y)
+{
+	int64_t i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		__m128i v;
+		int32_t	t;
+
+		switch (bits) {
+			case 8:
+				memcpy(&t, (const int8_t *) x + i, sizeof(t));
+				v = _mm_cvtepi8_epi32(_mm_cvtsi32_si128(t));
+				break;
+			case 16:
+				v = _mm_cvtepi16_epi32(_mm_loadl_epi64(
+						(const __m128i *) ((const int16_t *) x + i)));
+				break;
+			default:
+				v = _mm_loadu_si128((const __m128i *) ((const int32_t *) x + i));
+				break;
+		}
+		_mm256_storeu_pd(y + i, _mm256_cvtepi32_pd(v));
+	}
+	return i;
+}
+
+/* integers to floats, eight at a time */
+__attribute__((target("avx2"))) static int64_t
+int_to_float_avx2(const void *x, int bits, int64_t n, float *y)
+{
+	int64_t i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__m256i v;
+
+		switch (bits) {
+			case 8:
+				v = _mm256_cvtepi8_epi32(_mm_loadl_epi64(
+						(const __m128i *) ((const int8_t *) x + i)));
+				break;
+			case 16:
+				v = _mm256_cvtepi16_epi32(_mm_loadu_si128(
+						(const __m128i *) ((const int16_t *) x + i)));
+				break;
+			default:
+				v = _mm256_loadu_si256((const __m256i *) ((const int32_t *) x + i));
+				break;
+		}
+		_mm256_storeu_ps(y + i, _mm256_cvtepi32_ps(v));
+	}
+	return i;
+}
+
+/* doubles to integers, four at a time */
+__attribute__((target("avx2"))) static int64_t
+double_to_int_avx2(const double *x, int64_t n, int bits, void *y)
+{
+	__m256d lo = _mm256_set1_pd(INT_LO(bits));
+	__m256d hi = _mm256_set1_pd(INT_HI(bits));
+	int64_t i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		__m256d d = _mm256_min_pd(_mm256_max_pd(_mm256_loadu_pd(x + i), lo), hi);
+		__m128i v = _mm256_cvtpd_epi32(d);
+		int32_t	t;
+
+		switch (bits) {
+			case 8:
+				v = _mm_packs_epi16(_mm_packs_epi32(v, v), v);
+				t = _mm_cvtsi128_si32(v);
+				memcpy((int8_t *) y + i, &t, sizeof(t));
+				break;
+			case 16:
+				_mm_storel_epi64((__m128i *) ((int16_t *) y + i),
+								 _mm_packs_epi32(v, v));
+				break;
+			default:
+				_mm_storeu_si128((__m128i *) ((int32_t *) y + i), v);
+				break;
+		}
+	}
+	return i;
+}
+
+/* floats to integers, eight at a time */
+__attribute__((target("avx2"))) static int64_t
+float_to_int_avx2(const float *x, int64_t n, int bits, void *y)
+{
+	__m256 lo = _mm256_set1_ps((float) INT_LO(bits));
+	__m256 hi = _mm256_set1_ps(INT_HI_F(bits));
+	int64_t i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__m256 f = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(x + i), lo), hi);
+		__m256i v = _mm256_cvtps_epi32(f);
+		__m128i p;
+
+		switch (bits) {
+			case 8:
+				p = _mm_packs_epi32(_mm256_castsi256_si128(v),
+									_mm256_extracti128_si256(v, 1));
+				_mm_storel_epi64((__m128i *) ((int8_t *) y + i),
+								 _mm_packs_epi16(p, p));
+				break;
+			case 16:
+				p = _mm_packs_epi32(_mm256_castsi256_si128(v),
+									_mm256_extracti128_si256(v, 1));
+				_mm_storeu_si128((__m128i *) ((int16_t *) y + i), p);
+				break;
+			default:
+				_mm256_storeu_si256((__m256i *) ((int32_t *) y + i), v);
+				break;
+		}
+	}
+	return i;
+}
+#endif
+
+/* one integer value, as a long */
+static inline long
+int_value(const void *x, int bits, int64_t i)
+{
+	switch (bits) {
+		case 8:
+			return ((const int8_t *) x)[i];
+		case 16:
+			return ((const int16_t *) x)[i];
+		default:
+			return ((const int32_t *) x)[i];
+	}
+}
+
+/* store one (already clamped) integer value */
+static inline void
+int_store(void *y, int bits, int64_t i, long v)
+{
+	switch (bits) {
+		case 8:
+			((int8_t *) y)[i] = (int8_t) v;
+			break;
+		case 16:
+			((int16_t *) y)[i] = (int16_t) v;
+			break;
+		default:
+			((int32_t *) y)[i] = (int32_t) v;
+			break;
+	}
+}
+
+/*
+ * simd_int_to_double( ... )
+ *
+ * y[i] = x[i] for 'n' integers of 'bits' bits.
+ */
+void
+simd_int_to_double(const void *x, int bits, int64_t n, double *y)
+{
+	int64_t i = 0;
+#ifdef SIMD_X86
+	if (simd_get_level() >= SIMD_AVX2) {
+		i = int_to_double_avx2(x, bits, n, y);
+	}
+#endif
+	for (; i < n; i++) {
+		y[i] = (double) int_value(x, bits, i);
+	}
+}
+
+/*
+ * simd_int_to_float( ... )
+ *
+ * The same, into floats.
+ */
+void
+simd_int_to_float(const void *x, int bits, int64_t n, float *y)
+{
+	int64_t i = 0;
+#ifdef SIMD_X86
+	if (simd_get_level() >= SIMD_AVX2) {
+		i = int_to_float_avx2(x, bits, n, y);
+	}
+#endif
+	for (; i < n; i++) {
+		y[i] = (float) int_value(x, bits, i);
+	}
+}
+
+/*
+ * simd_double_to_int( ... )
+ *
+ * y[i] = x[i], clamped and rounded to a 'bits' bit integer.
+ */
+void
+simd_double_to_int(const double *x, int64_t n, int bits, void *y)
+{
+	double lo = INT_LO(bits);
+	double hi = INT_HI(bits);
+	int64_t i = 0;
+#ifdef SIMD_X86
+	if (simd_get_level() >= SIMD_AVX2) {
+		i = double_to_int_avx2(x, n, bits, y);
+	}
+#endif
+	for (; i < n; i++) {
+		double v = (x[i] > lo) ? x[i] : lo;
+		v = (v < hi) ? v : hi;
+		int_store(y, bits, i, lrint(v));
+	}
+}
+
+/*
+ * simd_float_to_int( ... )
+ *
+ * The same, from floats.
+ */
+void
+simd_float_to_int(const float *x, int64_t n, int bits, void *y)
+{
+	float lo = (float) INT_LO(bits);
+	float hi = INT_HI_F(bits);
+	int64_t i = 0;
+#ifdef SIMD_X86
+	if (simd_get_level() >= SIMD_AVX2) {
+		i = float_to_int_avx2(x, n, bits, y);
+	}
+#endif
+	for (; i < n; i++) {
+		float v = (x[i] > lo) ? x[i] : lo;
+		v = (v < hi) ? v : hi;
+		int_store(y, bits, i, lrintf(v));
+	}
+}
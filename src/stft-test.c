@@ -0,0 +1,167 @@
+/*
+ * stft-test.c - check the short time Fourier transform
+ *
+ * I hereby grant permission for anyone to use this software for any
+ * purpose that they choose, I do not warrant the software to be
+ * functional or even correct. It was written as part of an educational
+ * exercise and is not "product grade" as far as the author is concerned.
+ *
+ * NO WARRANTY, EXPRESS OR IMPLIED ACCOMPANIES THIS SOFTWARE. USE IT AT
+ * YOUR OWN RISK.
+ *
+ * Each row of the STFT is the RMS, bin by bin, of 'average' windowed
+ * FFTs, the first starting at sample 0 and each one 'hop' samples after
+ * the one before. This feeds a signal in uneven pieces and checks each
+ * row against DFTs of those frames done the slow way, with hops both
+ * shorter than the FFT (frames that overlap) and longer (samples that
+ * are skipped).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <complex.h>
+#include <dsp/signal.h>
+#include <dsp/windows.h>
+#include <dsp/dft.h>
+#include <dsp/stft.h>
+
+#define SAMPLE_RATE	8000
+#define SAMPLES		1000
+
+/*
+ * expected_row( ... )
+ *
+ * Row 'row' the slow way, into 'out'.
+ */
+static int
+expected_row(sample_buf_t *s, int bins, int hop, window_function w,
+			 int average, stft_output output, int row, double *out)
+{
+	for (int i = 0; i < bins; i++) {
+		out[i] = 0;
+	}
+	for (int f = row * average; f < (row + 1) * average; f++) {
+		sample_buf_t *frame = buf_view(s, (int64_t) f * hop, bins, 1);
+		sample_buf_t *dft;
+
+		if (frame == NULL) {
+			return -1;
+		}
+		dft = compute_dft(frame, bins, w, 0, 0, 0);
+		free_buf(frame);
+		if (dft == NULL) {
+			return -1;
+		}
+		for (int i = 0; i < bins; i++) {
+			out[i] += pow(cabs(dft->data[i]), 2) / average;
+		}
+		free_buf(dft);
+	}
+	for (int i = 0; i < bins; i++) {
+		out[i] = (output == STFT_DB) ? 10 * log10(out[i]) : sqrt(out[i]);
+	}
+	return 0;
+}
+
+/*
+ * check_stft( ... )
+ *
+ * Feed the samples twice, with a reset in between so the second pass
+ * starts its frames over again, and check every row of both passes.
+ * Returns the number of rows that are wrong (or missing).
+ */
+static int
+check_stft(sample_buf_t *s, int bins, int hop, window_function w,
+		   int average, stft_output output)
+{
+	int		rows = ((SAMPLES - bins) / hop + 1) / average;
+	double	*want;
+	stft_t	*st;
+	int		got = 0;
+	int		bad = 0;
+
+	want = malloc(sizeof(double) * bins);
+	st = stft_create(bins, hop, w, average, output, 2 * rows);
+	if ((want == NULL) || (st == NULL)) {
+		return 2 * rows;
+	}
+	for (int pass = 0; pass < 2; pass++) {
+		for (int off = 0, len = 1; off < SAMPLES; off += len, len += 7) {
+			sample_buf_t *piece = buf_view(s, off, len, 1);
+
+			if (piece == NULL) {
+				return 2 * rows;
+			}
+			got += stft_feed(st, piece);
+			free_buf(piece);
+		}
+		stft_reset(st);
+	}
+	if ((got != 2 * rows) || (stft_row(st, 2 * rows) != NULL)) {
+		printf("  %d rows, not %d\n", got, 2 * rows);
+		bad++;
+	}
+
+	for (int row = 0; row < rows; row++) {
+		double err = 0;
+
+		if (expected_row(s, bins, hop, w, average, output, row, want) < 0) {
+			return 2 * rows;
+		}
+		for (int pass = 0; pass < 2; pass++) {
+			/* age counts back from the last row of the second pass */
+			double *r = stft_row(st, (1 - pass) * rows + rows - 1 - row);
+
+			if (r == NULL) {
+				bad++;
+				continue;
+			}
+			for (int i = 0; i < bins; i++) {
+				double e = fabs(r[i] - want[i]);
+				if (output == STFT_MAGNITUDE) {
+					e /= bins;
+				}
+				err = (e > err) ? e : err;
+			}
+		}
+		bad += (err > 1e-9);
+	}
+	printf("  %4d bins, hop %4d, average %d, %s: %d rows, %d bad\n",
+			bins, hop, average, (output == STFT_DB) ? "dB" : "magnitude",
+			rows, bad);
+	free_stft(st);
+	free(want);
+	return bad;
+}
+
+int
+main(int argc, char *argv[])
+{
+	sample_buf_t	*s;
+	int bad = 0;
+
+	printf("Checking the STFT\n");
+	s = alloc_buf(SAMPLES, SAMPLE_RATE);
+	if (s == NULL) {
+		fprintf(stderr, "Unable to allocate the test signal\n");
+		exit(1);
+	}
+	srand(1);
+	for (int i = 0; i < s->n; i++) {
+		s->data[i] = (rand() / (double) RAND_MAX - 0.5) +
+					 (rand() / (double) RAND_MAX - 0.5) * I;
+	}
+	add_cos(s, 1000.0, 1.0, 0);
+
+	bad += check_stft(s, 64, 16, W_HANN, 1, STFT_MAGNITUDE);
+	bad += check_stft(s, 64, 16, W_BH, 3, STFT_DB);
+	bad += check_stft(s, 60, 45, W_RECT, 2, STFT_MAGNITUDE);
+	bad += check_stft(s, 50, 120, W_HANN, 2, STFT_DB);
+	free_buf(s);
+	if (bad) {
+		fprintf(stderr, "%d STFT rows are wrong\n", bad);
+		exit(1);
+	}
+	printf("Done.\n");
+}
@@ -0,0 +1,207 @@
+/*
+ * stft.c - a streaming short time Fourier transform
+ *
+ * I hereby grant permission for anyone to use this software for any
+ * purpose that they choose, I do not warrant the software to be
+ * functional or even correct. It was written as part of an educational
+ * exercise and is not "product grade" as far as the author is concerned.
+ *
+ * NO WARRANTY, EXPRESS OR IMPLIED ACCOMPANIES THIS SOFTWARE. USE IT AT
+ * YOUR OWN RISK.
+ *
+ * This is the engine behind a spectrum display with a waterfall. It
+ * takes a stream of samples, in whatever sized pieces they come, and
+ * turns it into rows of bin magnitudes. Nothing is allocated once it
+ * is running: the samples carried over from one FFT to the next (when
+ * the hop is less than the FFT size) stay in 'hist', the window is
+ * applied as they are copied into the FFT's work space, and the rows
+ * go into a ring that is reused. The log for dB is only taken once
+ * per row, not once per FFT.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include <dsp/signal.h>
+#include <dsp/windows.h>
+#include <dsp/fft.h>
+#include <dsp/stft.h>
+
+/*
+ * free_stft( ... )
+ *
+ * Release an STFT and everything it holds.
+ */
+void
+free_stft(stft_t *st)
+{
+	if (st == NULL) {
+		return;
+	}
+	free_fft_plan(st->plan);
+	free(st->hist);
+	free(st->work);
+	free(st->acc);
+	free(st->rows);
+	free(st);
+}
+
+/*
+ * stft_create( ... )
+ *
+ * Set up an STFT of 'bins' point FFTs every 'hop' samples, with rows
+ * that are the average of 'average' FFTs. Any FFT size works, but
+ * powers of 2 are the fastest.
+ */
+stft_t *
+stft_create(int bins, int hop, window_function window, int average,
+			stft_output output, int n_rows)
+{
+	stft_t *st;
+
+	if ((bins < 1) || (hop < 1) || (average < 1) || (n_rows < 1)) {
+		fprintf(stderr, "stft_create: bins, hop, average and rows must "
+				"all be at least 1\n");
+		return NULL;
+	}
+	st = calloc(1, sizeof(stft_t));
+	if (st == NULL) {
+		return NULL;
+	}
+	st->bins = bins;
+	st->hop = hop;
+	st->average = average;
+	st->output = output;
+	st->n_rows = n_rows;
+	st->plan = fft_plan(bins, window);
+	st->hist = malloc(sizeof(complex double) * bins);
+	st->work = malloc(sizeof(complex double) * bins);
+	st->acc = calloc(bins, sizeof(double));
+	st->rows = calloc((size_t) n_rows * bins, sizeof(double));
+	if ((st->plan == NULL) || (st->hist == NULL) || (st->work == NULL) ||
+		(st->acc == NULL) || (st->rows == NULL)) {
+		fprintf(stderr, "stft_create: out of memory\n");
+		free_stft(st);
+		return NULL;
+	}
+	return st;
+}
+
+/*
+ * stft_reset( ... )
+ *
+ * Forget the samples carried over and any partly averaged row, so
+ * that the next sample fed starts a new FFT (after a retune say).
+ * The rows already computed are kept.
+ */
+void
+stft_reset(stft_t *st)
+{
+	st->fill = 0;
+	st->skip = 0;
+	st->n_acc = 0;
+	memset(st->acc, 0, sizeof(double) * st->bins);
+}
+
+/*
+ * The FFT of the samples in 'hist', summed into 'acc', and if that
+ * completes a row, the row. Returns the number of rows made (0 or 1).
+ */
+static int
+stft_frame(stft_t *st)
+{
+	const double *win = st->plan->win;
+	double *row;
+	double scale;
+
+	for (int i = 0; i < st->bins; i++) {
+		st->work[i] = win[i] * st->hist[i];
+	}
+	fft_transform(st->plan, st->work);
+	for (int i = 0; i < st->bins; i++) {
+		double re = creal(st->work[i]);
+		double im = cimag(st->work[i]);
+		st->acc[i] += re * re + im * im;
+	}
+	if (++st->n_acc < st->average) {
+		return 0;
+	}
+
+	row = st->rows + (st->row_count % st->n_rows) * st->bins;
+	scale = 1.0 / (double) st->n_acc;
+	for (int i = 0; i < st->bins; i++) {
+		double p = st->acc[i] * scale;
+
+		if (st->output == STFT_DB) {
+			/* power, so 10 log10 is the same as 20 log10 of magnitude */
+			row[i] = (p != 0) ? 10 * log10(p) : -350;
+		} else {
+			row[i] = sqrt(p);
+		}
+		st->acc[i] = 0;
+	}
+	st->n_acc = 0;
+	st->row_count++;
+	return 1;
+}
+
+/*
+ * stft_feed( ... )
+ *
+ * Add the samples in 's' to the stream, computing every FFT (and
+ * row) that they complete. Returns the number of new rows.
+ */
+int
+stft_feed(stft_t *st, sample_buf_t *s)
+{
+	int rows = 0;
+	int64_t i = 0;
+
+	st->r = s->r;
+	while (i < s->n) {
+		int k;
+
+		if (st->skip > 0) {
+			k = (st->skip < s->n - i) ? st->skip : (int) (s->n - i);
+			st->skip -= k;
+			i += k;
+			continue;
+		}
+		k = (st->bins - st->fill < s->n - i) ? st->bins - st->fill :
+			(int) (s->n - i);
+		memcpy(st->hist + st->fill, s->data + i, sizeof(complex double) * k);
+		st->fill += k;
+		i += k;
+		if (st->fill < st->bins) {
+			break;
+		}
+
+		rows += stft_frame(st);
+		if (st->hop < st->bins) {
+			st->fill = st->bins - st->hop;
+			memmove(st->hist, st->hist + st->hop,
+					sizeof(complex double) * st->fill);
+		} else {
+			st->fill = 0;
+			st->skip = st->hop - st->bins;
+		}
+	}
+	return rows;
+}
+
+/*
+ * stft_row( ... )
+ *
+ * The row computed 'age' rows ago, 0 being the latest. Returns NULL
+ * if that row hasn't been computed or has been reused since.
+ */
+double *
+stft_row(stft_t *st, int age)
+{
+	if ((age < 0) || (age >= st->n_rows) || ((uint64_t) age >= st->row_count)) {
+		return NULL;
+	}
+	return st->rows + ((st->row_count - 1 - age) % st->n_rows) * st->bins;
+}
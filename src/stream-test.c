@@ -0,0 +1,258 @@
+/*
+ * stream-test.c - check the sample stream ring buffer
+ *
+ * I hereby grant permission for anyone to use this software for any
+ * purpose that they choose, I do not warrant the software to be
+ * functional or even correct. It was written as part of an educational
+ * exercise and is not "product grade" as far as the author is concerned.
+ *
+ * NO WARRANTY, EXPRESS OR IMPLIED ACCOMPANIES THIS SOFTWARE. USE IT AT
+ * YOUR OWN RISK.
+ *
+ * Every sample written here is its own sample number, so whatever
+ * window is handed out it is easy to tell if it holds the right
+ * samples. The ring is small so the writes and windows go around it
+ * (and through the mirrored samples after its end) many times, first
+ * from one thread and then with a writer and a reader in two.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <complex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <dsp/signal.h>
+#include <dsp/fft.h>
+#include <dsp/stream.h>
+
+#define RING	64
+#define WINDOW	24
+#define SAMPLES	200000
+
+/*
+ * check_window( ... )
+ *
+ * A window of 'len' samples starting 'offset' after the oldest one,
+ * which is sample number 'tail', has to hold the samples numbered
+ * from tail + offset on.
+ */
+static int
+check_window(stream_t *st, int64_t tail, int offset, int len)
+{
+	sample_buf_t view;
+
+	if (stream_window(st, &view, offset, len) == NULL) {
+		return 1;
+	}
+	if ((view.n != len) || (view.stride != 1)) {
+		return 1;
+	}
+	for (int i = 0; i < len; i++) {
+		if (view.data[i] != (double) (tail + offset + i)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * check_ring( ... )
+ *
+ * From one thread, write and consume in uneven amounts so the head
+ * and tail land everywhere in the ring, checking the accounting and
+ * every window that fits as they go.
+ */
+static int
+check_ring(void)
+{
+	sample_t x[RING + 10];
+	sample_buf_t view;
+	stream_t *st;
+	int64_t head = 0, tail = 0;
+	int bad = 0;
+
+	st = stream_create(RING - 5, WINDOW, 1000, SAMPLE_SIGNAL);
+	if ((st == NULL) || (st->size != RING)) {
+		return 1;
+	}
+	for (int step = 0; step < 2000; step++) {
+		int want = (step * 7) % (RING + 10);
+		int done = (step * 5) % (RING / 2) + 1;
+		int space = RING - (int) (head - tail);
+		int wrote;
+		int avail;
+
+		for (int i = 0; i < want; i++) {
+			x[i] = (double) (head + i);
+		}
+		wrote = stream_write(st, x, want);
+		if (wrote != ((want < space) ? want : space)) {
+			bad++;
+		}
+		head += wrote;
+		avail = stream_available(st);
+		if ((avail != head - tail) || (stream_space(st) != RING - avail)) {
+			bad++;
+		}
+
+		/* every window that fits, and none that don't */
+		for (int len = 1; len <= WINDOW; len += 5) {
+			for (int off = 0; off + len <= avail; off += 3) {
+				bad += check_window(st, tail, off, len);
+			}
+			bad += (stream_window(st, &view, avail - len + 1, len) != NULL);
+		}
+		bad += (stream_window(st, &view, 0, WINDOW + 1) != NULL);
+
+		/* consuming more than there is stops at the head */
+		stream_consume(st, done);
+		tail = (tail + done < head) ? tail + done : head;
+	}
+	printf("  one thread, %lld samples through a %d sample ring: %d bad\n",
+			(long long) head, RING, bad);
+	free_stream(st);
+	return bad;
+}
+
+/*
+ * check_strided( ... )
+ *
+ * A strided view written into the stream goes in a sample at a time,
+ * and a window across the end of the ring transforms the same as the
+ * same samples in a buffer of their own.
+ */
+static int
+check_strided(void)
+{
+	sample_buf_t *src, *every3, *copy, *a, *b;
+	sample_buf_t view;
+	stream_t *st;
+	int bad = 0;
+
+	st = stream_create(RING, WINDOW, 1000, SAMPLE_SIGNAL);
+	src = alloc_buf(3 * RING, 1000);
+	if ((st == NULL) || (src == NULL)) {
+		return 1;
+	}
+	for (int i = 0; i < src->n; i++) {
+		src->data[i] = (double) i;
+	}
+	/* move the head and tail to 10 samples before the end */
+	stream_write(st, src->data, RING - 10);
+	stream_consume(st, RING - 10);
+	every3 = buf_view(src, 0, RING, 3);
+	if ((every3 == NULL) || (stream_write_buf(st, every3) != RING)) {
+		return 1;
+	}
+	if (stream_window(st, &view, 0, WINDOW) == NULL) {
+		return 1;
+	}
+	for (int i = 0; i < WINDOW; i++) {
+		bad += (view.data[i] != (double) (3 * i));
+	}
+
+	copy = alloc_buf(WINDOW, 1000);
+	if (copy == NULL) {
+		return 1;
+	}
+	for (int i = 0; i < WINDOW; i++) {
+		copy->data[i] = (double) (3 * i);
+	}
+	a = compute_fft(&view, 32, W_HANN, 0);
+	b = compute_fft(copy, 32, W_HANN, 0);
+	if ((a == NULL) || (b == NULL)) {
+		return 1;
+	}
+	for (int i = 0; i < 32; i++) {
+		bad += (a->data[i] != b->data[i]);
+	}
+	printf("  strided writes and a transform across the end: %d bad\n", bad);
+	free_buf(a);
+	free_buf(b);
+	free_buf(copy);
+	free_buf(every3);
+	free_buf(src);
+	free_stream(st);
+	return bad;
+}
+
+/*
+ * The writer thread, SAMPLES numbered samples in pieces of up to 37
+ * at a time, as fast as there is space for them.
+ */
+static void *
+writer(void *arg)
+{
+	stream_t *st = arg;
+	sample_t x[37];
+	int64_t head = 0;
+
+	while (head < SAMPLES) {
+		int n = (int) (head % 37) + 1;
+
+		n = (n < SAMPLES - head) ? n : (int) (SAMPLES - head);
+		for (int i = 0; i < n; i++) {
+			x[i] = (double) (head + i);
+		}
+		n = stream_write(st, x, n);
+		if (n == 0) {
+			/* full, let the reader at it */
+			sched_yield();
+		}
+		head += n;
+	}
+	return NULL;
+}
+
+/*
+ * check_threads( ... )
+ *
+ * A writer and a reader at the same time, the reader has to see every
+ * sample, in order, in every window it gets.
+ */
+static int
+check_threads(void)
+{
+	pthread_t tid;
+	stream_t *st;
+	int64_t tail = 0;
+	int bad = 0;
+
+	st = stream_create(RING, WINDOW, 1000, SAMPLE_SIGNAL);
+	if ((st == NULL) || (pthread_create(&tid, NULL, writer, st) != 0)) {
+		return 1;
+	}
+	while (tail < SAMPLES) {
+		int len = (int) (tail % WINDOW) + 1;
+
+		len = (len < SAMPLES - tail) ? len : (int) (SAMPLES - tail);
+		if (stream_available(st) < len) {
+			sched_yield();
+			continue;
+		}
+		bad += check_window(st, tail, 0, len);
+		stream_consume(st, len);
+		tail += len;
+	}
+	pthread_join(tid, NULL);
+	printf("  a writer and a reader thread, %d samples: %d bad\n",
+			SAMPLES, bad);
+	free_stream(st);
+	return bad;
+}
+
+int
+main(int argc, char *argv[])
+{
+	int bad = 0;
+
+	printf("Checking the sample stream\n");
+	bad += check_ring();
+	bad += check_strided();
+	bad += check_threads();
+	if (bad) {
+		fprintf(stderr, "%d stream checks failed\n", bad);
+		exit(1);
+	}
+	printf("Done.\n");
+}
@@ -0,0 +1,227 @@
+/*
+ * stream.c - a ring buffer of samples, for continuous processing
+ *
+ * I hereby grant permission for anyone to use this software for any
+ * purpose that they choose, I do not warrant the software to be
+ * functional or even correct. It was written as part of an educational
+ * exercise and is not "product grade" as far as the author is concerned.
+ *
+ * NO WARRANTY, EXPRESS OR IMPLIED ACCOMPANIES THIS SOFTWARE. USE IT AT
+ * YOUR OWN RISK.
+ *
+ * Everything else in the library works on blocks, a sample buffer of
+ * so many samples. A receiver produces samples forever though, and
+ * copying them along a buffer to make room, or allocating a new one
+ * for each block, gets old fast. A ring buffer never moves anything,
+ * the writer and the reader each just chase the other around it.
+ *
+ * The catch with a ring is the wrap, a block that starts near the end
+ * is in two pieces. Here the first 'window' samples of the ring are
+ * also kept after its end (each is written twice) so a block of up
+ * to 'window' samples is always in one piece starting at its first
+ * sample. stream_window() hands out such a block as a view (see
+ * buf_view()) that compute_fft(), fir_filter(), stft_feed() and the
+ * rest take just like any other sample buffer.
+ *
+ * One thread may write while another reads. The writer fills in the
+ * samples before it moves 'head' on (a release store) and the reader
+ * looks at 'head' (an acquire load) before it reads them, so a reader
+ * never sees a sample that isn't all there. Likewise for 'tail' in
+ * the other direction.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <complex.h>
+#include <dsp/signal.h>
+#include <dsp/simd.h>
+#include <dsp/stream.h>
+
+/*
+ * stream_create( ... )
+ *
+ * A stream that holds at least 'size' samples (rounded up to a power
+ * of 2) and can always hand out windows of 'window' samples. Windows
+ * are views with the stream's sample rate and 'type'.
+ */
+stream_t *
+stream_create(int size, int window, int sample_rate, sample_buf_t_type type)
+{
+	stream_t *st;
+	int n = 1;
+
+	while (n < size) {
+		n <<= 1;
+	}
+	if ((size < 1) || (window < 1) || (window > n)) {
+		fprintf(stderr, "stream_create: a %d sample window doesn't fit in "
+				"%d samples\n", window, n);
+		return NULL;
+	}
+	st = calloc(1, sizeof(stream_t));
+	if (st == NULL) {
+		fprintf(stderr, "stream_create: out of memory\n");
+		return NULL;
+	}
+	st->size = n;
+	st->mask = n - 1;
+	st->window = window;
+	st->r = sample_rate;
+	st->type = type;
+	st->data = simd_alloc(sizeof(sample_t) * ((long long) n + window));
+	if (st->data == NULL) {
+		fprintf(stderr, "stream_create: out of memory\n");
+		free(st);
+		return NULL;
+	}
+	atomic_init(&st->head, 0);
+	atomic_init(&st->tail, 0);
+	return st;
+}
+
+/*
+ * free_stream( ... )
+ *
+ * Release a stream, any windows of it are no good after this.
+ */
+void
+free_stream(stream_t *st)
+{
+	if (st == NULL) {
+		return;
+	}
+	free(st->data);
+	free(st);
+}
+
+/*
+ * stream_space( ... )
+ *
+ * How many samples can be written without overwriting some that
+ * haven't been consumed.
+ */
+int
+stream_space(stream_t *st)
+{
+	int64_t head = atomic_load_explicit(&st->head, memory_order_relaxed);
+	int64_t tail = atomic_load_explicit(&st->tail, memory_order_acquire);
+
+	return st->size - (int) (head - tail);
+}
+
+/*
+ * stream_write( ... )
+ *
+ * Add up to 'n' samples, as many as there is space for, and return
+ * how many that was.
+ */
+int
+stream_write(stream_t *st, const sample_t *x, int n)
+{
+	int64_t head = atomic_load_explicit(&st->head, memory_order_relaxed);
+	int space = stream_space(st);
+	int done = 0;
+
+	n = (n < space) ? n : space;
+	while (done < n) {
+		int pos = (int) ((head + done) & st->mask);
+		int run = st->size - pos;
+
+		/* up to the end of the ring, then around to the start */
+		run = (run < n - done) ? run : n - done;
+		memcpy(st->data + pos, x + done, sizeof(sample_t) * run);
+		/* and the part that falls in the mirror again, after the end */
+		if (pos < st->window) {
+			int m = st->window - pos;
+			m = (m < run) ? m : run;
+			memcpy(st->data + st->size + pos, x + done,
+				   sizeof(sample_t) * m);
+		}
+		done += run;
+	}
+	atomic_store_explicit(&st->head, head + n, memory_order_release);
+	return n;
+}
+
+/*
+ * stream_write_buf( ... )
+ *
+ * Add the samples of a buffer, as stream_write().
+ */
+int
+stream_write_buf(stream_t *st, sample_buf_t *s)
+{
+	int done = 0;
+
+	if (s->stride == 1) {
+		/* no more than the ring could ever take anyway */
+		return stream_write(st, s->data,
+							(s->n < INT_MAX) ? (int) s->n : INT_MAX);
+	}
+	/* a strided view, a sample at a time */
+	while ((done < s->n) && (stream_write(st, &buf_sample(s, done), 1) == 1)) {
+		done++;
+	}
+	return done;
+}
+
+/*
+ * stream_available( ... )
+ *
+ * How many samples have been written and not consumed.
+ */
+int
+stream_available(stream_t *st)
+{
+	int64_t head = atomic_load_explicit(&st->head, memory_order_acquire);
+	int64_t tail = atomic_load_explicit(&st->tail, memory_order_relaxed);
+
+	return (int) (head - tail);
+}
+
+/*
+ * stream_window( ... )
+ *
+ * Fill in 'view' to be the 'len' samples starting 'offset' samples
+ * after the oldest unconsumed one. They must all have been written,
+ * and 'len' can be no more than the stream's window. The view stays
+ * good until those samples are consumed. Returns NULL (and leaves
+ * the view alone) if the samples aren't there yet.
+ */
+sample_buf_t *
+stream_window(stream_t *st, sample_buf_t *view, int offset, int len)
+{
+	int64_t tail = atomic_load_explicit(&st->tail, memory_order_relaxed);
+
+	if ((offset < 0) || (len < 0) || (len > st->window) ||
+		(offset + len > stream_available(st))) {
+		return NULL;
+	}
+	memset(view, 0, sizeof(sample_buf_t));
+	view->data = st->data + ((tail + offset) & st->mask);
+	view->n = len;
+	view->r = st->r;
+	view->type = st->type;
+	view->stride = 1;
+	view->min_freq = 0;
+	view->max_freq = st->r;
+	view->flags = BUF_VIEW;
+	return view;
+}
+
+/*
+ * stream_consume( ... )
+ *
+ * Done with the oldest 'n' samples, the producer may reuse them.
+ */
+void
+stream_consume(stream_t *st, int n)
+{
+	int64_t tail = atomic_load_explicit(&st->tail, memory_order_relaxed);
+	int avail = stream_available(st);
+
+	n = (n < avail) ? n : avail;
+	atomic_store_explicit(&st->tail, tail + n, memory_order_release);
+}
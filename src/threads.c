@@ -0,0 +1,194 @@
+/*
+ * threads.c - a small pool of worker threads
+ *
+ * I hereby grant permission for anyone to use this software for any
+ * purpose that they choose, I do not warrant the software to be
+ * functional or even correct. It was written as part of an educational
+ * exercise and is not "product grade" as far as the author is concerned.
+ *
+ * NO WARRANTY, EXPRESS OR IMPLIED ACCOMPANIES THIS SOFTWARE. USE IT AT
+ * YOUR OWN RISK.
+ *
+ * The big transforms break up into lots of independent pieces (sub
+ * FFTs, frames, segments, bins) that can run on different cores. This
+ * keeps a set of threads around so that doing that doesn't cost a
+ * thread create per piece. Work is handed out one task number at a
+ * time, whichever thread is free takes the next one, and the caller
+ * is the last worker so a pool of 'n' starts n - 1 threads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <dsp/threads.h>
+
+struct thread_pool_t {
+	int				n;			/* number of workers (with the caller) */
+	pthread_t		*threads;	/* the n - 1 pool threads */
+	pthread_mutex_t	lock;
+	pthread_cond_t	go;			/* signalled when a job is posted */
+	pthread_cond_t	done;		/* signalled when a job finishes */
+	int				generation;	/* bumped for each job */
+	int				quit;		/* set to stop the threads */
+	/* the job being run */
+	thread_task_t	task;
+	void			*arg;
+	int				n_tasks;
+	int				next;		/* next task number to hand out */
+	int				busy;		/* workers still running the job */
+};
+
+/* worker argument, the pool and which worker this is */
+struct worker_t {
+	struct thread_pool_t	*pool;
+	int						id;
+};
+
+/*
+ * Take task numbers until there are none left. Called with the lock
+ * held, returns with it held.
+ */
+static void
+run_tasks(struct thread_pool_t *pool, int id)
+{
+	while (pool->next < pool->n_tasks) {
+		int t = pool->next++;
+		pthread_mutex_unlock(&pool->lock);
+		pool->task(pool->arg, t, id);
+		pthread_mutex_lock(&pool->lock);
+	}
+}
+
+static void *
+worker(void *arg)
+{
+	struct worker_t *w = arg;
+	struct thread_pool_t *pool = w->pool;
+	int seen = 0;
+
+	pthread_mutex_lock(&pool->lock);
+	while (1) {
+		while ((! pool->quit) && (pool->generation == seen)) {
+			pthread_cond_wait(&pool->go, &pool->lock);
+		}
+		if (pool->quit) {
+			break;
+		}
+		seen = pool->generation;
+		run_tasks(pool, w->id);
+		if (--pool->busy == 0) {
+			pthread_cond_signal(&pool->done);
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+	free(w);
+	return NULL;
+}
+
+/*
+ * thread_pool( ... )
+ *
+ * Create a pool with 'n' workers, or one per online CPU if 'n' is 0.
+ */
+struct thread_pool_t *
+thread_pool(int n)
+{
+	struct thread_pool_t *pool;
+
+	if (n <= 0) {
+		n = (int) sysconf(_SC_NPROCESSORS_ONLN);
+		if (n <= 0) {
+			n = 1;
+		}
+	}
+	pool = calloc(1, sizeof(struct thread_pool_t));
+	if (pool == NULL) {
+		return NULL;
+	}
+	pool->threads = calloc(n, sizeof(pthread_t));
+	if (pool->threads == NULL) {
+		free(pool);
+		return NULL;
+	}
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->go, NULL);
+	pthread_cond_init(&pool->done, NULL);
+	pool->n = 1;
+	for (int i = 1; i < n; i++) {
+		struct worker_t *w = malloc(sizeof(struct worker_t));
+		if (w == NULL) {
+			break;
+		}
+		w->pool = pool;
+		w->id = i;
+		if (pthread_create(&pool->threads[i - 1], NULL, worker, w) != 0) {
+			fprintf(stderr, "thread_pool: only started %d threads\n", i - 1);
+			free(w);
+			break;
+		}
+		pool->n++;
+	}
+	return pool;
+}
+
+int
+thread_pool_size(struct thread_pool_t *pool)
+{
+	return (pool == NULL) ? 1 : pool->n;
+}
+
+/*
+ * thread_pool_run( ... )
+ *
+ * Post a job and help run it, then wait for the other workers.
+ */
+void
+thread_pool_run(struct thread_pool_t *pool, int n_tasks, thread_task_t task,
+				void *arg)
+{
+	if ((pool == NULL) || (pool->n == 1) || (n_tasks < 2)) {
+		for (int t = 0; t < n_tasks; t++) {
+			task(arg, t, 0);
+		}
+		return;
+	}
+	pthread_mutex_lock(&pool->lock);
+	pool->task = task;
+	pool->arg = arg;
+	pool->n_tasks = n_tasks;
+	pool->next = 0;
+	pool->busy = pool->n - 1;
+	pool->generation++;
+	pthread_cond_broadcast(&pool->go);
+	run_tasks(pool, 0);
+	while (pool->busy > 0) {
+		pthread_cond_wait(&pool->done, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/*
+ * free_thread_pool( ... )
+ *
+ * Stop the threads and release the pool.
+ */
+void
+free_thread_pool(struct thread_pool_t *pool)
+{
+	if (pool == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&pool->lock);
+	pool->quit = 1;
+	pthread_cond_broadcast(&pool->go);
+	pthread_mutex_unlock(&pool->lock);
+	for (int i = 0; i < pool->n - 1; i++) {
+		pthread_join(pool->threads[i], NULL);
+	}
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->go);
+	pthread_cond_destroy(&pool->done);
+	free(pool->threads);
+	free(pool);
+}
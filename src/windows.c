@@ -21,10 +21,158 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 #include <complex.h>
+#include <pthread.h>
 #include <dsp/signal.h>
 #include <dsp/windows.h>
+#include <dsp/simd.h>
+
+/*
+ * Computed windows, one per (window, size). Working out a window
+ * takes a sin() or three cos() per coefficient, so every window that
+ * is asked for is kept here and handed out again the next time. They
+ * are never freed (until window_cache_flush()) so the pointers stay
+ * good for as long as anyone holds them. Programs only ever use a
+ * handful of sizes.
+ */
+#define WINDOW_ALIGN	64
+
+struct window_table {
+	window_function		w;
+	int					n;
+	double				*coef;
+	float				*coef_f;	/* made the first time it's wanted */
+	struct window_table	*nxt;
+};
+
+static struct window_table *window_tables = NULL;
+static pthread_mutex_t window_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* memory aligned for the widest vector loads */
+static void *
+window_alloc(size_t size)
+{
+	size = (size + WINDOW_ALIGN - 1) & ~((size_t) WINDOW_ALIGN - 1);
+	return aligned_alloc(WINDOW_ALIGN, (size == 0) ? WINDOW_ALIGN : size);
+}
+
+/* find (or build) the table, with the lock held */
+static struct window_table *
+window_lookup(window_function w, int n)
+{
+	struct window_table *t;
+	double (*win_func)(int, int);
+
+	for (t = window_tables; t != NULL; t = t->nxt) {
+		if ((t->w == w) && (t->n == n)) {
+			return t;
+		}
+	}
+	switch (w) {
+		case W_RECT:
+		default:
+			win_func = rect_window_function;
+			break;
+		case W_HANN:
+			win_func = hann_window_function;
+			break;
+		case W_BH:
+			win_func = bh_window_function;
+			break;
+	}
+	t = calloc(1, sizeof(struct window_table));
+	if (t == NULL) {
+		return NULL;
+	}
+	t->coef = window_alloc(sizeof(double) * n);
+	if (t->coef == NULL) {
+		free(t);
+		return NULL;
+	}
+	t->w = w;
+	t->n = n;
+	for (int i = 0; i < n; i++) {
+		t->coef[i] = win_func(i, n);
+	}
+	t->nxt = window_tables;
+	window_tables = t;
+	return t;
+}
+
+/* window_table( ... )
+ *
+ * The 'n' coefficients of window 'w', the same values that the
+ * *_window_function() calls give. Don't free or change them.
+ */
+const double *
+window_table(window_function w, int n)
+{
+	struct window_table *t;
+
+	if (n < 1) {
+		return NULL;
+	}
+	pthread_mutex_lock(&window_lock);
+	t = window_lookup(w, n);
+	pthread_mutex_unlock(&window_lock);
+	if (t == NULL) {
+		fprintf(stderr, "window_table: out of memory\n");
+		return NULL;
+	}
+	return t->coef;
+}
+
+/* window_table_f( ... )
+ *
+ * Single precision version of window_table().
+ */
+const float *
+window_table_f(window_function w, int n)
+{
+	struct window_table *t;
+	float *res = NULL;
+
+	if (n < 1) {
+		return NULL;
+	}
+	pthread_mutex_lock(&window_lock);
+	t = window_lookup(w, n);
+	if ((t != NULL) && (t->coef_f == NULL)) {
+		t->coef_f = window_alloc(sizeof(float) * n);
+		for (int i = 0; (t->coef_f != NULL) && (i < n); i++) {
+			t->coef_f[i] = (float) t->coef[i];
+		}
+	}
+	if (t != NULL) {
+		res = t->coef_f;
+	}
+	pthread_mutex_unlock(&window_lock);
+	if (res == NULL) {
+		fprintf(stderr, "window_table_f: out of memory\n");
+	}
+	return res;
+}
+
+/* window_cache_flush( ... )
+ *
+ * Free every table. Only for when nothing is using them any more
+ * (no FFT plans are left, for instance).
+ */
+void
+window_cache_flush(void)
+{
+	pthread_mutex_lock(&window_lock);
+	while (window_tables != NULL) {
+		struct window_table *t = window_tables;
+		window_tables = t->nxt;
+		free(t->coef);
+		free(t->coef_f);
+		free(t);
+	}
+	pthread_mutex_unlock(&window_lock);
+}
 
 /* hann_window_function( ... )
  *
@@ -45,17 +193,65 @@ hann_window_function(int k, int N)
 void
 hann_window_buffer(sample_buf_t *b, int bins)
 {
+	const double *win;
 	double hann;
 
 	if ((bins == 0) || (bins > b->n)) {
-		bins = b->n;
+		bins = (int) b->n;
+	}
+	win = window_table(W_HANN, bins);
+	if (win == NULL) {
+		return;
 	}
 	for (int i = 0; i < bins; i++) {
-		hann = hann_window_function(i, bins);
+		hann = win[i];
 		b->data[i] = hann * creal(b->data[i]) + hann * cimag(b->data[i]) * I;
 	}
 }
 
+/* hann_window_buffer_f( ... )
+ *
+ * Single precision version of hann_window_buffer().
+ */
+void
+hann_window_buffer_f(sample_buf_f_t *b, int bins)
+{
+	const float *win;
+	float hann;
+
+	if ((bins == 0) || (bins > b->n)) {
+		bins = (int) b->n;
+	}
+	win = window_table_f(W_HANN, bins);
+	if (win == NULL) {
+		return;
+	}
+	for (int i = 0; i < bins; i++) {
+		hann = win[i];
+		b->data[i] *= hann;
+	}
+}
+
+/* hann_window_buffer_split( ... )
+ *
+ * Split complex version of hann_window_buffer().
+ */
+void
+hann_window_buffer_split(sample_buf_split_t *b, int bins)
+{
+	const double *win;
+
+	if ((bins == 0) || (bins > b->n)) {
+		bins = (int) b->n;
+	}
+	win = window_table(W_HANN, bins);
+	if (win == NULL) {
+		return;
+	}
+	simd_mul_real(b->re, win, bins);
+	simd_mul_real(b->im, win, bins);
+}
+
 /* Blackman-Harris terms a0 through a3 */
 static const double a[4] = { 0.35875, 0.48829, 0.14128, 0.01168 };
 
@@ -81,18 +277,67 @@ bh_window_function(int k, int N)
 void
 bh_window_buffer(sample_buf_t *b, int bins)
 {
+	const double *win;
 	double bh;
 
 	if ((bins == 0) || (bins > b->n)) {
-		bins = b->n;
+		bins = (int) b->n;
 	}
 
+	win = window_table(W_BH, (int) b->n);
+	if (win == NULL) {
+		return;
+	}
 	for (int i = 0; i < bins; i++) {
-		bh = bh_window_function(i, b->n);
+		bh = win[i];
 		b->data[i] = bh * creal(b->data[i]) + bh * cimag(b->data[i]) * I;
 	}
 }
 
+/* bh_window_buffer_f( ... )
+ *
+ * Single precision version of bh_window_buffer().
+ */
+void
+bh_window_buffer_f(sample_buf_f_t *b, int bins)
+{
+	const float *win;
+	float bh;
+
+	if ((bins == 0) || (bins > b->n)) {
+		bins = (int) b->n;
+	}
+
+	win = window_table_f(W_BH, (int) b->n);
+	if (win == NULL) {
+		return;
+	}
+	for (int i = 0; i < bins; i++) {
+		bh = win[i];
+		b->data[i] *= bh;
+	}
+}
+
+/* bh_window_buffer_split( ... )
+ *
+ * Split complex version of bh_window_buffer().
+ */
+void
+bh_window_buffer_split(sample_buf_split_t *b, int bins)
+{
+	const double *win;
+
+	if ((bins == 0) || (bins > b->n)) {
+		bins = (int) b->n;
+	}
+	win = window_table(W_BH, (int) b->n);
+	if (win == NULL) {
+		return;
+	}
+	simd_mul_real(b->re, win, bins);
+	simd_mul_real(b->im, win, bins);
+}
+
 double
 rect_window_function(int i, int k)
 {
@@ -107,3 +352,48 @@ void
 rect_window_buffer(sample_buf_t *b, int bins)
 {
 }
+
+void
+rect_window_buffer_f(sample_buf_f_t *b, int bins)
+{
+	(void) b;
+	(void) bins;
+}
+
+void
+rect_window_buffer_split(sample_buf_split_t *b, int bins)
+{
+	(void) b;
+	(void) bins;
+}
+
+/* window_cosine_terms( ... )
+ *
+ * Each of these windows is a sum of cosines,
+ *
+ *     w(k) = c[0] - c[1] cos(2 pi k / N) + c[2] cos(4 pi k / N) - ...
+ *
+ * This puts the c's in 'coef' (which must hold 4) and returns how
+ * many there are. In the frequency domain the window is then just a
+ * short convolution with the neighboring bins.
+ */
+int
+window_cosine_terms(window_function w, double *coef)
+{
+	switch (w) {
+		case W_HANN:
+			/* sin^2(x) = 1/2 - 1/2 cos(2x) */
+			coef[0] = 0.5;
+			coef[1] = 0.5;
+			return 2;
+		case W_BH:
+			for (int i = 0; i < 4; i++) {
+				coef[i] = a[i];
+			}
+			return 4;
+		case W_RECT:
+		default:
+			coef[0] = 1.0;
+			return 1;
+	}
+}